@@ -0,0 +1,78 @@
+#include "./headers/arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+Arena::Arena(std::size_t blockSize) : blockSize(blockSize) {}
+
+Arena::~Arena() {
+    release(0);
+}
+
+Arena::Arena(Arena&& other) noexcept
+    : blockSize(other.blockSize), blocks(std::move(other.blocks)),
+      cursor(other.cursor), limit(other.limit), used(other.used) {
+    other.blocks.clear();
+    other.cursor = other.limit = nullptr;
+    other.used = 0;
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+    if (this != &other) {
+        release(0);
+        blockSize = other.blockSize;
+        blocks = std::move(other.blocks);
+        cursor = other.cursor;
+        limit = other.limit;
+        used = other.used;
+        other.blocks.clear();
+        other.cursor = other.limit = nullptr;
+        other.used = 0;
+    }
+    return *this;
+}
+
+void* Arena::allocate(std::size_t size, std::size_t align) {
+    std::uintptr_t p = reinterpret_cast<std::uintptr_t>(cursor);
+    std::uintptr_t aligned = (p + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+    if (cursor && aligned + size <= reinterpret_cast<std::uintptr_t>(limit)) {
+        cursor = reinterpret_cast<char*>(aligned + size);
+        used += size;
+        return reinterpret_cast<void*>(aligned);
+    }
+    return grow(size, align);
+}
+
+void* Arena::grow(std::size_t size, std::size_t align) {
+    // Oversized requests get a block of their own
+    std::size_t bytes = std::max(blockSize, size + align);
+    char* data = static_cast<char*>(::operator new(bytes));
+    blocks.push_back(Block{data, bytes});
+    cursor = data;
+    limit = data + bytes;
+    return allocate(size, align);
+}
+
+std::string_view Arena::copy(std::string_view text) {
+    if (text.empty()) return {};
+    char* data = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
+
+void Arena::clear() {
+    release(1);
+    if (!blocks.empty()) {
+        cursor = blocks[0].data;
+        limit = blocks[0].data + blocks[0].size;
+    }
+    used = 0;
+}
+
+void Arena::release(std::size_t keep) {
+    while (blocks.size() > keep) {
+        ::operator delete(blocks.back().data);
+        blocks.pop_back();
+    }
+    if (blocks.empty()) cursor = limit = nullptr;
+}
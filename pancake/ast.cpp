@@ -0,0 +1,84 @@
+#include "./headers/ast.h"
+#include "./headers/astvisitor.h"
+
+#include <algorithm>
+#include <functional>
+
+template <typename T>
+static NodeList append(std::vector<T>& storage, const std::vector<T>& items) {
+    NodeList list;
+    list.first = static_cast<std::uint32_t>(storage.size());
+    list.count = static_cast<std::uint32_t>(items.size());
+    storage.insert(storage.end(), items.begin(), items.end());
+    return list;
+}
+
+NodeList Ast::addStatements(const std::vector<NodeId>& ids) {
+    return append(statementLists, ids);
+}
+
+NodeList Ast::addExpressions(const std::vector<NodeId>& ids) {
+    return append(expressionLists, ids);
+}
+
+NodeList Ast::addElifs(const std::vector<ElifBranch>& branches) {
+    return append(elifLists, branches);
+}
+
+TextRef Ast::addText(std::string_view source) {
+    TextRef ref{static_cast<std::uint32_t>(textPool.size()), static_cast<std::uint32_t>(source.size())};
+    textPool += source;
+    return ref;
+}
+
+std::uint32_t Ast::addString(std::string_view source) {
+    if ((strings.size() + 1) * 2 > stringTable.size()) {
+        std::size_t size = std::max<std::size_t>(stringTable.size(), 32);
+        while (size < (strings.size() + 1) * 2) size *= 2;
+        stringTable.assign(size, 0);
+        std::size_t mask = stringTable.size() - 1;
+        for (std::uint32_t i = 0; i < strings.size(); i++) {
+            std::size_t slot = std::hash<std::string_view>()(text(strings[i])) & mask;
+            while (stringTable[slot] != 0) slot = (slot + 1) & mask;
+            stringTable[slot] = i + 1;
+        }
+    }
+    std::size_t mask = stringTable.size() - 1;
+    std::size_t slot = std::hash<std::string_view>()(source) & mask;
+    for (; stringTable[slot] != 0; slot = (slot + 1) & mask) {
+        std::uint32_t constant = stringTable[slot] - 1;
+        if (text(strings[constant]) == source) return constant;
+    }
+    strings.push_back(addText(source));
+    stringValues.emplace_back(source);
+    stringTable[slot] = static_cast<std::uint32_t>(strings.size());
+    return static_cast<std::uint32_t>(strings.size() - 1);
+}
+
+void Ast::indexStrings() {
+    stringValues.clear();
+    stringTable.clear();   // rebuilt by the next addString()
+    for (TextRef ref : strings) stringValues.emplace_back(text(ref));
+}
+
+void Ast::clear() {
+    arena.clear();
+    image.reset();
+    statementNodes.clear();
+    expressionNodes.clear();
+    statementLists.clear();
+    expressionLists.clear();
+    elifLists.clear();
+    textPool.clear();
+    strings.clear();
+    stringValues.clear();
+    stringTable.clear();
+}
+
+void Statements::debugPrint(const Ast& ast, int indent) const {
+    visit(this, [&](const auto& node) { node.debugPrint(ast, indent); });
+}
+
+void Expressions::debugPrint(const Ast& ast, int indent) const {
+    visit(this, [&](const auto& node) { node.debugPrint(ast, indent); });
+}
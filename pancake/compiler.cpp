@@ -0,0 +1,332 @@
+#include "./headers/compiler.h"
+#include "./headers/astvisitor.h"
+
+#include <cstring>
+
+static const std::uint32_t NO_REGISTER = 0xFFFFFFFFu;
+static const std::uint32_t NO_JUMP = 0xFFFFFFFFu;
+
+const Bytecode& BytecodeCompiler::compile(const Ast& tree, NodeList program) {
+    // Buffers keep their capacity from the previous unit; globals carry over
+    unit.code.clear();
+    unit.offsets.clear();
+    unit.strings.clear();
+    unit.pieces.clear();
+    unit.registers = 0;
+    ast = &tree;
+    compileBlock(program);
+    emit(Opcode::HALT, 0);
+    ast = nullptr;
+    return unit;
+}
+
+
+void BytecodeCompiler::compileBlock(NodeList statements) {
+    for (NodeId id : ast->statements(statements)) {
+        compileStatement(ast->statement(id));
+    }
+}
+
+
+void BytecodeCompiler::compileScope(NodeList statements, Frame frame) {
+    std::uint32_t end = frame.first + frame.count;
+    while (localSlots.size() < end) localSlots.push_back(newSlot());
+    for (std::uint32_t i = frame.first; i < end; i++) emit(Opcode::UNSET, 0, localSlots[i]);
+    compileBlock(statements);
+}
+
+
+void BytecodeCompiler::compileStatement(const Statements* stmt) {
+    // Registers and shared subexpressions belong to one statement. A nested
+    // statement stacks its own above its parent's, whose shared values later
+    // elif conditions may still read.
+    std::uint32_t parentRegisters = nextRegister;
+    std::size_t parentShared = sharedBase;
+    sharedBase = sharedRegisters.size();
+
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: {
+            auto* decl = static_cast<const VarDecl*>(stmt);
+            std::uint32_t global = variable(decl->depth, decl->slot, decl->name);
+            emit(Opcode::DECLARE, stmt->offset, global, decl->name);
+            const Expressions* value = ast->expression(decl->value);
+            std::uint32_t r = compileExpression(value);
+            switch (value->type) {
+                case ValueType::INT: emit(Opcode::SET_INT, stmt->offset, global, r); break;
+                case ValueType::DOUBLE: emit(Opcode::SET_DOUBLE, stmt->offset, global, r); break;
+                case ValueType::BOOL: emit(Opcode::SET_BOOL, stmt->offset, global, r); break;
+                default: emit(Opcode::SET_STRING, stmt->offset, global, r); break;
+            }
+            break;
+        }
+        case NodeKind::ASSIGNMENT: {
+            auto* assignment = static_cast<const Assignment*>(stmt);
+            std::uint32_t global = variable(assignment->depth, assignment->slot, assignment->name);
+            emit(Opcode::ASSIGNABLE, stmt->offset, global, assignment->name);
+            const Expressions* value = ast->expression(assignment->value);
+            std::uint32_t r = compileExpression(value);
+            switch (value->type) {
+                case ValueType::INT: emit(Opcode::SET_INT, stmt->offset, global, r); break;
+                case ValueType::DOUBLE: emit(Opcode::SET_DOUBLE, stmt->offset, global, r); break;
+                case ValueType::BOOL: emit(Opcode::SET_BOOL, stmt->offset, global, r); break;
+                default: emit(Opcode::SET_STRING, stmt->offset, global, r); break;
+            }
+            break;
+        }
+        case NodeKind::OUT: {
+            for (NodeId id : ast->expressions(static_cast<const OutStatement*>(stmt)->outputs)) {
+                const Expressions* expr = ast->expression(id);
+                if (expr->type == ValueType::ENDL) {
+                    emit(Opcode::FAIL, expr->offset, constant(Value("Unknown literal type: endl")));
+                    continue;
+                }
+                if (auto* literal = nodeCast<Literal>(expr); literal && expr->type == ValueType::STRING) {
+                    emit(Opcode::OUT_TEXT, expr->offset, constant(ast->stringValue(literal->constant)));
+                    continue;
+                }
+                if (isConcat(expr)) {
+                    // Written piece by piece, once all are evaluated, as the
+                    // tree walker does
+                    std::vector<std::uint32_t> pieces;
+                    compilePieces(expr, pieces);
+                    for (std::uint32_t piece : pieces) {
+                        if (piece & CONSTANT_PIECE) emit(Opcode::OUT_TEXT, expr->offset, piece & ~CONSTANT_PIECE);
+                        else emit(Opcode::OUT_STRING, expr->offset, piece);
+                    }
+                    continue;
+                }
+                std::uint32_t r = compileExpression(expr);
+                switch (expr->type) {
+                    case ValueType::INT: emit(Opcode::OUT_INT, expr->offset, r); break;
+                    case ValueType::DOUBLE: emit(Opcode::OUT_DOUBLE, expr->offset, r); break;
+                    case ValueType::BOOL: emit(Opcode::OUT_BOOL, expr->offset, r); break;
+                    default: emit(Opcode::OUT_STRING, expr->offset, r); break;
+                }
+            }
+            emit(Opcode::OUT_END, stmt->offset);
+            break;
+        }
+        case NodeKind::IN: {
+            auto* in = static_cast<const InStatement*>(stmt);
+            emit(Opcode::IN, stmt->offset, variable(in->depth, in->slot, in->varName), static_cast<std::uint32_t>(in->type));
+            break;
+        }
+        case NodeKind::IF: {
+            auto* branch = static_cast<const IfStatement*>(stmt);
+
+            // Each condition jumps over its body when false; each body jumps
+            // to the end of the chain. Until the end is known, those jumps
+            // are chained through their targets, the last one first.
+            std::uint32_t toEnd = NO_JUMP;
+            auto conditional = [&](NodeId condition, NodeList body, Frame frame) {
+                std::uint32_t r = compileExpression(ast->expression(condition));
+                std::uint32_t skip = emit(Opcode::JUMP_IF_FALSE, stmt->offset, r);
+                compileScope(body, frame);
+                toEnd = emit(Opcode::JUMP, stmt->offset, toEnd);
+                unit.code[skip].b = static_cast<std::uint32_t>(unit.code.size());
+            };
+            conditional(branch->condition, branch->ifBranch, branch->ifFrame);
+            for (const ElifBranch& elif : ast->elifs(branch->elifBranches)) {
+                conditional(elif.condition, elif.body, elif.frame);
+            }
+            compileScope(branch->elseBranch, branch->elseFrame);
+            while (toEnd != NO_JUMP) {
+                std::uint32_t previous = unit.code[toEnd].a;
+                unit.code[toEnd].a = static_cast<std::uint32_t>(unit.code.size());
+                toEnd = previous;
+            }
+            break;
+        }
+        default:
+            emit(Opcode::FAIL, stmt->offset, constant(Value("Unknown statement during execution")));
+            break;
+    }
+
+    nextRegister = parentRegisters;
+    sharedRegisters.resize(sharedBase);
+    sharedBase = parentShared;
+}
+
+
+static Opcode opcode(Operation operation) {
+    switch (operation) {
+        case Operation::ADD_INT: return Opcode::ADD_INT;
+        case Operation::SUB_INT: return Opcode::SUB_INT;
+        case Operation::MUL_INT: return Opcode::MUL_INT;
+        case Operation::DIV_INT: return Opcode::DIV_INT;
+        case Operation::MOD_INT: return Opcode::MOD_INT;
+        case Operation::EQ_INT: return Opcode::EQ_INT;
+        case Operation::NE_INT: return Opcode::NE_INT;
+        case Operation::LT_INT: return Opcode::LT_INT;
+        case Operation::GT_INT: return Opcode::GT_INT;
+        case Operation::LE_INT: return Opcode::LE_INT;
+        case Operation::GE_INT: return Opcode::GE_INT;
+        case Operation::ADD_DOUBLE: return Opcode::ADD_DOUBLE;
+        case Operation::SUB_DOUBLE: return Opcode::SUB_DOUBLE;
+        case Operation::MUL_DOUBLE: return Opcode::MUL_DOUBLE;
+        case Operation::DIV_DOUBLE: return Opcode::DIV_DOUBLE;
+        case Operation::EQ_DOUBLE: return Opcode::EQ_DOUBLE;
+        case Operation::NE_DOUBLE: return Opcode::NE_DOUBLE;
+        case Operation::LT_DOUBLE: return Opcode::LT_DOUBLE;
+        case Operation::GT_DOUBLE: return Opcode::GT_DOUBLE;
+        case Operation::LE_DOUBLE: return Opcode::LE_DOUBLE;
+        case Operation::GE_DOUBLE: return Opcode::GE_DOUBLE;
+        case Operation::EQ_STRING: return Opcode::EQ_STRING;
+        case Operation::NE_STRING: return Opcode::NE_STRING;
+        case Operation::AND: return Opcode::AND;
+        case Operation::OR: return Opcode::OR;
+        case Operation::EQ_BOOL: return Opcode::EQ_BOOL;
+        default: return Opcode::NE_BOOL;
+    }
+}
+
+
+std::uint32_t BytecodeCompiler::compileExpression(const Expressions* expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            auto* literal = static_cast<const Literal*>(expr);
+            std::uint32_t r = newRegister();
+            switch (literal->type) {
+                case ValueType::INT:
+                    emit(Opcode::LOAD_INT, expr->offset, r, static_cast<std::uint32_t>(literal->intValue));
+                    break;
+                case ValueType::DOUBLE: {
+                    std::uint64_t bits;
+                    std::memcpy(&bits, &literal->doubleValue, sizeof bits);
+                    emit(Opcode::LOAD_DOUBLE, expr->offset, r, static_cast<std::uint32_t>(bits),
+                         static_cast<std::uint32_t>(bits >> 32));
+                    break;
+                }
+                case ValueType::BOOL:
+                    emit(Opcode::LOAD_BOOL, expr->offset, r, literal->boolValue);
+                    break;
+                default:
+                    emit(Opcode::LOAD_STRING, expr->offset, r, constant(ast->stringValue(literal->constant)));
+                    break;
+            }
+            return r;
+        }
+        case NodeKind::VAR: {
+            auto* var = static_cast<const VarExpr*>(expr);
+            std::uint32_t r = newRegister();
+            Opcode op = expr->type == ValueType::INT ? Opcode::GET_INT
+                      : expr->type == ValueType::DOUBLE ? Opcode::GET_DOUBLE
+                      : expr->type == ValueType::BOOL ? Opcode::GET_BOOL
+                      : Opcode::GET_STRING;
+            emit(op, expr->offset, r, variable(var->depth, var->slot, var->name), var->name);
+            return r;
+        }
+        case NodeKind::BINARY:
+            return compileBinary(static_cast<const BinExpr*>(expr));
+        case NodeKind::UNARY: {
+            auto* unary = static_cast<const UnaryExpr*>(expr);
+            std::uint32_t operand = compileExpression(ast->expression(unary->getExpr()));
+            std::uint32_t r = newRegister();
+            Opcode op = unary->getOp() == UnaryOp::NOT ? Opcode::NOT
+                      : expr->type == ValueType::INT ? Opcode::NEGATE_INT
+                      : Opcode::NEGATE_DOUBLE;
+            emit(op, expr->offset, r, operand);
+            return r;
+        }
+        case NodeKind::SHARED: {
+            // The first occurrence in evaluation order computes the value,
+            // later ones read its register
+            auto* shared = static_cast<const SharedExpr*>(expr);
+            std::size_t index = sharedBase + shared->slot;
+            if (index >= sharedRegisters.size()) sharedRegisters.resize(index + 1, NO_REGISTER);
+            if (sharedRegisters[index] == NO_REGISTER) {
+                std::uint32_t r = compileExpression(ast->expression(shared->expr));
+                sharedRegisters[index] = r;
+            }
+            return sharedRegisters[index];
+        }
+        default:
+            break;
+    }
+    std::uint32_t r = newRegister();
+    emit(Opcode::FAIL, expr->offset, constant(Value("Unknown expression type.")));
+    return r;
+}
+
+
+std::uint32_t BytecodeCompiler::compileDouble(const Expressions* expr) {
+    std::uint32_t r = compileExpression(expr);
+    if (expr->type != ValueType::INT) return r;
+    std::uint32_t widened = newRegister();
+    emit(Opcode::TO_DOUBLE, expr->offset, widened, r);
+    return widened;
+}
+
+
+std::uint32_t BytecodeCompiler::compileBinary(const BinExpr* expr) {
+    if (expr->operation == Operation::CONCAT) {
+        std::vector<std::uint32_t> pieces;
+        compilePieces(expr, pieces);
+        std::uint32_t first = static_cast<std::uint32_t>(unit.pieces.size());
+        unit.pieces.insert(unit.pieces.end(), pieces.begin(), pieces.end());
+        std::uint32_t result = newRegister();
+        emit(Opcode::JOIN, expr->offset, result, first, static_cast<std::uint32_t>(pieces.size()));
+        return result;
+    }
+
+    const Expressions* left = ast->expression(expr->left);
+    const Expressions* right = ast->expression(expr->right);
+    std::uint32_t l, r;
+    if (expr->operands == ValueType::DOUBLE) {
+        l = compileDouble(left);
+        r = compileDouble(right);
+    } else {
+        l = compileExpression(left);
+        r = compileExpression(right);
+    }
+    std::uint32_t result = newRegister();
+    emit(opcode(expr->operation), expr->offset, result, l, r);
+    return result;
+}
+
+
+// String literals are used in place, not loaded into a register first
+void BytecodeCompiler::compilePieces(const Expressions* expr, std::vector<std::uint32_t>& pieces) {
+    if (isConcat(expr)) {
+        auto* binary = static_cast<const BinExpr*>(expr);
+        compilePieces(ast->expression(binary->left), pieces);
+        compilePieces(ast->expression(binary->right), pieces);
+    } else if (auto* literal = nodeCast<Literal>(expr)) {
+        pieces.push_back(CONSTANT_PIECE | constant(ast->stringValue(literal->constant)));
+    } else {
+        pieces.push_back(compileExpression(expr));
+    }
+}
+
+
+std::uint32_t BytecodeCompiler::emit(Opcode op, std::uint32_t offset, std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+    unit.code.push_back(Instruction{op, a, b, c});
+    unit.offsets.push_back(offset);
+    return static_cast<std::uint32_t>(unit.code.size() - 1);
+}
+
+std::uint32_t BytecodeCompiler::slot(Symbol name) {
+    if (const std::uint32_t* existing = slots.find(name)) return *existing;
+    std::uint32_t index = newSlot();
+    slots[name] = index;
+    return index;
+}
+
+std::uint32_t BytecodeCompiler::variable(std::uint32_t depth, std::uint32_t local, Symbol name) {
+    return depth > 0 ? localSlots[local] : slot(name);
+}
+
+std::uint32_t BytecodeCompiler::newSlot() {
+    return unit.slots++;
+}
+
+std::uint32_t BytecodeCompiler::newRegister() {
+    std::uint32_t r = nextRegister++;
+    if (nextRegister > unit.registers) unit.registers = nextRegister;
+    return r;
+}
+
+std::uint32_t BytecodeCompiler::constant(Value text) {
+    unit.strings.push_back(std::move(text));
+    return static_cast<std::uint32_t>(unit.strings.size() - 1);
+}
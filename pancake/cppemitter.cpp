@@ -0,0 +1,666 @@
+#include "./headers/cppemitter.h"
+#include "./headers/astvisitor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+// Written at the top of every program. It does what Output and Input do
+// for the interpreter, in the same formats, so the output is the same byte
+// for byte.
+static const char RUNTIME[] = R"PANCAKE(// Compiled from a Pancake script
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+namespace pk {
+
+#ifdef _WIN32
+inline bool isTerminal(int fd) { return _isatty(fd) != 0; }
+inline long readInput(char* data, std::size_t size) { return _read(0, data, static_cast<unsigned>(size)); }
+#else
+inline bool isTerminal(int fd) { return isatty(fd) != 0; }
+inline long readInput(char* data, std::size_t size) {
+    for (;;) {
+        long got = static_cast<long>(read(0, data, size));
+        if (got >= 0 || errno != EINTR) return got;
+    }
+}
+#endif
+
+// Out of line, so the many calls stay small
+#ifdef __GNUC__
+__attribute__((noinline, cold))
+#endif
+[[noreturn]] inline void fail(int line, int column, const char* message) {
+    throw std::runtime_error("Runtime Error at line " + std::to_string(line) + ", column " +
+                             std::to_string(column) + ": " + message);
+}
+
+// Buffered a line at a time on a terminal, else in blocks; main() makes
+// stdout unbuffered, so each flush is one write
+class Output {
+public:
+    void write(std::string_view text) {
+        if (text.size() > CAPACITY - used) {
+            flush();
+            if (text.size() > CAPACITY) {
+                std::fwrite(text.data(), 1, text.size(), stdout);
+                return;
+            }
+        }
+        std::memcpy(buffer + used, text.data(), text.size());
+        used += text.size();
+    }
+    void write(int value) {
+        if (CAPACITY - used < NUMBER_WIDTH) flush();
+        used = static_cast<std::size_t>(std::to_chars(buffer + used, buffer + CAPACITY, value).ptr - buffer);
+    }
+    void write(double value) {   // as printf("%g")
+        if (CAPACITY - used < NUMBER_WIDTH) flush();
+        used = static_cast<std::size_t>(
+            std::to_chars(buffer + used, buffer + CAPACITY, value, std::chars_format::general, 6).ptr - buffer);
+    }
+    void write(bool value) { write(value ? "true"sv : "false"sv); }
+    void endLine() {
+        if (used == CAPACITY) flush();
+        buffer[used++] = '\n';
+        if (lineBuffered) flush();
+    }
+    void flush() {
+        if (used > 0) std::fwrite(buffer, 1, used, stdout);
+        used = 0;
+    }
+
+private:
+    static const std::size_t CAPACITY = 1 << 16;
+    static const std::size_t NUMBER_WIDTH = 32;
+    char buffer[CAPACITY];
+    std::size_t used = 0;
+    bool lineBuffered = isTerminal(1);
+};
+
+// Lines for `in` statements, read from stdin in large blocks
+class Input {
+public:
+    // The next line, without its '\n', as std::getline() gives it; valid
+    // until the next call. False at the end of the input.
+    bool next(std::string_view& line) {
+        for (;;) {
+            const char* start = data.data() + position;
+            const void* end = std::memchr(start, '\n', data.size() - position);
+            if (end) {
+                line = std::string_view(start, static_cast<const char*>(end) - start);
+                position += line.size() + 1;
+                return true;
+            }
+            if (finished) {
+                if (position == data.size()) return false;
+                line = std::string_view(start, data.size() - position);
+                position = data.size();
+                return true;
+            }
+            data.erase(0, position);
+            position = 0;
+            std::size_t kept = data.size();
+            data.resize(kept + BLOCK);
+            long got = readInput(&data[kept], BLOCK);
+            data.resize(kept + (got > 0 ? static_cast<std::size_t>(got) : 0));
+            finished = got <= 0;
+        }
+    }
+
+private:
+    static const std::size_t BLOCK = 1 << 16;
+    std::string data;
+    std::size_t position = 0;
+    bool finished = false;
+};
+
+// As std::stoi() / std::stod(), exceptions included
+inline bool plainNumber(std::string_view text) {
+    return !text.empty() && text[0] != '+' && !std::isspace(static_cast<unsigned char>(text[0]));
+}
+
+inline int toInt(std::string_view text) {
+    if (plainNumber(text)) {
+        int value;
+        if (std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc()) return value;
+    }
+    return std::stoi(std::string(text));
+}
+
+inline double toDouble(std::string_view text) {
+    if (plainNumber(text)) {
+        double value;
+        const char* last = text.data() + text.size();
+        auto result = std::from_chars(text.data(), last, value);
+        if (result.ec == std::errc() && (result.ptr == last || (*result.ptr != 'x' && *result.ptr != 'X'))) {
+            std::string_view read = text.substr(0, result.ptr - text.data());
+            if (std::isnormal(value) || (value == 0 && read.find_first_of("eE") == std::string_view::npos)) return value;
+        }
+    }
+    return std::stod(std::string(text));
+}
+
+inline double fromBits(std::uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof value);
+    return value;
+}
+
+// Int division as the interpreter does it (divideInt()): INT_MIN / -1
+// wraps instead of trapping
+inline int divide(int l, int r) { return r == -1 ? static_cast<int>(0u - static_cast<unsigned>(l)) : l / r; }
+inline int remainder(int l, int r) { return r == -1 ? 0 : l % r; }
+
+inline std::string join(std::initializer_list<std::string_view> pieces) {
+    std::size_t length = 0;
+    for (std::string_view piece : pieces) length += piece.size();
+    std::string joined;
+    joined.reserve(length);
+    for (std::string_view piece : pieces) joined += piece;
+    return joined;
+}
+
+inline Output out;
+inline Input in;
+
+} // namespace pk
+
+)PANCAKE";
+
+static const char* cppType(ValueType type) {
+    switch (type) {
+        case ValueType::INT: return "int";
+        case ValueType::DOUBLE: return "double";
+        case ValueType::BOOL: return "bool";
+        default: return "std::string";
+    }
+}
+
+static const char* operatorText(Operation operation) {
+    switch (operation) {
+        case Operation::ADD_INT: case Operation::ADD_DOUBLE: return "+";
+        case Operation::SUB_INT: case Operation::SUB_DOUBLE: return "-";
+        case Operation::MUL_INT: case Operation::MUL_DOUBLE: return "*";
+        case Operation::DIV_INT: case Operation::DIV_DOUBLE: return "/";
+        case Operation::MOD_INT: return "%";
+        case Operation::EQ_INT: case Operation::EQ_DOUBLE: case Operation::EQ_BOOL: case Operation::EQ_STRING: return "==";
+        case Operation::NE_INT: case Operation::NE_DOUBLE: case Operation::NE_BOOL: case Operation::NE_STRING: return "!=";
+        case Operation::LT_INT: case Operation::LT_DOUBLE: return "<";
+        case Operation::GT_INT: case Operation::GT_DOUBLE: return ">";
+        case Operation::LE_INT: case Operation::LE_DOUBLE: return "<=";
+        case Operation::GE_INT: case Operation::GE_DOUBLE: return ">=";
+        case Operation::AND: return "&&";   // both sides are evaluated by then
+        default: return "||";
+    }
+}
+
+// A temporary holding a string it owns, which a store may take over
+static bool isTemp(const std::string& name) {
+    return name.size() > 1 && name[0] == 't' && name[1] >= '0' && name[1] <= '9';
+}
+
+
+std::string CppEmitter::emit(const Ast& tree, NodeList program, std::string_view text) {
+    ast = &tree;
+    source = text;
+    lines.reset();
+    body.clear();
+    variables.clear();
+    sharedTemps.clear();
+    sharedBase = 0;
+    definitelySet.clear();
+    possiblySet.clear();
+    nextTemp = 0;
+
+    std::uint32_t functions = 0;
+    for (std::uint32_t done = 0; done < program.count; done += STATEMENTS_PER_FUNCTION, functions++) {
+        std::uint32_t count = program.count - done;
+        if (count > STATEMENTS_PER_FUNCTION) count = STATEMENTS_PER_FUNCTION;
+        body += "static void part" + std::to_string(functions) + "() {\n";
+        depth = 1;
+        emitBlock(NodeList{program.first + done, count});
+        body += "}\n\n";
+    }
+
+    std::string code = RUNTIME;
+    code += "// ---- Program ----\n\n";
+    for (const std::string& declaration : variables) code += declaration + "\n";
+    if (!variables.empty()) code += "\n";
+    code += body;
+    code += "int main() {\n";
+    code += "    std::setvbuf(stdout, nullptr, _IONBF, 0);\n";
+    code += "    try {\n";
+    for (std::uint32_t i = 0; i < functions; i++) code += "        part" + std::to_string(i) + "();\n";
+    code += "    } catch (const std::exception& e) {\n";
+    code += "        pk::out.flush();\n";
+    code += "        std::cerr << \"Error: \" << e.what() << '\\n';\n";
+    code += "    }\n";
+    code += "    pk::out.flush();\n";
+    code += "    return 0;\n";
+    code += "}\n";
+    ast = nullptr;
+    return code;
+}
+
+
+void CppEmitter::line(const std::string& text) {
+    body.append(static_cast<std::size_t>(depth) * 4, ' ');
+    body += text;
+    body += '\n';
+}
+
+std::string CppEmitter::failure(std::uint32_t offset, const std::string& message) {
+    SourceLocation loc = lines.locate(source, offset);
+    return "pk::fail(" + std::to_string(loc.line) + ", " + std::to_string(loc.column) + ", " + quote(message) + ");";
+}
+
+void CppEmitter::fail(std::uint32_t offset, const std::string& message) {
+    line(failure(offset, message));
+}
+
+void CppEmitter::requireSet(const std::string& flag, std::uint32_t offset, const std::string& message) {
+    if (definitelySet.count(flag)) return;
+    line("if (!" + flag + ") " + failure(offset, message));
+    definitelySet.insert(flag);
+}
+
+void CppEmitter::markSet(const std::string& flag) {
+    line(flag + " = true;");
+    definitelySet.insert(flag);
+    possiblySet.insert(flag);
+}
+
+std::string CppEmitter::temp(const char* type, const std::string& value) {
+    std::string name = "t" + std::to_string(nextTemp++);
+    line(std::string(type) + " " + name + " = " + value + ";");
+    return name;
+}
+
+std::string CppEmitter::variable(std::uint32_t depth, std::uint32_t slot, Symbol name, ValueType type) {
+    const char* suffix = type == ValueType::INT ? "_int"
+                       : type == ValueType::DOUBLE ? "_double"
+                       : type == ValueType::BOOL ? "_bool"
+                       : "_string";
+    std::string id = depth > 0 ? "l" + std::to_string(slot) + suffix : "g_" + symbolName(name) + suffix;
+    variables.insert("static " + std::string(cppType(type)) + " " + id + ";");
+    return id;
+}
+
+std::string CppEmitter::flag(std::uint32_t depth, std::uint32_t slot, Symbol name) {
+    std::string id = depth > 0 ? "l" + std::to_string(slot) + "_set" : "g_" + symbolName(name) + "_set";
+    variables.insert("static bool " + id + ";");
+    return id;
+}
+
+
+void CppEmitter::emitBlock(NodeList statements) {
+    for (NodeId id : ast->statements(statements)) {
+        emitStatement(ast->statement(id));
+    }
+}
+
+void CppEmitter::emitScope(NodeList statements, Frame frame) {
+    for (std::uint32_t i = frame.first; i < frame.first + frame.count; i++) {
+        std::string cleared = flag(1, i, 0);
+        if (possiblySet.erase(cleared)) line(cleared + " = false;");
+        definitelySet.erase(cleared);
+    }
+    emitBlock(statements);
+}
+
+void CppEmitter::emitStatement(const Statements* stmt) {
+    // Temporaries and shared subexpressions belong to one statement, as
+    // registers do in BytecodeCompiler
+    std::size_t parentShared = sharedBase;
+    sharedBase = sharedTemps.size();
+    line("{");
+    depth++;
+
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: {
+            auto* decl = static_cast<const VarDecl*>(stmt);
+            std::string set = flag(decl->depth, decl->slot, decl->name);
+            if (possiblySet.count(set)) line("if (" + set + ") " + failure(stmt->offset, "Variable already declared: " + symbolName(decl->name)));
+            emitStore(decl->depth, decl->slot, decl->name, ast->expression(decl->value));
+            markSet(set);
+            break;
+        }
+        case NodeKind::ASSIGNMENT: {
+            auto* assignment = static_cast<const Assignment*>(stmt);
+            requireSet(flag(assignment->depth, assignment->slot, assignment->name), stmt->offset,
+                       "Assignment to undeclared variable: " + symbolName(assignment->name));
+            emitStore(assignment->depth, assignment->slot, assignment->name, ast->expression(assignment->value));
+            break;
+        }
+        case NodeKind::OUT: {
+            for (NodeId id : ast->expressions(static_cast<const OutStatement*>(stmt)->outputs)) {
+                const Expressions* expr = ast->expression(id);
+                if (expr->type == ValueType::ENDL) {
+                    fail(expr->offset, "Unknown literal type: endl");
+                    continue;
+                }
+                if (isConcat(expr)) {
+                    // Written piece by piece, once all are evaluated
+                    std::vector<std::string> pieces;
+                    emitPieces(expr, pieces);
+                    for (const std::string& piece : pieces) line("pk::out.write(" + piece + ");");
+                    continue;
+                }
+                line("pk::out.write(" + emitExpression(expr) + ");");
+            }
+            line("pk::out.endLine();");
+            break;
+        }
+        case NodeKind::IN: {
+            auto* in = static_cast<const InStatement*>(stmt);
+            line("std::string_view line;");
+            line("if (!pk::in.next(line)) " + failure(stmt->offset, "Failed to read input"));
+            std::string var = variable(in->depth, in->slot, in->varName, in->type);
+            if (in->type == ValueType::INT) line(var + " = pk::toInt(line);");
+            else if (in->type == ValueType::DOUBLE) line(var + " = pk::toDouble(line);");
+            else line(var + " = line;");
+            markSet(flag(in->depth, in->slot, in->varName));
+            break;
+        }
+        case NodeKind::IF: {
+            // Each elif is tested in the else block of the one before, so
+            // it can still read the shared values of earlier conditions
+            // What a branch finds set is only known inside it, and what it
+            // clears may still be set after it
+            auto* branch = static_cast<const IfStatement*>(stmt);
+            int opened = 0;
+            std::unordered_set<std::string> known;
+            std::unordered_set<std::string> possibly = possiblySet;
+            auto conditional = [&](NodeId condition, NodeList body, Frame frame) {
+                line("if (" + emitExpression(ast->expression(condition)) + ") {");
+                if (opened == 0) known = definitelySet;
+                std::unordered_set<std::string> atCondition = definitelySet;
+                depth++;
+                emitScope(body, frame);
+                definitelySet = atCondition;
+                depth--;
+                line("} else {");
+                depth++;
+                opened++;
+            };
+            conditional(branch->condition, branch->ifBranch, branch->ifFrame);
+            for (const ElifBranch& elif : ast->elifs(branch->elifBranches)) {
+                conditional(elif.condition, elif.body, elif.frame);
+            }
+            emitScope(branch->elseBranch, branch->elseFrame);
+            definitelySet = known;
+            possiblySet.insert(possibly.begin(), possibly.end());
+            for (; opened > 0; opened--) {
+                depth--;
+                line("}");
+            }
+            break;
+        }
+        default:
+            fail(stmt->offset, "Unknown statement during execution");
+            break;
+    }
+
+    depth--;
+    line("}");
+    sharedTemps.resize(sharedBase);
+    sharedBase = parentShared;
+}
+
+void CppEmitter::emitStore(std::uint32_t depth, std::uint32_t slot, Symbol name, const Expressions* value) {
+    if (value->type == ValueType::ENDL) {
+        fail(value->offset, "Unknown literal type: endl");
+        return;
+    }
+    std::string result = emitExpression(value);
+    std::string var = variable(depth, slot, name, value->type);
+    if (value->type == ValueType::STRING && isTemp(result)) line(var + " = std::move(" + result + ");");
+    else line(var + " = " + result + ";");
+}
+
+
+std::string CppEmitter::emitExpression(const Expressions* expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            auto* literal = static_cast<const Literal*>(expr);
+            switch (literal->type) {
+                case ValueType::INT: return intLiteral(literal->intValue);
+                case ValueType::DOUBLE: return doubleLiteral(literal->doubleValue);
+                case ValueType::BOOL: return literal->boolValue ? "true" : "false";
+                case ValueType::STRING: return quote(ast->text(literal->value)) + "sv";
+                default:
+                    fail(expr->offset, "Unknown literal type: endl");
+                    return "0";
+            }
+        }
+        case NodeKind::VAR: {
+            auto* var = static_cast<const VarExpr*>(expr);
+            requireSet(flag(var->depth, var->slot, var->name), expr->offset, "Undefined variable: " + symbolName(var->name));
+            return variable(var->depth, var->slot, var->name, expr->type);
+        }
+        case NodeKind::BINARY:
+            return emitBinary(static_cast<const BinExpr*>(expr));
+        case NodeKind::UNARY: {
+            auto* unary = static_cast<const UnaryExpr*>(expr);
+            std::string operand = emitExpression(ast->expression(unary->getExpr()));
+            return temp(cppType(expr->type), (unary->getOp() == UnaryOp::NOT ? "!" : "-") + operand);
+        }
+        case NodeKind::SHARED: {
+            // Computed where it first occurs in evaluation order
+            auto* shared = static_cast<const SharedExpr*>(expr);
+            std::size_t index = sharedBase + shared->slot;
+            if (index >= sharedTemps.size()) sharedTemps.resize(index + 1);
+            if (sharedTemps[index].empty()) sharedTemps[index] = emitExpression(ast->expression(shared->expr));
+            return sharedTemps[index];
+        }
+        default:
+            break;
+    }
+    fail(expr->offset, "Unknown expression type.");
+    return "0";
+}
+
+std::string CppEmitter::emitDouble(const Expressions* expr) {
+    std::string value = emitExpression(expr);
+    if (expr->type != ValueType::INT) return value;
+    return "static_cast<double>(" + value + ")";
+}
+
+std::string CppEmitter::emitBinary(const BinExpr* expr) {
+    if (expr->operation == Operation::CONCAT) {
+        std::vector<std::string> pieces;
+        emitPieces(expr, pieces);
+        std::string list;
+        for (const std::string& piece : pieces) list += (list.empty() ? "" : ", ") + piece;
+        return temp("std::string", "pk::join({" + list + "})");
+    }
+
+    const Expressions* left = ast->expression(expr->left);
+    const Expressions* right = ast->expression(expr->right);
+    std::string l, r;
+    if (expr->operands == ValueType::DOUBLE) {
+        l = emitDouble(left);
+        r = emitDouble(right);
+    } else {
+        l = emitExpression(left);
+        r = emitExpression(right);
+    }
+    if (expr->operation == Operation::DIV_INT || expr->operation == Operation::DIV_DOUBLE ||
+        expr->operation == Operation::MOD_INT) {
+        line("if (" + r + " == 0) " + failure(expr->offset, expr->operation == Operation::MOD_INT ? "Modulo by zero" : "Division by zero"));
+    }
+    if (expr->operation == Operation::DIV_INT) return temp("int", "pk::divide(" + l + ", " + r + ")");
+    if (expr->operation == Operation::MOD_INT) return temp("int", "pk::remainder(" + l + ", " + r + ")");
+    return temp(cppType(expr->type), l + " " + operatorText(expr->operation) + " " + r);
+}
+
+void CppEmitter::emitPieces(const Expressions* expr, std::vector<std::string>& pieces) {
+    if (isConcat(expr)) {
+        auto* binary = static_cast<const BinExpr*>(expr);
+        emitPieces(ast->expression(binary->left), pieces);
+        emitPieces(ast->expression(binary->right), pieces);
+    } else {
+        pieces.push_back(emitExpression(expr));
+    }
+}
+
+
+// Every byte that is not plain printable ASCII is an octal escape of three
+// digits, which cannot run on into the next character
+std::string CppEmitter::quote(std::string_view text) {
+    static const char digits[] = "01234567";
+    std::string quoted = "\"";
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (byte >= 0x20 && byte < 0x7F && c != '?') {
+            quoted += c;
+        } else {
+            quoted += '\\';
+            quoted += digits[byte >> 6];
+            quoted += digits[(byte >> 3) & 7];
+            quoted += digits[byte & 7];
+        }
+    }
+    return quoted + "\"";
+}
+
+std::string CppEmitter::intLiteral(int value) {
+    if (value == INT_MIN) return "(-2147483647 - 1)";
+    if (value < 0) return "(" + std::to_string(value) + ")";
+    return std::to_string(value);
+}
+
+// The shortest text that reads back as the same double; values with no
+// literal spelled by their bits
+std::string CppEmitter::doubleLiteral(double value) {
+    if (!std::isfinite(value)) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof bits);
+        return "pk::fromBits(" + std::to_string(bits) + "ull)";
+    }
+    char text[32];
+    std::string literal(text, std::to_chars(text, text + sizeof text, value).ptr);
+    if (literal.find_first_of(".e") == std::string::npos) literal += ".0";
+    return value < 0 ? "(" + literal + ")" : literal;
+}
+
+
+// ---- Building ----
+
+// Quoted for the shell that std::system() runs
+static std::string shellArgument(const std::string& text) {
+#ifdef _WIN32
+    return "\"" + text + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+#endif
+}
+
+// A new file for the translated program in the temporary directory, made
+// with exclusive creation so a file or symlink already at the name is never
+// written through. Returns its descriptor and name, or -1.
+static int createSource(std::string& path) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path directory = fs::temp_directory_path(ec);
+    if (ec) return -1;
+#ifdef _WIN32
+    std::random_device random;
+    for (int attempt = 0; attempt < 100; attempt++) {
+        path = (directory / ("pancake-" + std::to_string(random()) + ".cpp")).string();
+        int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if (fd >= 0 || errno != EEXIST) return fd;
+    }
+    return -1;
+#else
+    path = (directory / "pancake-XXXXXX.cpp").string();
+    return mkstemps(&path[0], 4);
+#endif
+}
+
+static bool writeSource(int fd, const std::string& code) {
+    const char* data = code.data();
+    std::size_t size = code.size();
+    while (size > 0) {
+#ifdef _WIN32
+        int written = _write(fd, data, size > 0x40000000 ? 0x40000000u : static_cast<unsigned>(size));
+#else
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+#endif
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool CppEmitter::compile(const std::string& code, const std::string& output) {
+    std::string file;
+    int fd = createSource(file);
+    if (fd < 0) {
+        std::cerr << "Error: Could not create a temporary file for the C++ program\n";
+        return false;
+    }
+    bool written = writeSource(fd, code);
+#ifdef _WIN32
+    written = _close(fd) == 0 && written;
+#else
+    written = ::close(fd) == 0 && written;
+#endif
+    std::error_code ec;
+    if (!written) {
+        std::cerr << "Error: Could not write '" << file << "'\n";
+        std::filesystem::remove(file, ec);
+        return false;
+    }
+    const char* compiler = std::getenv("CXX");
+    std::string command = std::string(compiler && *compiler ? compiler : "c++") + " -std=c++17 -O2 -o " +
+                          shellArgument(output) + " " + shellArgument(file);
+    int status = std::system(command.c_str());
+    std::filesystem::remove(file, ec);
+    return status == 0;
+}
@@ -0,0 +1,457 @@
+#include "./headers/document.h"
+#include "./headers/tokeniser.h"
+#include "./headers/parser.h"
+#include "./headers/syntaxerror.h"
+
+#include "./headers/astvisitor.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+// Move every node of a statement by `delta` bytes
+static void shiftExpression(Ast& ast, NodeId id, std::int64_t delta) {
+    Expressions* expr = ast.expression(id);
+    expr->offset = static_cast<std::uint32_t>(expr->offset + delta);
+    if (auto* b = nodeCast<BinExpr>(expr)) {
+        shiftExpression(ast, b->left, delta);
+        shiftExpression(ast, b->right, delta);
+    } else if (auto* u = nodeCast<UnaryExpr>(expr)) {
+        shiftExpression(ast, u->getExpr(), delta);
+    }
+}
+
+static void shiftStatement(Ast& ast, NodeId id, std::int64_t delta) {
+    Statements* stmt = ast.statement(id);
+    stmt->offset = static_cast<std::uint32_t>(stmt->offset + delta);
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL:
+            shiftExpression(ast, static_cast<VarDecl*>(stmt)->value, delta);
+            break;
+        case NodeKind::ASSIGNMENT:
+            shiftExpression(ast, static_cast<Assignment*>(stmt)->value, delta);
+            break;
+        case NodeKind::EXPRESSION_STATEMENT:
+            shiftExpression(ast, static_cast<ExpressionStatement*>(stmt)->expression, delta);
+            break;
+        case NodeKind::OUT:
+            for (NodeId expr : ast.expressions(static_cast<OutStatement*>(stmt)->outputs)) shiftExpression(ast, expr, delta);
+            break;
+        case NodeKind::IF: {
+            auto* f = static_cast<IfStatement*>(stmt);
+            shiftExpression(ast, f->condition, delta);
+            for (NodeId s : ast.statements(f->ifBranch)) shiftStatement(ast, s, delta);
+            for (const ElifBranch& elif : ast.elifs(f->elifBranches)) {
+                shiftExpression(ast, elif.condition, delta);
+                for (NodeId s : ast.statements(elif.body)) shiftStatement(ast, s, delta);
+            }
+            for (NodeId s : ast.statements(f->elseBranch)) shiftStatement(ast, s, delta);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Deep copy of a statement into another Ast, used to compact the tree
+static NodeId cloneExpression(Ast& to, const Ast& from, NodeId id) {
+    const Expressions* expr = from.expression(id);
+    NodeId copy = visit(expr, [&](const auto& node) -> NodeId {
+        using Node = std::decay_t<decltype(node)>;
+        if constexpr (std::is_same_v<Node, Literal>) {
+            Literal copy = node;
+            if (node.type == ValueType::STRING) {
+                copy.constant = to.addString(from.text(node.value));
+                copy.value = to.stringText(copy.constant);
+            } else {
+                copy.value = to.addText(from.text(node.value));
+            }
+            return to.makeExpression<Literal>(copy);
+        } else if constexpr (std::is_same_v<Node, VarExpr>) {
+            return to.makeExpression<VarExpr>(node);
+        } else if constexpr (std::is_same_v<Node, BinExpr>) {
+            NodeId left = cloneExpression(to, from, node.left);
+            NodeId right = cloneExpression(to, from, node.right);
+            BinExpr copy = node;
+            copy.left = left;
+            copy.right = right;
+            return to.makeExpression<BinExpr>(copy);
+        } else if constexpr (std::is_same_v<Node, UnaryExpr>) {
+            return to.makeExpression<UnaryExpr>(node.getOp(), cloneExpression(to, from, node.getExpr()));
+        } else {
+            return to.makeExpression<SharedExpr>(cloneExpression(to, from, node.expr), node.type, node.slot);
+        }
+    });
+    to.expression(copy)->offset = expr->offset;
+    to.expression(copy)->type = expr->type;
+    return copy;
+}
+
+static NodeId cloneStatement(Ast& to, const Ast& from, NodeId id);
+
+static NodeList cloneBlock(Ast& to, const Ast& from, NodeList block) {
+    std::vector<NodeId> ids;
+    for (NodeId s : from.statements(block)) ids.push_back(cloneStatement(to, from, s));
+    return to.addStatements(ids);
+}
+
+static NodeId cloneStatement(Ast& to, const Ast& from, NodeId id) {
+    const Statements* stmt = from.statement(id);
+    NodeId copy = visit(stmt, [&](const auto& node) -> NodeId {
+        using Node = std::decay_t<decltype(node)>;
+        if constexpr (std::is_same_v<Node, VarDecl>) {
+            VarDecl copy = node;
+            copy.value = cloneExpression(to, from, node.value);
+            return to.makeStatement<VarDecl>(copy);
+        } else if constexpr (std::is_same_v<Node, Assignment>) {
+            Assignment copy = node;
+            copy.value = cloneExpression(to, from, node.value);
+            return to.makeStatement<Assignment>(copy);
+        } else if constexpr (std::is_same_v<Node, ExpressionStatement>) {
+            return to.makeStatement<ExpressionStatement>(cloneExpression(to, from, node.expression));
+        } else if constexpr (std::is_same_v<Node, InStatement>) {
+            return to.makeStatement<InStatement>(node);
+        } else if constexpr (std::is_same_v<Node, OutStatement>) {
+            std::vector<NodeId> outputs;
+            for (NodeId expr : from.expressions(node.outputs)) outputs.push_back(cloneExpression(to, from, expr));
+            return to.makeStatement<OutStatement>(to.addExpressions(outputs));
+        } else {
+            NodeId condition = cloneExpression(to, from, node.condition);
+            NodeList ifBranch = cloneBlock(to, from, node.ifBranch);
+            std::vector<ElifBranch> elifs;
+            for (const ElifBranch& elif : from.elifs(node.elifBranches)) {
+                NodeId elifCondition = cloneExpression(to, from, elif.condition);
+                elifs.push_back(ElifBranch{elifCondition, cloneBlock(to, from, elif.body), elif.frame});
+            }
+            IfStatement copy = node;
+            copy.condition = condition;
+            copy.ifBranch = ifBranch;
+            copy.elifBranches = to.addElifs(elifs);
+            copy.elseBranch = cloneBlock(to, from, node.elseBranch);
+            return to.makeStatement<IfStatement>(copy);
+        }
+    });
+    to.statement(copy)->offset = stmt->offset;
+    return copy;
+}
+
+
+// Garbage nodes tolerated on top of the live ones before compacting
+static const std::size_t COMPACT_SLACK = 4096;
+
+
+Document::Document(std::string text) : source(std::move(text)) {
+    rebuild();
+}
+
+void Document::rebuild() {
+    items.clear();
+    declarers.clear();
+    lexError.clear();
+    tree.clear();
+    liveNodes = 0;
+
+    try {
+        Tokeniser lexer(source);
+        lexer.tokenize();
+        tokenBuffer = lexer.getTokens();
+    } catch (const std::exception& e) {
+        lexError = e.what();
+        tokenBuffer.reset(source);
+        lastRelexed = lastReparsed = 0;
+        return;
+    }
+
+    std::set<Symbol> changed;
+    lastRelexed = tokenBuffer.size();
+    lastReparsed = reparse(0, 0, changed);
+}
+
+void Document::setText(const std::string& newText) {
+    std::size_t prefix = 0;
+    std::size_t limit = std::min(source.size(), newText.size());
+    while (prefix < limit && source[prefix] == newText[prefix]) prefix++;
+
+    std::size_t suffix = 0;
+    while (suffix < limit - prefix &&
+           source[source.size() - 1 - suffix] == newText[newText.size() - 1 - suffix]) suffix++;
+
+    TextEdit edit;
+    edit.offset = prefix;
+    edit.removed = source.size() - prefix - suffix;
+    edit.inserted = newText.substr(prefix, newText.size() - prefix - suffix);
+    if (edit.removed == 0 && edit.inserted.empty()) return;
+    applyEdit(edit);
+}
+
+void Document::applyEdit(const TextEdit& edit) {
+    std::size_t at = std::min(edit.offset, source.size());
+    std::size_t removed = std::min(edit.removed, source.size() - at);
+    std::int64_t delta = static_cast<std::int64_t>(edit.inserted.size()) - static_cast<std::int64_t>(removed);
+
+    source.replace(at, removed, edit.inserted);
+    if (!lexError.empty()) {
+        rebuild();
+        return;
+    }
+    tokenBuffer.rebind(source);
+
+    // Re-lex from the start of the edited line. Tokens before `at` are
+    // untouched so their offsets are still valid in the new text.
+    std::size_t lineStart = at == 0 ? std::string::npos : source.rfind('\n', at - 1);
+    lineStart = lineStart == std::string::npos ? 0 : lineStart + 1;
+
+    // First token that ends at or after the line start (token ends are sorted)
+    const std::size_t oldEof = tokenBuffer.size() - 1;
+    std::size_t lo = 0, hi = oldEof;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        Token t = tokenBuffer[mid];
+        if (t.offset + t.length >= lineStart) hi = mid;
+        else lo = mid + 1;
+    }
+    std::size_t first = lo;
+    std::size_t begin = std::min<std::size_t>(lineStart, tokenStart(tokenBuffer[first]));
+
+    // Lex until a new token lines up with an old token from after the
+    // edit; from there on both streams are the same, just shifted.
+    const std::size_t editEnd = at + edit.inserted.size();
+    const std::size_t oldTail = at + removed;   // first unchanged byte, old coordinates
+    std::vector<Token> fresh;
+    std::size_t resync = first;
+    try {
+        Tokeniser lexer(source);
+        lexer.seek(begin);
+        while (true) {
+            Token t = lexer.scanNext();
+            if (t.type == TokenType::END_OF_FILE) {
+                resync = oldEof;
+                break;
+            }
+            if (tokenStart(t) >= editEnd) {
+                while (resync < oldEof &&
+                       (tokenStart(tokenBuffer[resync]) < oldTail || tokenBuffer[resync].offset + delta < t.offset)) {
+                    resync++;
+                }
+                Token old = tokenBuffer[resync];
+                if (resync < oldEof && old.offset + delta == t.offset &&
+                    old.type == t.type && old.length == t.length) {
+                    break;
+                }
+            }
+            fresh.push_back(t);
+        }
+    } catch (const std::exception&) {
+        rebuild();   // records the lexer error as a diagnostic
+        return;
+    }
+
+    std::size_t replaced = resync - first;
+    std::int64_t tokenDelta = static_cast<std::int64_t>(fresh.size()) - static_cast<std::int64_t>(replaced);
+    tokenBuffer.splice(first, replaced, fresh, delta);
+    lastRelexed = fresh.size();
+
+    // Statements after the edit keep their AST; it is shifted lazily
+    std::size_t k = itemAt(first);
+    for (auto& item : items) {
+        if (item->firstToken >= resync) {
+            item->firstToken = static_cast<std::size_t>(item->firstToken + tokenDelta);
+            item->drift += delta;
+        } else if (item->firstToken > first || (item->firstToken == first && replaced > 0)) {
+            item->stale = true;
+        }
+    }
+
+    // The statement before the edit is re-parsed too: the edit may extend
+    // it (an `elif` typed after an `if` block, a removed ';').
+    std::size_t start = k > 0 ? k - 1 : 0;
+    std::set<Symbol> changed;
+    std::size_t count = reparse(start, first + fresh.size(), changed);
+    lastReparsed = count;
+
+    // A declaration that appeared, vanished or changed type affects the
+    // types of later statements that mention that name
+    for (std::size_t i = start + count; i < items.size() && !changed.empty(); ) {
+        const Item& item = *items[i];
+        bool affected = std::any_of(item.names.begin(), item.names.end(),
+            [&](Symbol name) { return changed.count(name) > 0; });
+        if (affected) {
+            std::size_t n = reparse(i, item.firstToken + item.tokenCount, changed);
+            lastReparsed += n;
+            i += n;
+        } else {
+            i++;
+        }
+    }
+
+    if (tree.nodeCount() > 2 * liveNodes + COMPACT_SLACK) compact();
+}
+
+// Index of the item holding `token` (the last one for end of file)
+std::size_t Document::itemAt(std::size_t token) const {
+    auto it = std::upper_bound(items.begin(), items.end(), token,
+        [](std::size_t t, const std::unique_ptr<Item>& item) { return t < item->firstToken; });
+    return it == items.begin() ? 0 : static_cast<std::size_t>(it - items.begin()) - 1;
+}
+
+// Parse items from items[first] until the cursor reaches, at or after
+// token `stableFrom`, the first token of an old item that is still valid.
+// Replaces the old items in between and returns how many were parsed.
+std::size_t Document::reparse(std::size_t first, std::size_t stableFrom, std::set<Symbol>& changedNames) {
+    const std::size_t eof = tokenBuffer.size() - 1;
+    // The first item always starts at token 0, even if text was inserted before it
+    std::size_t pos = first > 0 && first < items.size() ? items[first]->firstToken : 0;
+
+    TypeChecker scope;
+    scope.fallback = [this, first](Symbol name) { return declaredBefore(name, first); };
+
+    std::vector<std::unique_ptr<Item>> parsed;
+    std::size_t next = first;
+    while (pos < eof) {
+        while (next < items.size() && (items[next]->stale || items[next]->firstToken < pos)) next++;
+        if (pos >= stableFrom && next < items.size() && items[next]->firstToken == pos) break;
+
+        parsed.push_back(parseItem(pos, scope));
+        pos = parsed.back()->firstToken + parsed.back()->tokenCount;
+    }
+    if (pos >= eof) next = items.size();
+
+    // Declarations that differ between the old and new items
+    std::vector<std::pair<Symbol, ValueType>> before, after;
+    for (std::size_t i = first; i < next; i++) {
+        const Item* old = items[i].get();
+        liveNodes -= old->nodes;
+        before.insert(before.end(), old->declared.begin(), old->declared.end());
+        for (const auto& decl : old->declared) {
+            auto& list = declarers[decl.first];
+            list.erase(std::remove(list.begin(), list.end(), old), list.end());
+            if (list.empty()) declarers.erase(decl.first);
+        }
+    }
+    for (const auto& item : parsed) {
+        liveNodes += item->nodes;
+        after.insert(after.end(), item->declared.begin(), item->declared.end());
+        for (const auto& decl : item->declared) declarers[decl.first].push_back(item.get());
+    }
+    std::sort(before.begin(), before.end());
+    std::sort(after.begin(), after.end());
+    std::vector<std::pair<Symbol, ValueType>> diff;
+    std::set_symmetric_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(diff));
+    for (const auto& decl : diff) changedNames.insert(decl.first);
+
+    std::size_t count = parsed.size();
+    items.erase(items.begin() + first, items.begin() + next);
+    items.insert(items.begin() + first, std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+    for (std::size_t i = first; i < items.size(); i++) items[i]->ordinal = i;
+    return count;
+}
+
+std::unique_ptr<Document::Item> Document::parseItem(std::size_t start, TypeChecker& scope) {
+    auto item = std::make_unique<Item>();
+    item->firstToken = start;
+
+    // Declarations only reach `scope` if the whole statement parsed
+    TypeChecker local;
+    local.fallback = [&scope](Symbol name) { return scope.getType(name); };
+
+    Parser parser(tokenBuffer, local, tree);
+    parser.seek(start);
+    std::size_t nodesBefore = tree.nodeCount();
+    try {
+        item->statement = parser.parseNext();
+        item->nodes = tree.nodeCount() - nodesBefore;
+        item->tokenCount = parser.position() - start;
+        local.variableTypes.forEach([&](Symbol name, ValueType type) {
+            scope.declare(name, type);
+            item->declared.emplace_back(name, type);
+        });
+    } catch (const SyntaxError& e) {
+        item->statement = NO_NODE;
+        item->error = e.before;
+        item->errorAfter = e.after;
+        item->errorOffset = e.offset;
+        item->errorHasLocation = true;
+        item->tokenCount = recoveryPoint(start, parser.position()) - start;
+    } catch (const std::exception& e) {
+        item->statement = NO_NODE;
+        item->error = e.what();
+        item->tokenCount = recoveryPoint(start, parser.position()) - start;
+    }
+
+    // Names whose types it depends on, also for statements that failed to parse
+    for (std::size_t i = start; i < start + item->tokenCount; i++) {
+        if (tokenBuffer.type(i) == TokenType::IDENTIFIER) item->names.push_back(tokenBuffer.symbol(i));
+    }
+    return item;
+}
+
+// After a syntax error, skip to the end of the line (or ';') that closes
+// the statement's outermost braces, so the next statement starts clean
+std::size_t Document::recoveryPoint(std::size_t start, std::size_t failedAt) const {
+    const std::size_t eof = tokenBuffer.size() - 1;
+    int depth = 0;
+    for (std::size_t i = start; i < eof; i++) {
+        TokenType type = tokenBuffer.type(i);
+        if (type == TokenType::LBRACE) depth++;
+        else if (type == TokenType::RBRACE) depth--;
+        else if (i >= failedAt && depth <= 0 &&
+                 (type == TokenType::END_OF_LINE || type == TokenType::SEMICOLON)) {
+            return i + 1;
+        }
+    }
+    return eof;
+}
+
+// Type of the latest declaration of `name` in items before `ordinal`
+std::optional<ValueType> Document::declaredBefore(Symbol name, std::size_t ordinal) const {
+    auto it = declarers.find(name);
+    if (it == declarers.end()) return std::nullopt;
+
+    const Item* latest = nullptr;
+    for (const Item* item : it->second) {
+        if (item->ordinal < ordinal && (!latest || item->ordinal > latest->ordinal)) latest = item;
+    }
+    if (!latest) return std::nullopt;
+    for (const auto& decl : latest->declared) {
+        if (decl.first == name) return decl.second;
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> Document::diagnostics() const {
+    std::vector<std::string> result;
+    if (!lexError.empty()) result.push_back(lexError);
+    for (const auto& item : items) {
+        if (item->error.empty()) continue;
+        if (!item->errorHasLocation) {
+            result.push_back(item->error);
+            continue;
+        }
+        Token at{TokenType::UNKNOWN, static_cast<std::uint32_t>(item->errorOffset + item->drift), 0};
+        result.push_back(SyntaxError::format(item->error, tokenBuffer.location(at), item->errorAfter));
+    }
+    return result;
+}
+
+std::vector<NodeId> Document::statements() {
+    std::vector<NodeId> result;
+    for (auto& item : items) {
+        if (item->drift != 0) {
+            if (item->statement != NO_NODE) shiftStatement(tree, item->statement, item->drift);
+            item->errorOffset = static_cast<std::uint32_t>(item->errorOffset + item->drift);
+            item->drift = 0;
+        }
+        if (item->statement != NO_NODE) result.push_back(item->statement);
+    }
+    return result;
+}
+
+// Re-parsed statements leave their old nodes behind in the arena. Once
+// those outnumber the live ones, copy the live trees into a fresh Ast.
+void Document::compact() {
+    Ast fresh;
+    for (auto& item : items) {
+        if (item->statement != NO_NODE) item->statement = cloneStatement(fresh, tree, item->statement);
+    }
+    tree = std::move(fresh);
+}
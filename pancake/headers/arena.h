@@ -0,0 +1,58 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator. Memory comes from large blocks and is only given back all
+// at once, by clear() or the destructor, so objects placed here must not
+// need their destructor to run.
+class Arena {
+public:
+    static const std::size_t DEFAULT_BLOCK = 64 << 10;
+
+    explicit Arena(std::size_t blockSize = DEFAULT_BLOCK);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    void* allocate(std::size_t size, std::size_t align);
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copy of `text` that lives as long as the arena
+    std::string_view copy(std::string_view text);
+
+    // Free everything; the first block is kept for reuse
+    void clear();
+
+    std::size_t bytesUsed() const { return used; }
+
+private:
+    struct Block {
+        char* data;
+        std::size_t size;
+    };
+
+    std::size_t blockSize;
+    std::vector<Block> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    std::size_t used = 0;
+
+    void* grow(std::size_t size, std::size_t align);
+    void release(std::size_t keep);
+};
+
+#endif //ARENA_H
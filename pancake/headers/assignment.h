@@ -3,24 +3,29 @@
 
 #include "statements.h"
 #include "expressions.h"
+#include "symboltable.h"
 #include <string>
-#include <memory>
+#include <cstdint>
 #include <iostream>
 
 class Assignment : public Statements {
 public:
-    std::string name;
-    std::unique_ptr<Expressions> value;
+    Symbol name;
+    NodeId value;
+    std::uint32_t depth = 0;   // where the variable lives; see TypeChecker::Binding
+    std::uint32_t slot = 0;
 
-    Assignment(const std::string& name, std::unique_ptr<Expressions> value)
-        : name(name), value(std::move(value)) {}
+    static const NodeKind KIND = NodeKind::ASSIGNMENT;
 
-    void debugPrint(int indent = 0) const override {
+    Assignment(Symbol name, NodeId value)
+        : Statements(KIND), name(name), value(value) {}
+
+    void debugPrint(const Ast& ast, int indent = 0) const {
         std::string ind(indent, ' ');
         std::cout << ind << "Assignment:\n";
-        std::cout << ind << "  Var: " << name << "\n";
+        std::cout << ind << "  Var: " << symbolName(name) << "\n";
         std::cout << ind << "  Value:\n";
-        value->debugPrint(indent + 4);
+        ast.expression(value)->debugPrint(ast, indent + 4);
     }
 };
 
@@ -0,0 +1,140 @@
+#ifndef AST_H
+#define AST_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+#include "value.h"
+
+class Statements;
+class Expressions;
+
+// Index of a node in its Ast. Statements and expressions are numbered
+// separately; children refer to each other by id, never by pointer.
+using NodeId = std::uint32_t;
+const NodeId NO_NODE = 0xFFFFFFFFu;
+
+// A run of ids stored back to back in one of the Ast's list arrays
+struct NodeList {
+    std::uint32_t first = 0;
+    std::uint32_t count = 0;
+};
+
+// Text owned by an Ast (literal lexemes, string contents), referred to by
+// position like nodes are, so the tree holds no pointers
+struct TextRef {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+};
+
+// Slots of the variables local to a block, its nested blocks' included;
+// see TypeChecker
+struct Frame {
+    std::uint32_t first = 0;
+    std::uint32_t count = 0;
+};
+
+// One `elif (condition) { body }` of an if statement
+struct ElifBranch {
+    NodeId condition;
+    NodeList body;
+    Frame frame;
+};
+
+// Read-only view of a NodeList's entries, for range-for loops
+template <typename T>
+class ListView {
+public:
+    ListView(const T* first, std::uint32_t count) : first(first), count(count) {}
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    std::uint32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](std::uint32_t i) const { return first[i]; }
+
+private:
+    const T* first;
+    std::uint32_t count;
+};
+
+// Storage for the syntax tree of one compilation unit (a file, a REPL line,
+// a chunk of a stream). Nodes are bump-allocated in an arena and looked up
+// through flat id tables; statement lists, output lists and elif chains are
+// stored contiguously. Everything is freed at once with the Ast.
+class Ast {
+public:
+    template <typename T, typename... Args>
+    NodeId makeStatement(Args&&... args) {
+        statementNodes.push_back(arena.make<T>(std::forward<Args>(args)...));
+        return static_cast<NodeId>(statementNodes.size() - 1);
+    }
+
+    template <typename T, typename... Args>
+    NodeId makeExpression(Args&&... args) {
+        expressionNodes.push_back(arena.make<T>(std::forward<Args>(args)...));
+        return static_cast<NodeId>(expressionNodes.size() - 1);
+    }
+
+    Statements* statement(NodeId id) { return statementNodes[id]; }
+    const Statements* statement(NodeId id) const { return statementNodes[id]; }
+    Expressions* expression(NodeId id) { return expressionNodes[id]; }
+    const Expressions* expression(NodeId id) const { return expressionNodes[id]; }
+
+    // Append a list and return where it was stored
+    NodeList addStatements(const std::vector<NodeId>& ids);
+    NodeList addExpressions(const std::vector<NodeId>& ids);
+    NodeList addElifs(const std::vector<ElifBranch>& branches);
+
+    ListView<NodeId> statements(NodeList list) const { return {statementLists.data() + list.first, list.count}; }
+    ListView<NodeId> expressions(NodeList list) const { return {expressionLists.data() + list.first, list.count}; }
+    ListView<ElifBranch> elifs(NodeList list) const { return {elifLists.data() + list.first, list.count}; }
+
+    // Writable entries, for passes that rewrite a tree in place. Lists are
+    // never shared between nodes, so this only changes the one owner.
+    NodeId& expressionAt(NodeList list, std::uint32_t i) { return expressionLists[list.first + i]; }
+    ElifBranch& elifAt(NodeList list, std::uint32_t i) { return elifLists[list.first + i]; }
+
+    // Copy of source text owned by the Ast, for node fields that outlive the source
+    TextRef addText(std::string_view source);
+    std::string_view text(TextRef ref) const { return std::string_view(textPool.data() + ref.offset, ref.length); }
+
+    // String literal contents, interned: equal texts are one constant, its
+    // text stored once and its runtime value built once, so evaluating a
+    // literal shares that value's buffer instead of copying the text.
+    // Returns the constant's index.
+    std::uint32_t addString(std::string_view text);
+    TextRef stringText(std::uint32_t constant) const { return strings[constant]; }
+    const Value& stringValue(std::uint32_t constant) const { return stringValues[constant]; }
+
+    std::size_t statementCount() const { return statementNodes.size(); }
+    std::size_t expressionCount() const { return expressionNodes.size(); }
+    std::size_t nodeCount() const { return statementNodes.size() + expressionNodes.size(); }
+
+    // Drop every node; memory is kept for the next unit
+    void clear();
+
+private:
+    friend class ProgramCache;   // writes and maps flat images of the tree
+
+    Arena arena;
+    std::shared_ptr<void> image;   // read-only mapped cache file holding the nodes, if loaded from one
+    std::vector<Statements*> statementNodes;
+    std::vector<Expressions*> expressionNodes;
+    std::vector<NodeId> statementLists;
+    std::vector<NodeId> expressionLists;
+    std::vector<ElifBranch> elifLists;
+    std::string textPool;
+
+    // Interned strings, and an open-addressed table of their indices + 1
+    // (0 for a free entry) for finding equal texts
+    std::vector<TextRef> strings;
+    std::vector<Value> stringValues;
+    std::vector<std::uint32_t> stringTable;
+
+    void indexStrings();   // rebuild the rest from `strings`, e.g. loaded from a cache
+};
+
+#endif //AST_H
@@ -1,13 +1,49 @@
 #ifndef ASTNODES_H
 #define ASTNODES_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
+#include "ast.h"
 
+// Concrete type of a node. Every node stores its kind, so dispatch is one
+// switch instead of a chain of dynamic_casts, and nodes need no vtable.
+enum class NodeKind : std::uint8_t {
+    // Statements
+    VAR_DECL,
+    ASSIGNMENT,
+    OUT,
+    IN,
+    IF,
+    EXPRESSION_STATEMENT,
+
+    // Expressions
+    LITERAL,
+    VAR,
+    BINARY,
+    UNARY,
+    SHARED
+};
+
+// Base of every syntax tree node. Nodes live in an Ast's arena and are freed
+// together with it, so they hold no owning members and have no destructor.
 class ASTNodes {        
     public:
-        virtual ~ASTNodes() = default;
-        
+        NodeKind kind;
+
+    protected:
+        explicit ASTNodes(NodeKind kind) : kind(kind) {}
 };
 
+// The node as a T if it is one (checked through its kind), else nullptr
+template <typename T>
+const T* nodeCast(const ASTNodes* node) {
+    return node->kind == T::KIND ? static_cast<const T*>(node) : nullptr;
+}
+
+template <typename T>
+T* nodeCast(ASTNodes* node) {
+    return node->kind == T::KIND ? static_cast<T*>(node) : nullptr;
+}
+
 #endif //ASTNODES_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef ASTVISITOR_H
+#define ASTVISITOR_H
+
+#include <stdexcept>
+
+#include "statements.h"
+#include "expressions.h"
+#include "vardecl.h"
+#include "assignment.h"
+#include "outstatement.h"
+#include "instatement.h"
+#include "ifstatement.h"
+#include "expressionstatements.h"
+#include "literal.h"
+#include "varexpr.h"
+#include "binexrp.h"
+#include "unaryexpr.h"
+#include "sharedexpr.h"
+
+// Call f with the node cast to its concrete class, chosen by a switch on the
+// node's kind. `f` is usually a generic lambda or a struct with one
+// operator() per node class; every overload must return the same type.
+template <typename F>
+decltype(auto) visit(const Statements* stmt, F&& f) {
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: return f(*static_cast<const VarDecl*>(stmt));
+        case NodeKind::ASSIGNMENT: return f(*static_cast<const Assignment*>(stmt));
+        case NodeKind::OUT: return f(*static_cast<const OutStatement*>(stmt));
+        case NodeKind::IN: return f(*static_cast<const InStatement*>(stmt));
+        case NodeKind::IF: return f(*static_cast<const IfStatement*>(stmt));
+        case NodeKind::EXPRESSION_STATEMENT: return f(*static_cast<const ExpressionStatement*>(stmt));
+        default: break;
+    }
+    throw std::logic_error("visit: not a statement node");
+}
+
+template <typename F>
+decltype(auto) visit(const Expressions* expr, F&& f) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return f(*static_cast<const Literal*>(expr));
+        case NodeKind::VAR: return f(*static_cast<const VarExpr*>(expr));
+        case NodeKind::BINARY: return f(*static_cast<const BinExpr*>(expr));
+        case NodeKind::UNARY: return f(*static_cast<const UnaryExpr*>(expr));
+        case NodeKind::SHARED: return f(*static_cast<const SharedExpr*>(expr));
+        default: break;
+    }
+    throw std::logic_error("visit: not an expression node");
+}
+
+// Mutable variants, for passes that rewrite nodes in place
+template <typename F>
+decltype(auto) visit(Statements* stmt, F&& f) {
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: return f(*static_cast<VarDecl*>(stmt));
+        case NodeKind::ASSIGNMENT: return f(*static_cast<Assignment*>(stmt));
+        case NodeKind::OUT: return f(*static_cast<OutStatement*>(stmt));
+        case NodeKind::IN: return f(*static_cast<InStatement*>(stmt));
+        case NodeKind::IF: return f(*static_cast<IfStatement*>(stmt));
+        case NodeKind::EXPRESSION_STATEMENT: return f(*static_cast<ExpressionStatement*>(stmt));
+        default: break;
+    }
+    throw std::logic_error("visit: not a statement node");
+}
+
+template <typename F>
+decltype(auto) visit(Expressions* expr, F&& f) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return f(*static_cast<Literal*>(expr));
+        case NodeKind::VAR: return f(*static_cast<VarExpr*>(expr));
+        case NodeKind::BINARY: return f(*static_cast<BinExpr*>(expr));
+        case NodeKind::UNARY: return f(*static_cast<UnaryExpr*>(expr));
+        case NodeKind::SHARED: return f(*static_cast<SharedExpr*>(expr));
+        default: break;
+    }
+    throw std::logic_error("visit: not an expression node");
+}
+
+#endif //ASTVISITOR_H
@@ -2,26 +2,37 @@
 #define BINEXPR_H
 
 #include <string>
-#include <vector>
-#include <memory>
+#include <string_view>
 #include "statements.h"
 #include "expressions.h"
+#include "operators.h"
 
 class BinExpr : public Expressions {        
     public:
-        std::string op; // "+", "-", "*", "/", "mod"
-        std::unique_ptr<Expressions> left;
-        std::unique_ptr<Expressions> right;
+        BinaryOp op;
+        NodeId left;
+        NodeId right;
+        ValueType operands = ValueType::INT;   // type both sides are evaluated as
+        Operation operation = Operation::ADD_INT;   // `op` on `operands`
 
-        BinExpr(std::string op, std::unique_ptr<Expressions> left, std::unique_ptr<Expressions> right) 
-            : op(std::move(op)), left(std::move(left)), right(std::move(right)) {}
+        static const NodeKind KIND = NodeKind::BINARY;
 
-        void debugPrint(int indent = 0) const override {
-            std::cout << std::string(indent, ' ') << "BinExpr(" << op << ")\n";
-            left->debugPrint(indent + 2);
-            right->debugPrint(indent + 2);
+        BinExpr(BinaryOp op, NodeId left, NodeId right) 
+            : Expressions(KIND), op(op), left(left), right(right) {}
+
+        void debugPrint(const Ast& ast, int indent = 0) const {
+            std::cout << std::string(indent, ' ') << "BinExpr(" << opName(op) << ")\n";
+            ast.expression(left)->debugPrint(ast, indent + 2);
+            ast.expression(right)->debugPrint(ast, indent + 2);
         }
 };
 
+// Whether the expression concatenates strings; a chain `a + b + c` is such a
+// node whose left operand is another
+inline bool isConcat(const Expressions* expr) {
+    auto* binary = nodeCast<BinExpr>(expr);
+    return binary && binary->operation == Operation::CONCAT;
+}
+
 
 #endif //BINEXPR_H
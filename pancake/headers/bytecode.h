@@ -0,0 +1,70 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <vector>
+#include "symboltable.h"
+#include "value.h"
+
+// Instruction set of the VM. Registers hold an int, double or bool (`r`) or
+// a string (`s`, a separate file); variables, global or local to a block,
+// are numbered slots. Operations are typed, the type checker having fixed
+// every operand's type, so the VM never looks at a value's type. Operands,
+// in order a, b, c:
+//
+//   LOAD_INT r, value              LOAD_DOUBLE r, low bits, high bits
+//   LOAD_BOOL r, value             LOAD_STRING s, constant
+//   GET_INT r, slot, name ...      (GET_*: error if the slot is unset)
+//   SET_INT slot, r ...            DECLARE slot, name  ASSIGNABLE slot, name
+//   UNSET slot                     (on entry to the block it is local to)
+//   ADD_INT r, r, r ...            TO_DOUBLE r, r      JOIN s, piece, count
+//   EQ_STRING r, s, s ...          NOT r, r            NEGATE_INT r, r
+//   OUT_INT r ...                  OUT_TEXT constant   OUT_END
+//   IN global, ValueType
+//   JUMP target                    JUMP_IF_FALSE r, target
+//   FAIL constant                  HALT
+//
+// JOIN concatenates a whole chain `a + b + c ...` at once, its operands
+// being `count` entries of the unit's piece list from `piece` on.
+#define PANCAKE_OPCODES(X) \
+    X(LOAD_INT) X(LOAD_DOUBLE) X(LOAD_BOOL) X(LOAD_STRING) \
+    X(GET_INT) X(GET_DOUBLE) X(GET_BOOL) X(GET_STRING) \
+    X(SET_INT) X(SET_DOUBLE) X(SET_BOOL) X(SET_STRING) \
+    X(DECLARE) X(ASSIGNABLE) X(UNSET) \
+    X(ADD_INT) X(SUB_INT) X(MUL_INT) X(DIV_INT) X(MOD_INT) \
+    X(ADD_DOUBLE) X(SUB_DOUBLE) X(MUL_DOUBLE) X(DIV_DOUBLE) \
+    X(TO_DOUBLE) X(NEGATE_INT) X(NEGATE_DOUBLE) X(NOT) \
+    X(EQ_INT) X(NE_INT) X(LT_INT) X(GT_INT) X(LE_INT) X(GE_INT) \
+    X(EQ_DOUBLE) X(NE_DOUBLE) X(LT_DOUBLE) X(GT_DOUBLE) X(LE_DOUBLE) X(GE_DOUBLE) \
+    X(EQ_BOOL) X(NE_BOOL) X(AND) X(OR) \
+    X(JOIN) X(EQ_STRING) X(NE_STRING) \
+    X(OUT_INT) X(OUT_DOUBLE) X(OUT_BOOL) X(OUT_STRING) X(OUT_TEXT) X(OUT_END) X(IN) \
+    X(JUMP) X(JUMP_IF_FALSE) X(FAIL) X(HALT)
+
+enum class Opcode : std::uint8_t {
+#define PANCAKE_OPCODE_ENUM(name) name,
+    PANCAKE_OPCODES(PANCAKE_OPCODE_ENUM)
+#undef PANCAKE_OPCODE_ENUM
+};
+
+// A piece of a JOIN: a string register, or a constant with this bit set
+const std::uint32_t CONSTANT_PIECE = 0x80000000u;
+
+struct Instruction {
+    Opcode op;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    std::uint32_t c = 0;
+};
+
+// One compiled unit: a file, a REPL line, a streamed statement
+struct Bytecode {
+    std::vector<Instruction> code;          // ends in HALT
+    std::vector<std::uint32_t> offsets;     // source offset of each instruction, for errors
+    std::vector<Value> strings;             // LOAD_STRING, OUT_TEXT and FAIL constants
+    std::vector<std::uint32_t> pieces;      // operands of the JOINs
+    std::uint32_t slots = 0;                // variable slots used, by every unit so far
+    std::uint32_t registers = 0;            // size of each register file
+};
+
+#endif //BYTECODE_H
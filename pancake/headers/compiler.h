@@ -0,0 +1,57 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <cstdint>
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "symbolmap.h"
+
+class Statements;
+class Expressions;
+
+// Lowers a type-checked tree to bytecode for the VM. Evaluation order,
+// output and runtime errors are exactly those of the tree walker.
+//
+// Global slots persist across compile() calls: units compiled by one
+// compiler and run by one VM share their variables, as REPL lines and
+// streamed statements do. Block locals take their frame slot in a pool of
+// slots shared by every top-level statement, cleared as the block is entered.
+class BytecodeCompiler {
+public:
+    // The returned unit is reused, and only valid until the next call
+    const Bytecode& compile(const Ast& ast, NodeList program);
+
+private:
+    SymbolMap<std::uint32_t> slots;
+    std::vector<std::uint32_t> localSlots;   // by frame slot, grown as needed
+    Bytecode unit;
+
+    // State of the unit being compiled
+    const Ast* ast = nullptr;
+    std::uint32_t nextRegister = 0;
+    std::vector<std::uint32_t> sharedRegisters;   // by SharedExpr slot, a stack of nested statements
+    std::size_t sharedBase = 0;                   // where the current statement's slots start
+
+    void compileBlock(NodeList statements);
+    void compileScope(NodeList statements, Frame frame);
+    void compileStatement(const Statements* stmt);
+
+    // Register holding the value: the string file for strings, else the
+    // value file
+    std::uint32_t compileExpression(const Expressions* expr);
+    std::uint32_t compileDouble(const Expressions* expr);   // int operands widened
+    std::uint32_t compileBinary(const class BinExpr* expr);
+
+    // Operands of a concatenation chain, left to right, as JOIN pieces
+    void compilePieces(const Expressions* expr, std::vector<std::uint32_t>& pieces);
+
+    std::uint32_t emit(Opcode op, std::uint32_t offset, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0);
+    std::uint32_t slot(Symbol name);
+    std::uint32_t variable(std::uint32_t depth, std::uint32_t slot, Symbol name);   // see TypeChecker::Binding
+    std::uint32_t newSlot();
+    std::uint32_t newRegister();
+    std::uint32_t constant(Value text);
+};
+
+#endif //COMPILER_H
@@ -0,0 +1,92 @@
+#ifndef CPPEMITTER_H
+#define CPPEMITTER_H
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "ast.h"
+#include "lineindex.h"
+#include "symboltable.h"
+#include "valuetype.h"
+
+class Statements;
+class Expressions;
+
+// Translates a type-checked tree into a C++ program that does what the
+// interpreter does: the same output, and the same runtime errors at the same
+// points. Every subexpression gets a temporary of its own, in the
+// interpreter's evaluation order, so the order in which C++ evaluates
+// operands never shows. A small runtime for output, input and errors is
+// written into the same file, which needs only the standard library.
+//
+// Variables are modelled as the VM has them: a global per symbol, and a
+// pool of frame slots for block locals, each with a flag saying whether
+// it is set, so declarations and uses fail as they do at run time there.
+class CppEmitter {
+public:
+    // The program for the top-level statements `program`. `source` is the
+    // text the tree was parsed from, for the locations in error messages.
+    std::string emit(const Ast& ast, NodeList program, std::string_view source);
+
+    // Build `code` into an executable at `output` with the system compiler,
+    // $CXX or else c++; false if it fails, its messages left on stderr
+    static bool compile(const std::string& code, const std::string& output);
+
+private:
+    static const std::uint32_t STATEMENTS_PER_FUNCTION = 32;   // top-level, so no function gets huge
+
+    const Ast* ast = nullptr;
+    std::string_view source;
+    LineIndex lines;
+
+    std::string body;                  // functions written so far
+    std::set<std::string> variables;   // declarations at file scope
+    int depth = 0;                     // indentation, in levels
+    std::uint32_t nextTemp = 0;
+
+    std::vector<std::string> sharedTemps;   // by SharedExpr slot, stacked as the compiler's registers
+    std::size_t sharedBase = 0;
+
+    // Flags of the variables known to be set at the point being emitted,
+    // whose checks can be left out, and of those that may be; the others
+    // are certainly unset. Global flags are never cleared, so once set
+    // they stay known for the rest of the program.
+    std::unordered_set<std::string> definitelySet;
+    std::unordered_set<std::string> possiblySet;
+
+    void line(const std::string& text);
+    std::string failure(std::uint32_t offset, const std::string& message);   // the statement raising the error
+    void fail(std::uint32_t offset, const std::string& message);
+    void requireSet(const std::string& flag, std::uint32_t offset, const std::string& message);
+    void markSet(const std::string& flag);
+    std::string temp(const char* type, const std::string& value);
+
+    // Names of a variable's value as `type` and of its flag, declared on
+    // first use; see TypeChecker::Binding
+    std::string variable(std::uint32_t depth, std::uint32_t slot, Symbol name, ValueType type);
+    std::string flag(std::uint32_t depth, std::uint32_t slot, Symbol name);
+
+    void emitBlock(NodeList statements);
+    void emitScope(NodeList statements, Frame frame);   // a block, its variables cleared first
+    void emitStatement(const Statements* stmt);
+    void emitStore(std::uint32_t depth, std::uint32_t slot, Symbol name, const Expressions* value);
+
+    // A C++ expression for the value, free of side effects: a literal, a
+    // variable or a temporary. The checks and computations it needs are
+    // written out first.
+    std::string emitExpression(const Expressions* expr);
+    std::string emitDouble(const Expressions* expr);   // int operands widened
+    std::string emitBinary(const class BinExpr* expr);
+
+    // Operands of a concatenation chain, left to right
+    void emitPieces(const Expressions* expr, std::vector<std::string>& pieces);
+
+    static std::string quote(std::string_view text);
+    static std::string intLiteral(int value);
+    static std::string doubleLiteral(double value);
+};
+
+#endif //CPPEMITTER_H
@@ -0,0 +1,92 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tokenbuffer.h"
+#include "ast.h"
+#include "statements.h"
+#include "typechecker.h"
+
+// A text change: `removed` bytes at `offset` are replaced by `inserted`
+struct TextEdit {
+    std::size_t offset = 0;
+    std::size_t removed = 0;
+    std::string inserted;
+};
+
+// A source file that is kept tokenised and parsed across edits, for watch
+// mode and editors. An edit re-lexes from the start of the edited line
+// until the token stream matches the old one again, and re-parses from the
+// top-level statement before the edit until statement boundaries line up
+// with the old ones. Everything else is reused.
+class Document {
+public:
+    explicit Document(std::string text);
+
+    void applyEdit(const TextEdit& edit);
+
+    // Replace the whole text, applied as one edit covering what differs
+    void setText(const std::string& newText);
+
+    const std::string& text() const { return source; }
+    const TokenBuffer& tokens() const { return tokenBuffer; }
+
+    // Syntax and type errors, in source order
+    std::vector<std::string> diagnostics() const;
+
+    // Top-level statements in order, with node offsets brought up to date
+    std::vector<NodeId> statements();
+    const Ast& ast() const { return tree; }
+
+    // Work done by the last edit
+    std::size_t relexedTokens() const { return lastRelexed; }
+    std::size_t reparsedStatements() const { return lastReparsed; }
+
+private:
+    // One top-level statement and the tokens it was parsed from. Blank
+    // lines before a statement belong to it.
+    struct Item {
+        std::size_t firstToken = 0;
+        std::size_t tokenCount = 0;
+        std::size_t ordinal = 0;          // index in `items`
+        bool stale = false;               // its first token was replaced by an edit
+        std::int64_t drift = 0;           // bytes the text moved since it was parsed
+        NodeId statement = NO_NODE;       // none for trailing blank lines or an error
+        std::size_t nodes = 0;            // AST nodes of `statement`
+        std::string error;                // empty if it parsed
+        std::uint32_t errorOffset = 0;    // SyntaxError location, moves with `drift`
+        std::string errorAfter;
+        bool errorHasLocation = false;
+        std::vector<std::pair<Symbol, ValueType>> declared;
+        std::vector<Symbol> names;        // every identifier it mentions
+    };
+
+    std::string source;
+    TokenBuffer tokenBuffer;
+    std::vector<std::unique_ptr<Item>> items;
+    Ast tree;                    // nodes of every item, plus garbage from re-parses
+    std::size_t liveNodes = 0;
+    std::unordered_map<Symbol, std::vector<const Item*>> declarers;
+    std::string lexError;
+
+    std::size_t lastRelexed = 0;
+    std::size_t lastReparsed = 0;
+
+    void rebuild();
+    void compact();
+    std::size_t reparse(std::size_t first, std::size_t stableFrom, std::set<Symbol>& changedNames);
+    std::unique_ptr<Item> parseItem(std::size_t start, TypeChecker& scope);
+    std::size_t recoveryPoint(std::size_t start, std::size_t failedAt) const;
+    std::optional<ValueType> declaredBefore(Symbol name, std::size_t ordinal) const;
+    std::size_t itemAt(std::size_t token) const;
+};
+
+#endif //DOCUMENT_H
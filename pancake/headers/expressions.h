@@ -3,14 +3,22 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <iostream>
 #include "astnodes.h"
+#include "valuetype.h"
 
 class Expressions : public ASTNodes {        
     public:
-        int line = 0;
-        int column = 0;
-        virtual ~Expressions() = default;
-        virtual void debugPrint(int indent = 0) const = 0;  // ← Add this
+        std::uint32_t offset = 0;  // byte offset into the source, resolved to line/column on error
+        ValueType type = ValueType::INT;   // static type of the value, inferred by the parser
+
+        // Print the tree below this node (dispatches on `kind`)
+        void debugPrint(const Ast& ast, int indent = 0) const;
+
+    protected:
+        explicit Expressions(NodeKind kind) : ASTNodes(kind) {}
+        Expressions(NodeKind kind, ValueType type) : ASTNodes(kind), type(type) {}
 };
 
 
@@ -1,22 +1,23 @@
 #ifndef EXPRESSIONSTATEMENT_H
 #define EXPRESSIONSTATEMENT_H
 
-#include <memory>
 #include <iostream>
 #include "statements.h"
 #include "expressions.h"
 
 class ExpressionStatement : public Statements {
 public:
-    std::unique_ptr<Expressions> expression;
+    NodeId expression;
 
-    ExpressionStatement(std::unique_ptr<Expressions> expr)
-        : expression(std::move(expr)) {}
+    static const NodeKind KIND = NodeKind::EXPRESSION_STATEMENT;
 
-    void debugPrint(int indent = 0) const override {
+    ExpressionStatement(NodeId expr)
+        : Statements(KIND), expression(expr) {}
+
+    void debugPrint(const Ast& ast, int indent = 0) const {
         std::string ind(indent, ' ');
         std::cout << ind << "ExpressionStatement:\n";
-        expression->debugPrint(indent + 2);
+        ast.expression(expression)->debugPrint(ast, indent + 2);
     }
 };
 
@@ -2,52 +2,52 @@
 #define IFSTATEMENT_H
 
 #include <string>
-#include <vector>
-#include <memory>
 #include "statements.h"
 #include "expressions.h"
 
 class IfStatement : public Statements {
 public:
-    std::unique_ptr<Expressions> condition;
-    std::vector<std::unique_ptr<Statements>> ifBranch;
-    std::vector<std::pair<std::unique_ptr<Expressions>, std::vector<std::unique_ptr<Statements>>>> elifBranches;
-    std::vector<std::unique_ptr<Statements>> elseBranch;
-
-    IfStatement(std::unique_ptr<Expressions> cond,
-                std::vector<std::unique_ptr<Statements>> ifBranch,
-                std::vector<std::pair<std::unique_ptr<Expressions>, std::vector<std::unique_ptr<Statements>>>> elifBranches,
-                std::vector<std::unique_ptr<Statements>> elseBranch)
-        : condition(std::move(cond)),
-          ifBranch(std::move(ifBranch)),
-          elifBranches(std::move(elifBranches)),
-          elseBranch(std::move(elseBranch)) {}
-
-    void debugPrint(int indent = 0) const override {
+    NodeId condition;
+    NodeList ifBranch;       // statements
+    NodeList elifBranches;   // ElifBranch entries, in source order
+    NodeList elseBranch;     // statements
+    Frame ifFrame;           // local variables of each block
+    Frame elseFrame;
+
+    static const NodeKind KIND = NodeKind::IF;
+
+    IfStatement(NodeId cond, NodeList ifBranch, NodeList elifBranches, NodeList elseBranch)
+        : Statements(KIND),
+          condition(cond),
+          ifBranch(ifBranch),
+          elifBranches(elifBranches),
+          elseBranch(elseBranch) {}
+
+    void debugPrint(const Ast& ast, int indent = 0) const {
         std::string ind(indent, ' ');
         std::cout << ind << "IfStatement:\n";
 
         std::cout << ind << "  Condition:\n";
-        condition->debugPrint(indent + 4);
+        ast.expression(condition)->debugPrint(ast, indent + 4);
 
         std::cout << ind << "  If block:\n";
-        for (const auto& stmt : ifBranch) {
-            stmt->debugPrint(indent + 4);
+        for (NodeId stmt : ast.statements(ifBranch)) {
+            ast.statement(stmt)->debugPrint(ast, indent + 4);
         }
 
-        for (const auto& [elifCond, elifStmts] : elifBranches) {
+        for (const ElifBranch& elif : ast.elifs(elifBranches)) {
             std::cout << ind << "  ElseIf condition:\n";
-            elifCond->debugPrint(indent + 4);
+            ast.expression(elif.condition)->debugPrint(ast, indent + 4);
             std::cout << ind << "  ElseIf block:\n";
-            for (const auto& stmt : elifStmts) {
-                stmt->debugPrint(indent + 4);
+            for (NodeId stmt : ast.statements(elif.body)) {
+                ast.statement(stmt)->debugPrint(ast, indent + 4);
             }
         }
 
-        if (!elseBranch.empty()) {
+        if (elseBranch.count > 0) {
             std::cout << ind << "  Else block:\n";
-            for (const auto& stmt : elseBranch) {
-                stmt->debugPrint(indent + 4);
+            for (NodeId stmt : ast.statements(elseBranch)) {
+                ast.statement(stmt)->debugPrint(ast, indent + 4);
             }
         }
     }
@@ -0,0 +1,152 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "lineindex.h"
+#include "valuetype.h"
+
+// Lines for `in` statements, read in bulk instead of a getline() each. A
+// regular file is mapped and split in place, the kernel reading ahead of
+// the program; anything else, such as a pipe, is read in large blocks by a
+// background thread. Nothing is read or mapped until the first `in`
+// statement asks for a line, so a script without one leaves its stdin to
+// whoever reads it next. A terminal is never bound: the REPL reads its
+// lines from the same stdin, and `in` statements use std::cin there as
+// before.
+//
+// The values read can be recorded to a log, and a log replayed in place of
+// the input, so that a session's input can be fed to the program again
+// exactly, with nothing to read or parse.
+class Input {
+public:
+    // A value for an `in` statement, as the variable's type says. Text is
+    // valid until the next read.
+    struct Value {
+        int intValue = 0;
+        double doubleValue = 0;
+        std::string_view text;
+    };
+
+    enum class Status {
+        OK,
+        END,        // no more input
+        MISMATCH,   // replaying, and the log has a different read next, or is damaged; see mismatch()
+    };
+
+    Input() = default;
+    ~Input();
+
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+
+    // What `in` statements read, once main() has bound it
+    static Input& standard();
+
+    // Read from the file; false if it cannot be opened
+    bool openFile(const std::string& path);
+
+    // Read from stdin, from where it stands at the first read; false, and
+    // nothing bound, if it is a terminal
+    bool openStandard();
+
+    // Log every value read from now on to the file; false if it cannot be
+    // created. The log is written out as it fills and when closed.
+    bool record(const std::string& path);
+
+    // Serve reads from a log written by record(); false, with the reason in
+    // `error`, if it is not one
+    bool replay(const std::string& path, std::string& error);
+
+    // The next value for the `in` statement at `where`, reading a variable
+    // of `type`. Conversions fail as toInt()/toDouble() do.
+    Status read(ValueType type, SourceLocation where, Value& value);
+
+    // What the log has instead, after read() returned MISMATCH
+    std::string mismatch() const;
+
+    // Whether read() has returned MISMATCH, so that the replay did not
+    // reproduce the recorded run; main() then exits non-zero
+    bool replayFailed() const { return failedReplay; }
+
+    // Whether read() needs the statement's location; it is only looked up
+    // then
+    bool tracksLocation() const { return recording || replaying; }
+
+    // Text converted as std::stoi() / std::stod() would, exceptions
+    // included, with std::from_chars() for the plain numbers that both read
+    // the same way
+    static int toInt(std::string_view text);
+    static double toDouble(std::string_view text);
+
+private:
+    enum class Kind {
+        NONE,       // std::cin
+        PENDING,    // `pendingFd`, bound at the first read
+        MAPPED,
+        STREAMED,
+    };
+
+    struct Reader;   // state shared with the background thread
+
+    // A read in a log
+    struct Entry {
+        ValueType type = ValueType::INT;
+        std::uint32_t line = 0;
+        std::uint32_t column = 0;
+        bool ended = false;   // the input was at its end, so there is no value
+        Value value;
+    };
+
+    Kind kind = Kind::NONE;
+
+    // PENDING: the file to read, and whether it is closed when done with
+    int pendingFd = -1;
+    bool pendingOwned = false;
+
+    // MAPPED: the whole file, and where the next line starts
+    const char* data = nullptr;
+    std::size_t size = 0;
+    std::size_t position = 0;
+    std::string contents;   // the file itself where it is read, not mapped
+
+    // STREAMED: the block being split, and a line begun in an earlier one
+    std::shared_ptr<Reader> reader;
+    std::string block;
+    std::size_t blockPosition = 0;
+    std::string partial;
+    std::string line;   // a line put together from two blocks, or from std::cin
+
+    // Recording: entries encoded but not yet written
+    bool recording = false;
+    std::ofstream logFile;
+    std::string logBuffer;
+
+    // Replaying: the log, decoded an entry at a time as it is read
+    bool replaying = false;
+    std::string log;
+    std::size_t logPosition = 0;
+    std::size_t replayed = 0;   // entries so far
+    Entry next;                 // that read() found instead of what was asked for
+    bool damaged = false;       // or it found no valid entry at all
+    bool failedReplay = false;
+
+    void defer(int fd, bool owned);
+    void bind(int fd, bool owned);
+    void close();
+
+    // Next line, without its '\n', as std::getline() gives it; from std::cin
+    // if nothing is bound. False at the end of the input.
+    bool nextLine(std::string_view& line);
+
+    void logEntry(ValueType type, SourceLocation where, const Value& value);
+    void logEnd(ValueType type, SourceLocation where);
+    void writeLog();
+    static bool decodeEntry(std::string_view log, std::size_t& position, Entry& entry);
+};
+
+#endif //INPUT_H
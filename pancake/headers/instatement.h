@@ -2,18 +2,24 @@
 #define INSTATEMENT_H
 
 #include <string>
-#include <vector>
-#include <memory>
+#include <cstdint>
 #include "statements.h"
 #include "expressions.h"
+#include "symboltable.h"
+#include "valuetype.h"
 
 class InStatement : public Statements {
 public:
-    std::string varName;
-    explicit InStatement(const std::string& name) : varName(name) {}
+    Symbol varName;
+    ValueType type;   // static type of the variable; the input is converted to it
+    std::uint32_t depth = 0;   // where the variable lives; see TypeChecker::Binding
+    std::uint32_t slot = 0;
+    static const NodeKind KIND = NodeKind::IN;
 
-    void debugPrint(int indent = 0) const override {
-        std::cout << std::string(indent, ' ') << "InStatement(" << varName << ")\n";
+    InStatement(Symbol name, ValueType type) : Statements(KIND), varName(name), type(type) {}
+
+    void debugPrint(const Ast&, int indent = 0) const {
+        std::cout << std::string(indent, ' ') << "InStatement(" << symbolName(varName) << ")\n";
     }
 };
 
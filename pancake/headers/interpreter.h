@@ -5,32 +5,102 @@
 
 #include <unordered_map>
 #include <string>
-#include <any>
 #include <vector>
 #include <memory>
 #include <iostream>
 #include <stdexcept>
-#include <queue>
+#include <string_view>
+#include <cstdint>
 
 #include "statements.h"
 #include "expressions.h"
+#include "lineindex.h"
+#include "symbolmap.h"
+#include "ast.h"
+#include "value.h"
+#include "jit.h"
 
 class Interpreter {
 public:
     Interpreter() = default;
 
     // Main entry point to execute a program
-    void execute(const std::vector<std::unique_ptr<Statements>>& statements);
+    void execute(const Ast& ast, NodeList statements);
+
+    // Execute a single top-level statement
+    void execute(const Ast& ast, NodeId statement);
+
+    // Source the AST was parsed from, used to turn node offsets into line/column.
+    // `firstLine` is the file line the source starts on when it is only a chunk.
+    void setSource(std::string_view source, int firstLine = 1);
+
+    // Whether larger numeric and bool expressions run as machine code; see
+    // Jit. Off by default.
+    void setJit(bool enabled) { useJit = enabled; }
 
 private:
-    std::unordered_map<std::string, std::any> variables;   // Variable environment (variable name -> value)
-    std::queue<std::any> inputQueue;  // For feeding input in file mode
+    // Variables, in the slots the parser resolved them to: globals by
+    // symbol, block locals in the frame of the top-level statement running.
+    // A slot holding no value is a variable not declared (yet).
+    std::vector<Value> globals;
+    std::vector<Value> locals;
+
+    // Values of the optimizer's shared subexpressions, valid while `epoch`
+    // matches, i.e. until the next statement starts
+    struct SharedValue {
+        Value value;
+        std::uint64_t epoch = 0;
+    };
+    std::vector<SharedValue> shared;
+    std::uint64_t epoch = 0;
+
+    const Ast* ast = nullptr;   // tree being executed
+    Jit jit;                    // code for its expressions, compiled as it starts
+    bool useJit = false;
+    std::string_view source;
+    LineIndex lines;
 
     // Execute a single statement
     void executeStatement(const Statements* stmt);
+    void executeBlock(NodeList statements);
+    void executeScope(NodeList statements, Frame frame);   // a block, its variables cleared first
+
+    // See TypeChecker::Binding
+    Value& variable(std::uint32_t depth, std::uint32_t slot) {
+        if (depth > 0) return locals[slot];
+        if (slot >= globals.size()) globals.resize(slot + 1);
+        return globals[slot];
+    }
+
+    // Evaluate an expression and return its result, boxed
+    Value evaluateExpression(const Expressions* expr);
+
+    // Evaluate the expression a statement holds, by its compiled code if
+    // it has any
+    Value evaluateRoot(NodeId id);
+    bool evaluateCondition(NodeId id);
+    void runCompiled(const Jit::Function& function, void* result);
+
+    // Evaluate an expression of that static type. The parser has checked
+    // the whole tree, so operands are evaluated with the matching function
+    // directly; evaluateDouble() also takes int expressions and widens them.
+    // Strings stay boxed, so a string read from a variable shares its text.
+    int evaluateInt(const Expressions* expr);
+    double evaluateDouble(const Expressions* expr);
+    bool evaluateBool(const Expressions* expr);
+    Value evaluateString(const Expressions* expr);
+
+    // A string operand, by reference where it is stored already (a
+    // variable, a literal's constant) so that reading it touches no
+    // reference count; anything else is evaluated into `scratch`
+    const Value& stringOperand(const Expressions* expr, Value& scratch);
 
-    // Evaluate an expression and return its result
-    std::any evaluateExpression(const Expressions* expr);
+    // A chain of concatenations, `a + b + c` being (a + b) + c, taken as a
+    // whole: its operands' values are pushed on `pieces` left to right, to
+    // be joined in one allocation or written out one by one. Each caller
+    // pops what it pushed.
+    std::vector<Value> pieces;
+    void pushPieces(const Expressions* expr);
 
     // Helpers to evaluate specific statement types
     void handleVarDecl(const class VarDecl* stmt);
@@ -39,11 +109,9 @@ private:
     void handleIn(const class InStatement* stmt);
     void handleIf(const class IfStatement* stmt);
 
-    // Helpers to evaluate specific expression types
-    std::any evaluateLiteral(const class Literal* expr);
-    std::any evaluateVarExpr(const class VarExpr* expr);
-    std::any evaluateBinExpr(const class BinExpr* expr);
-    std::any evaluateUnaryExpr(const class UnaryExpr* expr);
+    // Helpers for the expression kinds whose value is stored, not computed
+    const Value& evaluateVarExpr(const class VarExpr* expr);
+    const Value& evaluateSharedExpr(const class SharedExpr* expr);
 
     [[noreturn]] void runtimeError(const Statements* stmt, const std::string& msg);
     [[noreturn]] void runtimeError(const Expressions* expr, const std::string& msg);
@@ -0,0 +1,143 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_set>
+#include <vector>
+#include "ast.h"
+#include "value.h"
+
+class Statements;
+class Expressions;
+
+// Compiles the interpreter's larger int, double and bool expression trees
+// to x86-64 machine code, so they are evaluated by the processor instead of
+// walked node by node. Only Linux on x86-64 has a code generator; elsewhere
+// nothing is compiled and the interpreter walks every tree as before.
+//
+// The code runs faster than the walk, but generating it costs more than
+// walking a tree once, and a program evaluates each of its trees at most
+// once. So the interpreter only uses it when asked to.
+//
+// A tree is compiled whole or not at all. Trees with strings, trees too
+// deep for the registers and trees holding a shared subexpression are left
+// to the interpreter. Common subexpression elimination makes those from -O1
+// up, so at -O1 and -O2 a tree that repeats a subexpression is walked. The
+// code reads variables in place and evaluates operands left to right, as
+// the interpreter does, returning at the first runtime error for the
+// interpreter to raise; see Failure.
+class Jit {
+public:
+    // What went wrong where, at the first runtime error of a tree
+    struct Failure {
+        enum class Kind : std::uint8_t { UNDEFINED, DIVISION, MODULO };
+        Kind kind;
+        const Expressions* at;   // a VarExpr for UNDEFINED, else the division
+    };
+
+    // A compiled tree. `code` writes its value, an int, double or bool as
+    // the tree's type says, to `result` and returns 0; or returns k + 1
+    // for failures[k].
+    using Code = std::uint32_t (*)(const Value* globals, const Value* locals, void* result);
+
+    struct Function {
+        Code code = nullptr;
+        std::uint32_t globals = 0;        // global slots it reads, all below this
+        std::uint32_t firstFailure = 0;   // its failures, in `failures`
+    };
+
+    Jit() = default;
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    // Whether this platform has a code generator
+    static bool supported();
+
+    // Compile the expressions of `program` and the blocks in it, dropping
+    // what was compiled for an earlier one. Only a tree with at least
+    // MIN_OPERATORS operators is compiled; a smaller one gains little. One
+    // holding a shared subexpression (-O1 and up) is not, however large.
+    void compile(const Ast& ast, NodeList program);
+    void compile(const Ast& ast, NodeId statement);
+
+    // The code of expression `id` of the last program compiled, or null
+    const Function* find(NodeId id) const {
+        if (id >= functions.size() || !functions[id].code) return nullptr;
+        return &functions[id];
+    }
+
+    const Failure& failure(const Function& function, std::uint32_t returned) const {
+        return failures[function.firstFailure + returned - 1];
+    }
+
+    static const std::uint32_t MIN_OPERATORS = 8;
+
+private:
+    std::vector<Function> functions;   // by expression NodeId
+    std::vector<Failure> failures;
+
+    // Executable memory: mapped writable while code is written into it,
+    // then executable, never both
+    unsigned char* memory = nullptr;
+    std::size_t capacity = 0;
+
+    // State of the code being generated
+    const Ast* ast = nullptr;
+    std::vector<unsigned char> code;   // every function of the program
+    std::vector<unsigned char> body;   // the function being generated, its first `length` bytes
+    std::size_t length = 0;
+    std::vector<NodeId> roots;         // of the functions in `code`
+    std::vector<std::size_t> starts;   // where each starts in `code`
+    struct Jump {
+        std::size_t at;          // of the rel32 in `body`
+        std::uint32_t failure;   // returned for it, 1-based
+    };
+    std::vector<Jump> jumps;            // to the failure exits
+    std::uint32_t functionFailures = 0;
+    unsigned intTop = 0;                // int and bool registers in use
+    unsigned doubleTop = 0;             // double registers in use
+    unsigned intsUsed = 0;              // most int registers in use at once
+    std::uint32_t globalsRead = 0;
+    std::unordered_set<std::uint64_t> checked;   // variables read, by depth and slot, checked once
+    bool tooDeep = false;
+
+    void begin(const Ast& ast);
+    void finish();
+    void collectBlock(NodeList statements);
+    void collectStatement(const Statements* stmt);
+    void collectRoot(NodeId id);
+
+    // Whether the tree is one the generator handles, counting its operators
+    bool supports(const Expressions* expr, std::uint32_t& operators) const;
+    void generate(NodeId id);
+
+    // Code leaving the value in the next register of its kind, which it
+    // returns; bools are 0 or 1 in an int register
+    unsigned generateInt(const Expressions* expr);
+    unsigned generateDouble(const Expressions* expr);   // int operands widened
+    unsigned generateBool(const Expressions* expr);
+    unsigned pushInt();
+    unsigned pushDouble();
+
+    // Instructions used by the generator, by register number (0 = rax,
+    // 8 = r8; 0 = xmm0)
+    void byte(unsigned char value);
+    void emit(std::initializer_list<unsigned char> bytes);
+    void emit32(std::uint32_t value);
+    void rex(bool wide, unsigned reg, unsigned rm, bool always = false);
+    void modrm(unsigned reg, unsigned rm);                        // register operand
+    void modrm(unsigned reg, unsigned base, std::int32_t disp);   // [base + disp32]
+    void intOp(unsigned char opcode, unsigned reg, unsigned rm);  // op r32, r/m32
+    void intOp(unsigned char opcode, unsigned reg, unsigned base, std::int32_t disp);
+    void sseOp(unsigned char prefix, unsigned char opcode, unsigned reg, unsigned rm);
+    void sseOp(unsigned char prefix, unsigned char opcode, unsigned reg, unsigned base, std::int32_t disp);
+    void checkVariable(const class VarExpr* var, unsigned& base, std::int32_t& payload);   // fails if unset
+    void failIf(unsigned char condition, Failure::Kind kind, const Expressions* at);   // jcc to an exit
+    void setFlag(unsigned char condition, unsigned reg);         // reg = condition ? 1 : 0
+};
+
+#endif //JIT_H
@@ -0,0 +1,105 @@
+#ifndef LEXERTABLES_H
+#define LEXERTABLES_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "token.h"
+
+// Compile-time tables used by the tokeniser. Character classification is a
+// single lookup into a 256-entry table (independent of the C locale) and
+// keyword resolution is one hash plus one compare.
+
+namespace lexer {
+
+    enum CharClass : std::uint8_t {
+        CC_SPACE       = 1 << 0,   // ' ', \t, \v, \f, \r (newline is a token)
+        CC_DIGIT       = 1 << 1,   // 0-9
+        CC_IDENT_START = 1 << 2,   // a-z, A-Z, _
+        CC_IDENT       = 1 << 3,   // a-z, A-Z, _, 0-9
+        CC_NEWLINE     = 1 << 4    // \n
+    };
+
+    constexpr std::array<std::uint8_t, 256> makeCharClassTable() {
+        std::array<std::uint8_t, 256> table{};
+        for (int c = 0; c < 256; c++) {
+            std::uint8_t bits = 0;
+            if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r') bits |= CC_SPACE;
+            if (c == '\n') bits |= CC_NEWLINE;
+            if (c >= '0' && c <= '9') bits |= CC_DIGIT | CC_IDENT;
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') bits |= CC_IDENT_START | CC_IDENT;
+            table[c] = bits;
+        }
+        return table;
+    }
+
+    inline constexpr std::array<std::uint8_t, 256> charClass = makeCharClassTable();
+
+    constexpr bool is(char c, std::uint8_t cls) {
+        return (charClass[static_cast<unsigned char>(c)] & cls) != 0;
+    }
+
+    struct Keyword {
+        std::string_view text;
+        TokenType type;
+    };
+
+    inline constexpr std::array<Keyword, 16> keywords = {{
+        {"let", TokenType::LET},
+        {"out", TokenType::OUT},
+        {"in", TokenType::IN},
+        {"if", TokenType::IF},
+        {"elif", TokenType::ELIF},
+        {"else", TokenType::ELSE},
+        {"mod", TokenType::MODULO},
+        {"int", TokenType::TYPE_INT},
+        {"double", TokenType::TYPE_DOUBLE},
+        {"string", TokenType::TYPE_STRING},
+        {"bool", TokenType::TYPE_BOOL},
+        {"true", TokenType::BOOL_LITERAL},
+        {"false", TokenType::BOOL_LITERAL},
+        {"and", TokenType::AND},
+        {"or", TokenType::OR},
+        {"endl", TokenType::ENDL},
+    }};
+
+    // Perfect hash over the keyword set: length, first and last byte.
+    // Collision freedom is checked at compile time below, so adding a
+    // keyword that collides fails the build instead of misclassifying.
+    constexpr std::size_t KEYWORD_SLOTS = 32;
+
+    constexpr std::size_t keywordHash(std::string_view word) {
+        return (word.size() + static_cast<unsigned char>(word.front()) * 3u
+                + static_cast<unsigned char>(word.back())) & (KEYWORD_SLOTS - 1);
+    }
+
+    struct KeywordTable {
+        std::array<Keyword, KEYWORD_SLOTS> slots{};
+        bool perfect = true;
+    };
+
+    constexpr KeywordTable makeKeywordTable() {
+        KeywordTable table;
+        for (std::size_t i = 0; i < table.slots.size(); i++) {
+            table.slots[i] = Keyword{std::string_view{}, TokenType::IDENTIFIER};
+        }
+        for (const Keyword& kw : keywords) {
+            Keyword& slot = table.slots[keywordHash(kw.text)];
+            if (!slot.text.empty()) table.perfect = false;
+            slot = kw;
+        }
+        return table;
+    }
+
+    inline constexpr KeywordTable keywordTable = makeKeywordTable();
+    static_assert(keywordTable.perfect, "keyword hash has a collision, pick new constants");
+
+    // Keyword token type for an identifier-shaped word, or IDENTIFIER
+    constexpr TokenType lookupKeyword(std::string_view word) {
+        const Keyword& slot = keywordTable.slots[keywordHash(word)];
+        return slot.text == word ? slot.type : TokenType::IDENTIFIER;
+    }
+
+}
+
+#endif //LEXERTABLES_H
@@ -0,0 +1,34 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// 1-based line/column of a byte offset, as shown in diagnostics
+struct SourceLocation {
+    int line = 1;
+    int column = 1;
+};
+
+// Byte offsets of every line start in a source buffer. Built on first use so
+// the lexer never has to track line/column while scanning.
+class LineIndex {
+public:
+    void reset();
+    SourceLocation locate(std::string_view source, std::uint32_t offset);
+
+    // Line number of the buffer's first line, for buffers that hold only
+    // part of a file (kept across reset())
+    void setFirstLine(int line) { firstLine = line; }
+
+private:
+    std::vector<std::uint32_t> lineStarts;
+    bool built = false;
+    int firstLine = 1;
+    std::size_t lastLine = 1;   // 1-based, where the last lookup ended
+
+    void build(std::string_view source);
+};
+
+#endif //LINEINDEX_H
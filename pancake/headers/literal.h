@@ -1,27 +1,46 @@
 #ifndef LITERAL_H
 #define LITERAL_H
 
+#include <cstdint>
 #include <string>
-#include <vector>
-#include <memory>
+#include <string_view>
+#include "ast.h"
 #include "statements.h"
 #include "expressions.h"
+#include "valuetype.h"
 
 class Literal : public Expressions {
 public:
-    std::string value;
-    std::string type; // "int", "string", "bool", "double"
+    TextRef value;   // lexeme, or the contents for strings; see Ast::text()
 
-    Literal(const std::string& val, const std::string& type)
-        : value(val), type(type) {}
+    // Decoded by the parser, so evaluation never re-parses the lexeme
+    union {
+        int intValue = 0;
+        double doubleValue;
+        bool boolValue;
+        std::uint32_t constant;   // of a string; see Ast::addString()
+    };
 
-    std::string getType() const { return type; }
+    static const NodeKind KIND = NodeKind::LITERAL;
 
-    void debugPrint(int indent = 0) const override {
+    Literal(ValueType type, TextRef val)
+        : Expressions(KIND, type), value(val) {}
+
+    // A string literal, its text interned in `ast`
+    static Literal string(Ast& ast, std::string_view text) {
+        Literal literal(ValueType::STRING, TextRef());
+        literal.constant = ast.addString(text);
+        literal.value = ast.stringText(literal.constant);
+        return literal;
+    }
+
+    ValueType getType() const { return type; }
+
+    void debugPrint(const Ast& ast, int indent = 0) const {
         std::string ind(indent, ' ');
-        std::cout << ind << "Literal(" << type << "): " << value << "\n";
+        std::cout << ind << "Literal(" << typeName(type) << "): " << ast.text(value) << "\n";
     }
 };
 
 
-#endif //LITERAL_H
\ No newline at end of file
+#endif //LITERAL_H
@@ -0,0 +1,99 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include <cstdint>
+#include "token.h"
+
+// Operators of BinExpr and UnaryExpr, resolved from their token once by the
+// parser so evaluation switches on a small integer instead of comparing text.
+enum class BinaryOp : std::uint8_t {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    EQ,     // ==
+    NE,     // !=
+    LT,
+    GT,
+    LE,     // <=
+    GE,     // >=
+    AND,
+    OR,
+    NOT     // '!' in infix position; parses, but no operand types support it
+};
+
+enum class UnaryOp : std::uint8_t {
+    NOT,
+    NEGATE
+};
+
+// A binary operator specialized to the type its operands are evaluated as,
+// chosen once the type checker knows them. Evaluating a node is then one
+// switch on this, not a switch on the types followed by one on the operator.
+enum class Operation : std::uint8_t {
+    ADD_INT, SUB_INT, MUL_INT, DIV_INT, MOD_INT,
+    EQ_INT, NE_INT, LT_INT, GT_INT, LE_INT, GE_INT,
+    ADD_DOUBLE, SUB_DOUBLE, MUL_DOUBLE, DIV_DOUBLE,
+    EQ_DOUBLE, NE_DOUBLE, LT_DOUBLE, GT_DOUBLE, LE_DOUBLE, GE_DOUBLE,
+    CONCAT, EQ_STRING, NE_STRING,
+    AND, OR, EQ_BOOL, NE_BOOL
+};
+
+// Quotient and remainder of ints, the divisor not 0. INT_MIN / -1 wraps to
+// INT_MIN like the rest of int arithmetic, with remainder 0, where the
+// processor's division would trap.
+inline int divideInt(int l, int r) {
+    return r == -1 ? static_cast<int>(0u - static_cast<unsigned>(l)) : l / r;
+}
+
+inline int remainderInt(int l, int r) {
+    return r == -1 ? 0 : l % r;
+}
+
+// Operator for a token that getPrecedence() accepts as infix
+inline BinaryOp binaryOp(TokenType type) {
+    switch (type) {
+        case TokenType::PLUS: return BinaryOp::ADD;
+        case TokenType::MINUS: return BinaryOp::SUB;
+        case TokenType::MUL: return BinaryOp::MUL;
+        case TokenType::DIV: return BinaryOp::DIV;
+        case TokenType::MOD: return BinaryOp::MOD;
+        case TokenType::EE: return BinaryOp::EQ;
+        case TokenType::NE: return BinaryOp::NE;
+        case TokenType::LT: return BinaryOp::LT;
+        case TokenType::GT: return BinaryOp::GT;
+        case TokenType::LTE: return BinaryOp::LE;
+        case TokenType::GTE: return BinaryOp::GE;
+        case TokenType::AND: return BinaryOp::AND;
+        case TokenType::OR: return BinaryOp::OR;
+        default: return BinaryOp::NOT;
+    }
+}
+
+// Source spelling, for debug output and error messages
+inline const char* opName(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::ADD: return "+";
+        case BinaryOp::SUB: return "-";
+        case BinaryOp::MUL: return "*";
+        case BinaryOp::DIV: return "/";
+        case BinaryOp::MOD: return "mod";
+        case BinaryOp::EQ: return "==";
+        case BinaryOp::NE: return "!=";
+        case BinaryOp::LT: return "<";
+        case BinaryOp::GT: return ">";
+        case BinaryOp::LE: return "<=";
+        case BinaryOp::GE: return ">=";
+        case BinaryOp::AND: return "and";
+        case BinaryOp::OR: return "or";
+        case BinaryOp::NOT: return "!";
+    }
+    return "?";
+}
+
+inline const char* opName(UnaryOp op) {
+    return op == UnaryOp::NOT ? "!" : "-";
+}
+
+#endif //OPERATORS_H
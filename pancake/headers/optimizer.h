@@ -0,0 +1,59 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cstdint>
+#include <vector>
+#include "ast.h"
+
+class Literal;
+
+// Rewrites a parsed tree into a cheaper one with the same behaviour, output
+// and runtime errors included. Passes run in a fixed pipeline; the level
+// picks how much of it runs:
+//   0  nothing
+//   1  constant folding, dead branch removal, common subexpression
+//      elimination and joining of constant output, which each only look at
+//      one statement
+//   2  also constant propagation and dead store elimination, which need to
+//      see every use of a variable and so only run on whole programs
+class Optimizer {
+public:
+    static const int DEFAULT_LEVEL = 0;
+    static const int MAX_LEVEL = 2;
+
+    // `wholeProgram` is false for units that share variables with code the
+    // optimizer never sees, such as REPL lines and streamed statements
+    Optimizer(Ast& ast, int level, bool wholeProgram);
+
+    // Optimise the top-level statements `program`; the returned list replaces it
+    NodeList run(NodeList program);
+
+private:
+    struct Pass {
+        const char* name;
+        int level;          // lowest level the pass runs at
+        bool wholeProgram;  // needs every use of a variable in view
+        NodeList (Optimizer::*run)(NodeList program);
+    };
+    static const Pass PIPELINE[];
+
+    Ast& ast;
+    int level;
+    bool wholeProgram;
+
+    // Passes
+    NodeList foldConstants(NodeList program);
+    NodeList pruneBranches(NodeList program);
+    NodeList propagateConstants(NodeList program);
+    NodeList eliminateDeadStores(NodeList program);
+    NodeList eliminateCommonSubexpressions(NodeList program);
+    NodeList joinOutputs(NodeList program);
+
+    NodeId foldNode(NodeId id);
+    NodeId makeConstant(Literal literal, std::uint32_t offset);
+    void pruneStatement(NodeId id, std::vector<NodeId>& out);
+    NodeList pruneBlock(NodeList block);
+    void spliceBlock(NodeList block, std::vector<NodeId>& out);
+};
+
+#endif //OPTIMIZER_H
@@ -0,0 +1,115 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// A program's output, gathered in a large buffer and written with as few
+// system calls as the flush policy allows. Numbers are formatted exactly as
+// `std::cout <<` would (%d, and %g to 6 significant digits for doubles).
+//
+// With startWriter() a thread does the writing: full buffers are handed to
+// it through a ring, and the interpreter only waits when the ring is full,
+// so a slow reader of the output stalls it no sooner than it must.
+//
+// Anything else writing to the same file, such as error messages on a
+// shared terminal, must flush() first to keep the order.
+class Output {
+public:
+    enum class Flush {
+        LINE,    // after every line, so it is seen as soon as it is written
+        BLOCK,   // only when the buffer is full, or on flush()
+    };
+
+    static const std::size_t DEFAULT_RING = 1024 * 1024;   // bytes queued for the writer thread
+
+    // Buffered writer for the file descriptor, LINE if it is a terminal
+    explicit Output(int fd);
+    ~Output();   // flushes
+
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    // Standard output, flushed at exit
+    static Output& standard();
+
+    void setFlush(Flush policy) { flushPolicy = policy; }
+
+    // Write to the file instead, created or emptied; space for it is
+    // reserved ahead of the writes where the system supports it. False if
+    // it cannot be opened.
+    bool openFile(const std::string& path);
+
+    // Write from a thread of its own, queueing up to `capacity` bytes
+    void startWriter(std::size_t capacity = DEFAULT_RING);
+
+    void write(std::string_view text) {
+        if (text.size() <= CAPACITY - used) {
+            std::memcpy(buffer + used, text.data(), text.size());
+            used += text.size();
+        } else {
+            writeLong(text);
+        }
+    }
+    void write(int value) {
+        if (CAPACITY - used < NUMBER_WIDTH) handOver();
+        used += format(buffer + used, value);
+    }
+    void write(double value) {
+        if (CAPACITY - used < NUMBER_WIDTH) handOver();
+        used += format(buffer + used, value);
+    }
+    void write(bool value) { write(value ? std::string_view("true") : std::string_view("false")); }
+
+    // End the line, and pass it on when line-buffered
+    void endLine() {
+        if (used == CAPACITY) handOver();
+        buffer[used++] = '\n';
+        if (flushPolicy == Flush::LINE) handOver();
+    }
+
+    // Write out everything so far, waiting for the writer thread if any
+    void flush();
+
+    // Characters written to `out`, which has room for NUMBER_WIDTH
+    static const std::size_t NUMBER_WIDTH = 32;
+    static std::size_t format(char* out, int value);
+    static std::size_t format(char* out, double value);
+
+private:
+    static const std::size_t CAPACITY = 64 * 1024;   // of the buffer, and of each chunk in the ring
+    static const std::size_t DIRECT = 4096;          // strings this long are not copied into the buffer
+
+    struct Writer;
+
+    int fd;
+    bool ownsFile = false;
+    Flush flushPolicy;
+
+    std::unique_ptr<char[]> storage;   // the buffer, when there is no writer thread
+    char* buffer;                      // being filled
+    std::size_t used = 0;
+
+    // Bytes written to the file and space reserved for it; see openFile()
+    std::uint64_t written = 0;
+    std::uint64_t reserved = 0;
+    bool preallocate = false;
+
+    std::unique_ptr<Writer> writer;
+
+    void handOver();   // the buffer to the writer thread, or to the file
+    void writeLong(std::string_view text);
+    void drain();      // body of the writer thread
+    void stopWriter();
+    void close();
+
+    // Write to the file, from the writer thread when there is one
+    void sink(const char* data, std::size_t size);
+    void reserve(std::size_t size);
+};
+
+#endif //OUTPUT_H
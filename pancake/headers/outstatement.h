@@ -1,27 +1,22 @@
 #ifndef OUTSTATE_H
 #define OUTSTATE_H
 
-#include <memory>
-#include <vector>
 #include "statements.h"
 #include "expressions.h"
 
 class OutStatement : public Statements {
 public:
-    std::vector<std::unique_ptr<Expressions>> outputs;
+    NodeList outputs;   // expressions
 
-    explicit OutStatement(std::unique_ptr<Expressions> expr) {
-        outputs.push_back(std::move(expr));
-    }
+    static const NodeKind KIND = NodeKind::OUT;
 
-    // Optional: constructor for multiple expressions
-    explicit OutStatement(std::vector<std::unique_ptr<Expressions>> exprs)
-        : outputs(std::move(exprs)) {}
+    explicit OutStatement(NodeList exprs)
+        : Statements(KIND), outputs(exprs) {}
 
-    void debugPrint(int indent = 0) const override {
+    void debugPrint(const Ast& ast, int indent = 0) const {
         std::cout << std::string(indent, ' ') << "OutStatement\n";
-        for (const auto& expr : outputs) {
-            expr->debugPrint(indent + 2);
+        for (NodeId expr : ast.expressions(outputs)) {
+            ast.expression(expr)->debugPrint(ast, indent + 2);
         }
     }
 };
@@ -2,30 +2,36 @@
 #define PARSER_H
 
 #include <vector>
-#include <memory>
+#include <string>
+#include <cstdint>
 #include "token.h"      // for Token
+#include "tokenbuffer.h"
 #include "statements.h" // for Statements and subclasses
 #include "expressions.h"// for Expressions and subclasses
 #include "typechecker.h"
+#include "ast.h"
+#include "valuetype.h"
 
 class Parser
 {
 private:
-    const std::vector<Token>& tokens;
+    const TokenBuffer& tokens;
     size_t current;
 
     //Statement core functions
-    std::unique_ptr<Statements> parseStatement();
-    std::unique_ptr<Statements> parseVarDecl();
-    std::unique_ptr<Statements> parseOut();
-    std::unique_ptr<Statements> parseIn();
-    std::unique_ptr<Statements> parseIf();
-    std::unique_ptr<Statements> parseExpressionStatement();
+    NodeId parseStatement();
+    NodeId parseVarDecl();
+    NodeId parseOut();
+    NodeId parseIn();
+    NodeId parseIf();
+    NodeId parseExpressionStatement();
+    NodeList parseBlock(const std::string& closeMessage, Frame& frame);
 
     //Expression core functions
-    std::unique_ptr<Expressions> parseExpression();
-    std::unique_ptr<Expressions> parsePrimary();
-    std::unique_ptr<Expressions> parseBinary(std::unique_ptr<Expressions> left, int minPrecedence);
+    NodeId parseExpression();
+    NodeId parsePrimary();
+    NodeId parseBinary(NodeId left, int minPrecedence);
+    NodeId parseLiteral(ValueType type);
 
     //Utility functions to create AST
     bool match(TokenType type);
@@ -37,13 +43,25 @@ private:
     void consume(TokenType type, const std::string& errorMsg);
     int getPrecedence(const Token& tok);
     Token peekNext() const;
+    std::string text(const Token& tok) const;
     [[noreturn]] void error(const Token& token, const std::string& message) const;
+    [[noreturn]] void typeError(std::uint32_t offset, const std::string& message) const;
+    void checkCondition(NodeId condition) const;
 
-    std::unordered_map<std::string, std::string> variableTypes;
     TypeChecker& typeChecker;
+    Ast& ast;
 public:
-    std::vector<std::unique_ptr<Statements>> parse();
-    Parser(const std::vector<Token>& tokens, TypeChecker& typeChecker);
+    // Parse the whole program; its top-level statements, in order
+    NodeList parse();
+
+    // Parse one top-level statement; NO_NODE once only end of file is left
+    NodeId parseNext();
+
+    // Token cursor, for callers that parse a statement at a time
+    std::size_t position() const { return current; }
+    void seek(std::size_t tokenIndex);
+    // Nodes are added to `ast`, which must outlive their use
+    Parser(const TokenBuffer& tokens, TypeChecker& typeChecker, Ast& ast);
     
 };
 
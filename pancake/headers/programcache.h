@@ -0,0 +1,48 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <cstdint>
+#include <string>
+#include "ast.h"
+
+// Compiled programs kept on disk between runs, so running an unchanged
+// script skips tokenising, parsing, type checking and optimisation.
+//
+// An entry is the checked and optimised tree as a flat image: the nodes byte
+// for byte and referred to by offset, the node lists, the text pool, the
+// identifier names and the source itself. Entries are named by a hash of the
+// source, the -O level, the entry format version and the layout of the
+// stored structs, and loaded by mapping the file into memory; nothing is
+// parsed, and the nodes are used where they lie in the mapping. A loaded
+// tree is read-only: it is run, never optimised again.
+//
+// An entry is only used if its source matches byte for byte, its sum is
+// right and its offsets and ids check out; otherwise it is treated as
+// missing and written again. The least recently used entries are dropped
+// to keep the directory under 256 MiB ($PANCAKE_CACHE_LIMIT KiB if set),
+// and an entry that would take half of that is not written at all.
+class ProgramCache {
+public:
+    // Entries live in `directory`; empty picks $PANCAKE_CACHE_DIR, else
+    // $XDG_CACHE_HOME/pancake or ~/.cache/pancake (%LOCALAPPDATA%\pancake on
+    // Windows). With none of those set the cache is off.
+    explicit ProgramCache(std::string directory = "");
+
+    // Replace `ast` with the program cached for `source`; false if there is none
+    bool load(const std::string& source, int optimize, Ast& ast, NodeList& program);
+
+    // Save `program` for later runs. Best effort: an entry that cannot be
+    // written only costs the next run a compile.
+    void store(const std::string& source, int optimize, const Ast& ast, NodeList program);
+
+private:
+    std::string directory;
+    std::uintmax_t capacity;   // bytes of entries kept
+
+    std::string entryPath(std::uint64_t key) const;
+    void evict() const;   // drop the least recently used entries over the size cap
+    static std::uint64_t entryKey(const std::string& source, int optimize);
+    static std::uint64_t layout();   // of the structs stored byte for byte, hashed
+};
+
+#endif //PROGRAMCACHE_H
@@ -0,0 +1,46 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Bulk byte scanning used by the tokeniser and the line index. Each routine
+// has a scalar version plus SSE2/AVX2 versions on x86; the widest one the
+// CPU supports is picked once at startup. Build with -DPANCAKE_NO_SIMD to
+// force the scalar kernels.
+
+namespace scan {
+
+    // First index >= pos holding `c`, or source.size(). If nonAscii is given,
+    // it is set when a byte >= 0x80 occurs before that index.
+    std::size_t findByte(std::string_view source, std::size_t pos, char c, bool* nonAscii = nullptr);
+
+    // First index >= pos that is not a blank (space, \t, \v, \f, \r)
+    std::size_t skipSpaces(std::string_view source, std::size_t pos);
+
+    // Appends the offset just past every '\n' in source
+    void findLineStarts(std::string_view source, std::vector<std::uint32_t>& out);
+
+    // Strict UTF-8 check (no overlongs, surrogates or values above U+10FFFF)
+    bool validUtf8(std::string_view text);
+
+    // Name of the kernel set in use: "avx2", "sse2" or "scalar"
+    const char* kernelName();
+
+    // One set of kernels behind findByte, skipSpaces and findLineStarts,
+    // taking the data, the start and the size of the source
+    struct Kernels {
+        const char* name;
+        std::size_t (*findByte)(const char* data, std::size_t pos, std::size_t size, char c, bool* nonAscii);
+        std::size_t (*skipSpaces)(const char* data, std::size_t pos, std::size_t size);
+        void (*lineStarts)(const char* data, std::size_t size, std::vector<std::uint32_t>& out);
+    };
+
+    // Every kernel set this CPU can run, scalar first, so that tests can
+    // check the wide ones against it
+    std::vector<Kernels> kernelSets();
+
+}
+
+#endif //SCANNER_H
@@ -0,0 +1,28 @@
+#ifndef SHAREDEXPR_H
+#define SHAREDEXPR_H
+
+#include <cstdint>
+#include <string>
+#include "expressions.h"
+
+// A subexpression that occurs more than once in one statement, left there by
+// the optimizer. Every occurrence refers to the same SharedExpr; the
+// interpreter evaluates `expr` the first time the statement reaches it and
+// reuses the value for the other occurrences.
+class SharedExpr : public Expressions {
+public:
+    NodeId expr;
+    std::uint32_t slot;   // cache entry, unique within the statement
+
+    static const NodeKind KIND = NodeKind::SHARED;
+
+    SharedExpr(NodeId expr, ValueType type, std::uint32_t slot)
+        : Expressions(KIND, type), expr(expr), slot(slot) {}
+
+    void debugPrint(const Ast& ast, int indent = 0) const {
+        std::cout << std::string(indent, ' ') << "Shared(#" << slot << ")\n";
+        ast.expression(expr)->debugPrint(ast, indent + 2);
+    }
+};
+
+#endif //SHAREDEXPR_H
@@ -0,0 +1,43 @@
+#ifndef SOURCESTREAM_H
+#define SOURCESTREAM_H
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include "tokenbuffer.h"
+
+// Reads a script in fixed-size blocks and hands it out in tokenised chunks
+// that end on a top-level statement boundary (a newline outside braces), so
+// each chunk can be parsed, run and dropped before the next block is read.
+// Memory stays at about one block plus the longest statement.
+class SourceStream {
+public:
+    static const std::size_t DEFAULT_BLOCK = 64 << 10;
+
+    explicit SourceStream(std::istream& in, std::size_t blockSize = DEFAULT_BLOCK);
+
+    // Move to the next chunk; false once the input is used up. The previous
+    // chunk's text and tokens are invalid afterwards.
+    bool next();
+
+    std::string_view text() const { return chunk; }
+    const TokenBuffer& tokens() const { return chunkTokens; }
+
+    // File line the current chunk starts on
+    int firstLine() const { return chunkLine; }
+
+private:
+    std::istream& in;
+    std::size_t blockSize;
+    bool eof = false;
+
+    std::string buffer;          // input not yet handed out, starts with the current chunk
+    std::string_view chunk;
+    TokenBuffer chunkTokens;
+    int chunkLine = 1;
+
+    void fill(std::size_t bytes);
+};
+
+#endif //SOURCESTREAM_H
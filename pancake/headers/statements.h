@@ -3,14 +3,19 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <iostream>
 #include "astnodes.h"
 
 class Statements : public ASTNodes {        
     public:
-        int line = 0;
-        int column = 0;
-        virtual ~Statements() = default;
-        virtual void debugPrint(int indent = 0) const = 0;  // ← Add this
+        std::uint32_t offset = 0;  // byte offset into the source, resolved to line/column on error
+
+        // Print the tree below this node (dispatches on `kind`)
+        void debugPrint(const Ast& ast, int indent = 0) const;
+
+    protected:
+        explicit Statements(NodeKind kind) : ASTNodes(kind) {}
 };
 
 
@@ -0,0 +1,99 @@
+#ifndef SYMBOLMAP_H
+#define SYMBOLMAP_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "symboltable.h"
+
+// Open-addressing hash table keyed by Symbol, used for the global variable
+// environment and the type checker. Slots sit in one flat array and are
+// probed linearly; each keeps the Fibonacci hash of its key, so growing
+// never rehashes. Entries are never removed.
+template <typename V>
+class SymbolMap {
+public:
+    SymbolMap() { slots.resize(MIN_CAPACITY); }
+
+    V* find(Symbol key) {
+        std::size_t i = probe(key, hashOf(key));
+        return slots[i].key == key ? &slots[i].value : nullptr;
+    }
+
+    const V* find(Symbol key) const {
+        return const_cast<SymbolMap*>(this)->find(key);
+    }
+
+    bool contains(Symbol key) const { return find(key) != nullptr; }
+
+    // Value for `key`, default-constructed on first use
+    V& operator[](Symbol key) {
+        std::uint32_t hash = hashOf(key);
+        std::size_t i = probe(key, hash);
+        if (slots[i].key == key) return slots[i].value;
+
+        if ((count + 1) * 4 > slots.size() * 3) {
+            grow();
+            i = probe(key, hash);
+        }
+        slots[i].key = key;
+        slots[i].hash = hash;
+        count++;
+        return slots[i].value;
+    }
+
+    std::size_t size() const { return count; }
+
+    void clear() {
+        slots.assign(MIN_CAPACITY, Slot{});
+        count = 0;
+    }
+
+    // Call f(symbol, value) for every entry, in table order
+    template <typename F>
+    void forEach(F&& f) const {
+        for (const Slot& slot : slots) {
+            if (slot.key != NO_SYMBOL) f(slot.key, slot.value);
+        }
+    }
+
+private:
+    struct Slot {
+        Symbol key = NO_SYMBOL;
+        std::uint32_t hash = 0;
+        V value{};
+    };
+
+    static const std::size_t MIN_CAPACITY = 16;
+
+    std::vector<Slot> slots;   // size is a power of two
+    std::size_t count = 0;
+
+    static std::uint32_t hashOf(Symbol key) {
+        return key * 0x9E3779B1u;
+    }
+
+    // Slot holding `key`, or the empty slot where it would go
+    std::size_t probe(Symbol key, std::uint32_t hash) const {
+        std::size_t mask = slots.size() - 1;
+        std::size_t i = hash & mask;
+        while (slots[i].key != key && slots[i].key != NO_SYMBOL) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        std::size_t mask = slots.size() - 1;
+        for (Slot& slot : old) {
+            if (slot.key == NO_SYMBOL) continue;
+            std::size_t i = slot.hash & mask;
+            while (slots[i].key != NO_SYMBOL) i = (i + 1) & mask;
+            slots[i] = std::move(slot);
+        }
+    }
+};
+
+#endif //SYMBOLMAP_H
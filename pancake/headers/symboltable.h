@@ -0,0 +1,44 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Dense id of an interned identifier. 0 is never handed out, so it can mark
+// "no symbol" (tokens that are not identifiers, empty table slots).
+using Symbol = std::uint32_t;
+const Symbol NO_SYMBOL = 0;
+
+// Process-wide identifier interner. The tokeniser interns every identifier
+// once, so the parser, type checker and interpreter only ever compare and
+// hash small integers. Safe to use from several tokeniser threads.
+class SymbolTable {
+public:
+    static SymbolTable& global();
+
+    Symbol intern(std::string_view name);
+
+    // Spelling of an interned symbol; the reference stays valid for the
+    // lifetime of the table
+    const std::string& name(Symbol symbol) const;
+
+    std::size_t size() const;
+
+private:
+    SymbolTable();
+
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> names;                     // indexed by symbol, never moves
+    std::unordered_map<std::string_view, Symbol> ids;  // views into `names`
+};
+
+// Shorthand for SymbolTable::global().name(), used in messages and debug output
+inline const std::string& symbolName(Symbol symbol) {
+    return SymbolTable::global().name(symbol);
+}
+
+#endif //SYMBOLTABLE_H
@@ -0,0 +1,27 @@
+#ifndef SYNTAXERROR_H
+#define SYNTAXERROR_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "lineindex.h"
+
+// Error raised by the tokeniser or parser. what() reads
+// "<before>line L, column C<after>"; the parts and the byte offset are kept
+// so the location can be recomputed after the source has moved.
+class SyntaxError : public std::runtime_error {
+public:
+    std::uint32_t offset;
+    std::string before;
+    std::string after;
+
+    SyntaxError(std::uint32_t offset, SourceLocation loc, std::string before, std::string after)
+        : std::runtime_error(format(before, loc, after)),
+          offset(offset), before(std::move(before)), after(std::move(after)) {}
+
+    static std::string format(const std::string& before, SourceLocation loc, const std::string& after) {
+        return before + "line " + std::to_string(loc.line) + ", column " + std::to_string(loc.column) + after;
+    }
+};
+
+#endif //SYNTAXERROR_H
@@ -1,13 +1,11 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-#include <string>
-#include <variant>
-#include <vector>
-#include <iostream>
+#include <cstdint>
+#include "symboltable.h"
 
     // All possible token types
-    enum class TokenType {
+    enum class TokenType : std::uint8_t {
         // Keywords
         LET,
         OUT,
@@ -65,18 +63,20 @@
         UNKNOWN
     };
 
-    // A single token
-    class Token {
-        public:
-            TokenType type;
-            std::string value;
-            int line;
-            int column;
-            
-            Token(TokenType t, const std::string& v, int l, int c);
-            ~Token();
-
-            void debug() const ;
-
+    // A single token: a kind plus the byte range of its lexeme in the source.
+    // Tokens own no text; use TokenBuffer::text() to read the lexeme and
+    // TokenBuffer::location() to get line/column for diagnostics.
+    // Identifiers also carry their interned symbol.
+    struct Token {
+        TokenType type;
+        std::uint32_t offset;
+        std::uint32_t length;
+        Symbol symbol = NO_SYMBOL;
     };
+
+    // Offset where the lexer started the token; string literals keep only
+    // their contents, so they start one byte earlier at the opening quote
+    inline std::uint32_t tokenStart(const Token& token) {
+        return token.type == TokenType::STRING_LITERAL ? token.offset - 1 : token.offset;
+    }
 #endif // TOKEN_H
@@ -0,0 +1,61 @@
+#ifndef TOKENBUFFER_H
+#define TOKENBUFFER_H
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "token.h"
+#include "lineindex.h"
+
+// Structure-of-arrays token storage. Kinds, offsets, lengths and symbols
+// live in separate contiguous arrays and all lexemes are views into the source
+// buffer, which must outlive the TokenBuffer.
+class TokenBuffer {
+public:
+    explicit TokenBuffer(std::string_view source = {});
+
+    void reset(std::string_view source);
+    void reserve(std::size_t count);
+    void push(TokenType type, std::uint32_t offset, std::uint32_t length, Symbol symbol = NO_SYMBOL);
+    void append(const TokenBuffer& other);
+
+    // Point at a new copy of the source without touching the tokens
+    void rebind(std::string_view source);
+
+    // Keep only the first `count` tokens
+    void truncate(std::size_t count);
+
+    // Line number of the source's first line (see LineIndex::setFirstLine)
+    void setFirstLine(int line) { lines.setFirstLine(line); }
+
+    // Replace tokens [first, first + count) and move every later token by `shift` bytes
+    void splice(std::size_t first, std::size_t count, const std::vector<Token>& replacement, std::int64_t shift);
+
+    std::size_t size() const { return types.size(); }
+    bool empty() const { return types.empty(); }
+
+    TokenType type(std::size_t i) const { return types[i]; }
+    Symbol symbol(std::size_t i) const { return symbols[i]; }
+    Token operator[](std::size_t i) const { return Token{types[i], offsets[i], lengths[i], symbols[i]}; }
+    Token back() const { return (*this)[size() - 1]; }
+
+    std::string_view source() const { return src; }
+
+    // Lexeme of a token ("end_of_line"/"end_of_file" for the synthetic ones)
+    std::string_view text(const Token& token) const;
+
+    // Line/column of a token, only computed when a diagnostic needs it
+    SourceLocation location(const Token& token) const;
+
+    void debug(std::size_t i) const;
+
+private:
+    std::string_view src;
+    std::vector<TokenType> types;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+    std::vector<Symbol> symbols;       // NO_SYMBOL except for identifiers
+    mutable LineIndex lines;
+};
+
+#endif //TOKENBUFFER_H
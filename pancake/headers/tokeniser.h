@@ -2,18 +2,18 @@
 #define TOKENISER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "token.h"
+#include "tokenbuffer.h"
 
 class Tokeniser {
     private:
-        std::vector<Token> tokens;
+        TokenBuffer tokens;
         std::size_t tokenIndex = 0;
 
-        std::string source;
+        std::string_view source;   // not owned, must outlive the tokeniser
         std::size_t pos;
-        int line;
-        int col;
 
         char currentChar();
         char peek() const;
@@ -22,19 +22,28 @@ class Tokeniser {
         void skipComment();
         bool isAtEnd() const;
 
+        Token makeToken(TokenType type, std::size_t start) const;
         Token makeNumber();
         Token makeString();
         Token makeIdentifierOrKeyword();
         Token nextToken();  // internal use
+        std::size_t lexRange(std::size_t begin, std::size_t end);
+        [[noreturn]] void error(std::size_t offset, const std::string& message) const;
 
     public:
-        explicit Tokeniser(const std::string& source);
+        explicit Tokeniser(std::string_view source, int firstLine = 1);
         ~Tokeniser() = default;
 
-        void tokenize();               // fill the `tokens` vector
+        void tokenize();               // fill the `tokens` buffer
+        void tokenizeParallel(unsigned workers = 0);  // same result, chunks lexed on a thread pool
         Token token();                 // return current token and advance
-        const std::vector<Token>& getTokens() const;  // optional getter
+
+        // Lex one token at a time from an arbitrary offset (incremental re-lexing)
+        void seek(std::size_t offset);
+        Token scanNext();
+        const TokenBuffer& getTokens() const;  // optional getter
+        TokenBuffer takeTokens();              // move the tokens out, leaves the tokeniser empty
 
 };
 
-#endif // TOKENISER_H
\ No newline at end of file
+#endif // TOKENISER_H
@@ -1,22 +1,94 @@
 #ifndef TYPECHECKER_H
 #define TYPECHECKER_H
 
-#include <unordered_map>
-#include <string>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+#include "ast.h"
+#include "symbolmap.h"
+#include "valuetype.h"
+#include "operators.h"
 
+// Static types of variables and the typing rules of the operators. The
+// parser asks it for the type of every expression it builds and rejects the
+// program when an operator, condition or store does not fit, so at run time
+// every value has the type its node was annotated with.
+//
+// It also resolves names. Each block is a scope of its own, and a variable
+// declared in a block shadows one of the same name outside it. Without
+// functions a block runs at most once per run of its top-level statement,
+// so the variables of all blocks in a statement get slots of their own, in
+// one flat frame, and a block clears only its slots as it is entered.
+// Variables of the global scope are slotted by their symbol, so REPL lines,
+// streamed statements and separately parsed parts of a document agree on
+// where each one lives.
 class TypeChecker {
 public:
-    std::unordered_map<std::string, std::string> variableTypes;
+    // Where a name lives: `depth` is the nesting of the scope declaring it,
+    // 0 for the global scope; `slot` is the symbol of a global, else the
+    // variable's slot in the frame
+    struct Binding {
+        ValueType type;
+        std::uint32_t depth;
+        std::uint32_t slot;
+    };
 
-    void declare(const std::string& name, const std::string& type) {
-        variableTypes[name] = type;
-    }
+    SymbolMap<ValueType> variableTypes;   // the global scope
+
+    // Asked for global names not declared here, e.g. declarations that
+    // belong to other, already parsed parts of the program
+    std::function<std::optional<ValueType>(Symbol)> fallback;
+
+    // Declare `name` in the innermost open scope; returns its slot. A name
+    // declared again in the same scope keeps its slot.
+    std::uint32_t declare(Symbol name, ValueType type);
 
-    std::string getType(const std::string& name) const {
-        auto it = variableTypes.find(name);
-        if (it != variableTypes.end()) return it->second;
-        return ""; // unknown variable
+    std::optional<Binding> resolve(Symbol name) const;
+
+    std::optional<ValueType> getType(Symbol name) const {
+        std::optional<Binding> binding = resolve(name);
+        if (!binding) return std::nullopt; // unknown variable
+        return binding->type;
     }
+
+    // Open a block's scope; closing it returns the slots of its variables
+    void enterScope();
+    Frame exitScope();
+    std::uint32_t depth() const { return static_cast<std::uint32_t>(scopes.size()); }
+
+    // Type of `left op right`; none if the operand types do not support `op`
+    static std::optional<ValueType> binaryType(BinaryOp op, ValueType left, ValueType right);
+
+    // Type both operands of a supported `left op right` are evaluated as:
+    // mixed int and double operands are both widened to double
+    static ValueType operandType(ValueType left, ValueType right);
+
+    // `op` on operands of type `operands`, which must support it
+    static Operation specialize(BinaryOp op, ValueType operands);
+
+    // Type of `op operand`; none if the operand type does not support `op`
+    static std::optional<ValueType> unaryType(UnaryOp op, ValueType operand);
+
+private:
+    // A variable of an open block
+    struct Local {
+        Symbol name;
+        ValueType type;
+        std::uint32_t depth;
+        std::uint32_t slot;
+        std::uint32_t shadowed;   // entry in `locals` it hides, plus one; 0 if none
+    };
+
+    struct Scope {
+        std::size_t firstLocal;   // its entries in `locals` start here
+        std::uint32_t firstSlot;
+    };
+
+    std::uint32_t nextSlot = 0;           // in the frame of the current top-level statement
+    std::vector<Local> locals;            // innermost scope last
+    std::vector<Scope> scopes;            // open blocks, innermost last
+    SymbolMap<std::uint32_t> innermost;   // entry in `locals` a name refers to, plus one; 0 if none
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,25 +2,31 @@
 #define UNARYEXPR_H
 
 #include "expressions.h"
-#include <memory>
+#include "operators.h"
 #include <string>
+#include <string_view>
 #include <iostream>
 
 class UnaryExpr : public Expressions {
-    std::string op;
-    std::unique_ptr<Expressions> expr;
+    friend class ProgramCache;   // hashes the layout of cached nodes
+
+    UnaryOp op;
+    NodeId expr;
 
 public:
-    UnaryExpr(std::string op, std::unique_ptr<Expressions> expr)
-        : op(std::move(op)), expr(std::move(expr)) {}
+    static const NodeKind KIND = NodeKind::UNARY;
+
+    UnaryExpr(UnaryOp op, NodeId expr)
+        : Expressions(KIND), op(op), expr(expr) {}
 
-    const std::string& getOp() const { return op; }
-    const Expressions* getExpr() const { return expr.get(); }
+    UnaryOp getOp() const { return op; }
+    NodeId getExpr() const { return expr; }
+    void setExpr(NodeId operand) { expr = operand; }
 
-    void debugPrint(int indent = 0) const override {
+    void debugPrint(const Ast& ast, int indent = 0) const {
         std::string pad(indent, ' ');
-        std::cout << pad << "UnaryExpr(" << op << ")\n";
-        expr->debugPrint(indent + 2);
+        std::cout << pad << "UnaryExpr(" << opName(op) << ")\n";
+        ast.expression(expr)->debugPrint(ast, indent + 2);
     }
 };
 
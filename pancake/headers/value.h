@@ -0,0 +1,120 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "valuetype.h"
+
+// A runtime value in 16 bytes: its type tag and the value itself. Ints,
+// doubles and bools are stored inline, as are strings of up to 14 bytes;
+// longer strings live in an immutable, reference-counted buffer, so copying
+// a value never copies text or allocates.
+//
+// The accessors do not check the tag. The type checker has given every
+// expression its type, and the interpreter reads each value as that type.
+class Value {
+public:
+    // No value, e.g. the contents of a variable not declared yet
+    Value() : tag(ValueType::ENDL), shortLength(0) { bits = 0; }
+    explicit Value(int value) : tag(ValueType::INT), shortLength(0) { bits = 0; intValue = value; }
+    explicit Value(double value) : tag(ValueType::DOUBLE), shortLength(0) { doubleValue = value; }
+    explicit Value(bool value) : tag(ValueType::BOOL), shortLength(0) { bits = 0; boolValue = value; }
+    explicit Value(std::string_view text);
+    explicit Value(const char* text) : Value(std::string_view(text)) {}   // not Value(bool)
+
+    // The strings of `parts` one after another, sized first and built in
+    // one allocation at most
+    static Value join(const Value* parts, std::size_t count);
+
+    Value(const Value& other) {
+        copyFrom(other);
+        if (isLong()) text->references++;
+    }
+    Value(Value&& other) noexcept {
+        copyFrom(other);
+        other.shortLength = 0;   // the buffer, if any, is ours now
+    }
+    Value& operator=(const Value& other) {
+        if (other.isLong()) other.text->references++;
+        release();
+        copyFrom(other);
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            copyFrom(other);
+            other.shortLength = 0;
+        }
+        return *this;
+    }
+    ~Value() { release(); }
+
+    ValueType type() const { return tag; }
+    bool empty() const { return tag == ValueType::ENDL; }
+
+    int asInt() const { return intValue; }
+    double asDouble() const { return doubleValue; }
+    bool asBool() const { return boolValue; }
+    std::string_view asString() const {
+        if (isLong()) return std::string_view(text->chars(), text->length);
+        return std::string_view(shortChars(), shortLength);
+    }
+
+    // Whether two strings hold the same text. Copies of a long string share
+    // its buffer, as do all uses of an interned literal (see
+    // Ast::addString()), so those compare by pointer, without the text.
+    bool sameString(const Value& other) const {
+        if (isLong() && other.isLong() && text == other.text) return true;
+        return asString() == other.asString();
+    }
+
+private:
+    friend class Jit;   // generates code reading values in place
+
+    // Heap storage of a long string, the characters following the header
+    struct Text {
+        std::size_t references;
+        std::size_t length;
+        char* chars() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    static const std::size_t SHORT_CAPACITY = 14;
+    static const std::uint8_t LONG = 0xFF;   // shortLength of a string in a Text
+
+    ValueType tag;
+    std::uint8_t shortLength;   // bytes of an inline string, or LONG
+    char shortStart[6] = {};    // an inline string runs on into the payload below
+    union {
+        int intValue;
+        double doubleValue;
+        bool boolValue;
+        Text* text;
+        std::uint64_t bits;     // the payload as a whole, for copying
+    };
+
+    bool isLong() const { return shortLength == LONG; }
+    const char* shortChars() const { return reinterpret_cast<const char*>(this) + offsetof(Value, shortStart); }
+    char* shortChars() { return reinterpret_cast<char*>(this) + offsetof(Value, shortStart); }
+
+    void copyFrom(const Value& other) {
+        tag = other.tag;
+        shortLength = other.shortLength;
+        std::memcpy(shortStart, other.shortStart, sizeof shortStart);
+        bits = other.bits;
+    }
+
+    void release() {
+        if (isLong() && --text->references == 0) freeText(text);
+    }
+
+    static Text* allocateText(std::size_t length);
+    static void freeText(Text* text);
+    char* reserveString(std::size_t length);   // make this a string of that length; returns its bytes
+};
+
+static_assert(sizeof(Value) == 16, "Value is the tag and an 8-byte payload");
+
+#endif //VALUE_H
@@ -0,0 +1,26 @@
+#ifndef VALUETYPE_H
+#define VALUETYPE_H
+
+#include <cstdint>
+
+// Type of a declared variable or an expression
+enum class ValueType : std::uint8_t {
+    INT,
+    DOUBLE,
+    STRING,
+    BOOL,
+    ENDL    // only the `endl` literal; it has no runtime value
+};
+
+inline const char* typeName(ValueType type) {
+    switch (type) {
+        case ValueType::INT: return "int";
+        case ValueType::DOUBLE: return "double";
+        case ValueType::STRING: return "string";
+        case ValueType::BOOL: return "bool";
+        case ValueType::ENDL: return "endl";
+    }
+    return "?";
+}
+
+#endif //VALUETYPE_H
@@ -2,23 +2,29 @@
 #define VARDECL_H
 
 #include <string>
-#include <vector>
-#include <memory>
+#include <cstdint>
+#include <string_view>
 #include "statements.h"
 #include "expressions.h"
+#include "symboltable.h"
+#include "valuetype.h"
 
 class VarDecl : public Statements {
 public:
-    std::string type;  // "int", "double", etc.
-    std::string name;
-    std::unique_ptr<Expressions> value;
+    ValueType type;
+    Symbol name;
+    NodeId value;
+    std::uint32_t depth = 0;   // where the variable lives; see TypeChecker::Binding
+    std::uint32_t slot = 0;
 
-    VarDecl(const std::string& type, const std::string& name, std::unique_ptr<Expressions> value)
-        : type(type), name(name), value(std::move(value)) {}
+    static const NodeKind KIND = NodeKind::VAR_DECL;
 
-    void debugPrint(int indent = 0) const override {
-        std::cout << std::string(indent, ' ') << "VarDecl(" << type << " " << name << ")\n";
-        value->debugPrint(indent + 2);
+    VarDecl(ValueType type, Symbol name, NodeId value)
+        : Statements(KIND), type(type), name(name), value(value) {}
+
+    void debugPrint(const Ast& ast, int indent = 0) const {
+        std::cout << std::string(indent, ' ') << "VarDecl(" << typeName(type) << " " << symbolName(name) << ")\n";
+        ast.expression(value)->debugPrint(ast, indent + 2);
     }
 };
 
@@ -2,18 +2,22 @@
 #define VAREXPR_H
 
 #include <string>
-#include <vector>
-#include <memory>
+#include <cstdint>
 #include "statements.h"
 #include "expressions.h"
+#include "symboltable.h"
 
 class VarExpr : public Expressions {        
     public:
-        std::string name;
-        explicit VarExpr(const std::string& name) : name(name) {}
+        Symbol name;
+        std::uint32_t depth = 0;   // where the variable lives; see TypeChecker::Binding
+        std::uint32_t slot = 0;
+        static const NodeKind KIND = NodeKind::VAR;
 
-        void debugPrint(int indent = 0) const override {
-            std::cout << std::string(indent, ' ') << "VarExpr(" << name << ")\n";
+        explicit VarExpr(Symbol name) : Expressions(KIND), name(name) {}
+
+        void debugPrint(const Ast&, int indent = 0) const {
+            std::cout << std::string(indent, ' ') << "VarExpr(" << symbolName(name) << ")\n";
         }
 };
 
@@ -0,0 +1,63 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.h"
+#include "bytecode.h"
+#include "compiler.h"
+#include "lineindex.h"
+#include "value.h"
+
+// Runs bytecode from BytecodeCompiler, the alternative to walking the tree.
+// Globals persist across calls, like the interpreter's variables.
+class VM {
+public:
+    // Compile and run statements, a batch at a time. With no loops in the
+    // language every instruction runs at most once, so bytecode for a whole
+    // program would cost more in memory traffic than it saves; a small
+    // reused buffer stays in cache.
+    void execute(const Ast& ast, NodeList statements);
+
+    // Source the bytecode was compiled from, used to turn instruction
+    // offsets into line/column; see Interpreter::setSource()
+    void setSource(std::string_view source, int firstLine = 1);
+
+private:
+    static const std::uint32_t BATCH = 256;   // statements compiled at a time
+
+    BytecodeCompiler compiler;   // numbers the variable slots below
+
+    // Contents of a value register or global; which member is live is
+    // known statically from the instruction reading it
+    union Scalar {
+        int i = 0;
+        double d;
+        bool b;
+    };
+
+    // Strings are held as the interpreter holds them, so moving one
+    // between a global, a register and a constant copies no text
+    struct Global {
+        Scalar value;
+        Value text;         // value of a string global
+        bool set = false;   // declared, assigned or read into
+    };
+
+    std::vector<Global> globals;
+    std::vector<Scalar> values;    // value register file
+    std::vector<Value> strings;    // string register file
+    std::vector<Value> pieces;     // a JOIN's operands, gathered
+
+    std::string_view source;
+    LineIndex lines;
+
+    void run(const Bytecode& code);
+
+    [[noreturn]] void runtimeError(std::uint32_t offset, const std::string& msg);
+};
+
+#endif //VM_H
@@ -0,0 +1,468 @@
+#include "./headers/input.h"
+#include "./headers/scanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+static bool isTerminal(int fd) { return _isatty(fd) != 0; }
+static int openForReading(const std::string& path) { return _open(path.c_str(), _O_RDONLY | _O_BINARY); }
+static void closeFile(int fd) { _close(fd); }
+
+static bool isRegular(int fd) {
+    struct _stat64 info;
+    return _fstat64(fd, &info) == 0 && (info.st_mode & _S_IFMT) == _S_IFREG;
+}
+
+// Bytes read, 0 at the end, negative on an error
+static long readSome(int fd, char* out, std::size_t size) {
+    return _read(fd, out, static_cast<unsigned>(size));
+}
+
+#else
+
+static bool isTerminal(int fd) { return isatty(fd) != 0; }
+static int openForReading(const std::string& path) { return ::open(path.c_str(), O_RDONLY | O_CLOEXEC); }
+static void closeFile(int fd) { ::close(fd); }
+
+static bool isRegular(int fd) {
+    struct stat info;
+    return fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+}
+
+static long readSome(int fd, char* out, std::size_t size) {
+    for (;;) {
+        ssize_t n = ::read(fd, out, size);
+        if (n >= 0 || errno != EINTR) return static_cast<long>(n);
+    }
+}
+
+#endif
+
+
+// ---- Background reader ----
+
+// Blocks read ahead of the program, handed over under the mutex; at 64 KiB
+// each, that is one lock per several thousand lines. The thread is not
+// joined: it may be waiting on a pipe that never closes, and holds its own
+// reference to this state.
+struct Input::Reader {
+    static const std::size_t BLOCK = 64 * 1024;
+    static const std::size_t AHEAD = 16;   // blocks read before they are asked for
+
+    int fd;
+    bool owned;   // closed by the thread when it is done
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> blocks;
+    bool done = false;        // end of the input, or a read error
+    bool abandoned = false;   // the Input has been closed
+
+    Reader(int fd, bool owned) : fd(fd), owned(owned) {}
+
+    void run() {
+        for (;;) {
+            std::string next(BLOCK, '\0');
+            long n = readSome(fd, &next[0], BLOCK);
+            std::unique_lock<std::mutex> lock(mutex);
+            if (n <= 0 || abandoned) break;
+            next.resize(static_cast<std::size_t>(n));
+            changed.wait(lock, [&] { return blocks.size() < AHEAD || abandoned; });
+            if (abandoned) break;
+            blocks.push_back(std::move(next));
+            changed.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            changed.notify_all();
+        }
+        if (owned) closeFile(fd);
+    }
+
+    // The next block, false once there are no more
+    bool take(std::string& out) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return !blocks.empty() || done; });
+        if (blocks.empty()) return false;
+        out = std::move(blocks.front());
+        blocks.pop_front();
+        changed.notify_all();
+        return true;
+    }
+};
+
+
+// ---- Input ----
+
+Input::~Input() {
+    close();
+    if (recording) writeLog();
+}
+
+Input& Input::standard() {
+    static Input in;
+    return in;
+}
+
+bool Input::openFile(const std::string& path) {
+    int fd = openForReading(path);
+    if (fd < 0) return false;
+    close();
+    defer(fd, true);
+    return true;
+}
+
+bool Input::openStandard() {
+    if (isTerminal(0)) return false;
+    close();
+    defer(0, false);
+    return true;
+}
+
+// Until a line is asked for, nothing is read: reading ahead of a script
+// that never reads would take input meant for the next program on a pipe
+void Input::defer(int fd, bool owned) {
+    pendingFd = fd;
+    pendingOwned = owned;
+    kind = Kind::PENDING;
+}
+
+void Input::bind(int fd, bool owned) {
+    if (isRegular(fd)) {
+#ifdef _WIN32
+        char chunk[64 * 1024];
+        for (long n; (n = readSome(fd, chunk, sizeof chunk)) > 0;) contents.append(chunk, static_cast<std::size_t>(n));
+        if (owned) closeFile(fd);
+        data = contents.data();
+        size = contents.size();
+        position = 0;
+        kind = Kind::MAPPED;
+        return;
+#else
+        // From the current offset, which a shell may have moved on already
+        struct stat info;
+        off_t start = lseek(fd, 0, SEEK_CUR);
+        if (fstat(fd, &info) == 0) {
+            std::size_t length = static_cast<std::size_t>(info.st_size);
+            void* p = length > 0 ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+            if (length == 0 || p != MAP_FAILED) {
+                if (p) {
+                    madvise(p, length, MADV_SEQUENTIAL);
+                    madvise(p, length, MADV_WILLNEED);
+                }
+                data = static_cast<const char*>(p);
+                size = length;
+                position = start > 0 ? std::min(static_cast<std::size_t>(start), length) : 0;
+                kind = Kind::MAPPED;
+                if (owned) closeFile(fd);
+                return;
+            }
+        }
+        // Not mappable after all; read it like a pipe
+#endif
+    }
+    reader = std::make_shared<Reader>(fd, owned);
+    std::shared_ptr<Reader> shared = reader;
+    std::thread([shared] { shared->run(); }).detach();
+    block.clear();
+    blockPosition = 0;
+    partial.clear();
+    kind = Kind::STREAMED;
+}
+
+void Input::close() {
+    if (kind == Kind::PENDING && pendingOwned) closeFile(pendingFd);
+    pendingFd = -1;
+    if (reader) {
+        std::lock_guard<std::mutex> lock(reader->mutex);
+        reader->abandoned = true;
+        reader->changed.notify_all();
+    }
+    reader.reset();
+#ifndef _WIN32
+    if (kind == Kind::MAPPED && data) munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+    contents.clear();
+    kind = Kind::NONE;
+}
+
+bool Input::nextLine(std::string_view& out) {
+    if (kind == Kind::PENDING) bind(pendingFd, pendingOwned);
+    if (kind == Kind::NONE) {
+        if (!std::getline(std::cin, line)) return false;
+        out = line;
+        return true;
+    }
+    if (kind == Kind::MAPPED) {
+        if (position >= size) return false;
+        std::string_view all(data, size);
+        std::size_t end = scan::findByte(all, position, '\n');
+        out = all.substr(position, end - position);
+        position = end + 1;
+        return true;
+    }
+
+    for (;;) {
+        std::size_t end = scan::findByte(block, blockPosition, '\n');
+        if (end < block.size()) {
+            std::string_view rest = std::string_view(block).substr(blockPosition, end - blockPosition);
+            blockPosition = end + 1;
+            if (partial.empty()) {
+                out = rest;
+            } else {
+                partial += rest;
+                line.swap(partial);
+                partial.clear();
+                out = line;
+            }
+            return true;
+        }
+        partial.append(block, blockPosition, std::string::npos);
+        blockPosition = 0;
+        if (!reader->take(block)) {
+            block.clear();
+            if (partial.empty()) return false;
+            // A last line with no '\n' after it
+            line.swap(partial);
+            partial.clear();
+            out = line;
+            return true;
+        }
+    }
+}
+
+Input::Status Input::read(ValueType type, SourceLocation where, Value& value) {
+    if (replaying) {
+        // The recorded run's reads all have entries, its end of input too,
+        // so a log that runs out was cut short
+        std::size_t after = logPosition;
+        if (logPosition == log.size() || !decodeEntry(log, after, next)) {
+            damaged = true;
+            failedReplay = true;
+            return Status::MISMATCH;
+        }
+        if (next.type != type || next.line != static_cast<std::uint32_t>(where.line) ||
+            next.column != static_cast<std::uint32_t>(where.column)) {
+            failedReplay = true;
+            return Status::MISMATCH;
+        }
+        if (next.ended) return Status::END;
+        value = next.value;
+        logPosition = after;
+        replayed++;
+    } else {
+        std::string_view text;
+        if (!nextLine(text)) {
+            if (recording) logEnd(type, where);
+            return Status::END;
+        }
+        value = Value();
+        switch (type) {
+            case ValueType::INT: value.intValue = toInt(text); break;
+            case ValueType::DOUBLE: value.doubleValue = toDouble(text); break;
+            default: value.text = text; break;
+        }
+    }
+    if (recording) logEntry(type, where, value);
+    return Status::OK;
+}
+
+
+// ---- Input logs ----
+//
+// "PNCINLOG", then one entry per value read: its type (one byte), the line
+// and column of the `in` statement, and the value. Integers are LEB128
+// varints, ints zigzag-encoded first; a double is its 8 bytes as stored in
+// memory; a string is its length and bytes. A read that found the input at
+// its end has LOG_ENDED set in the type byte, and no value.
+
+static const char LOG_MAGIC[8] = {'P', 'N', 'C', 'I', 'N', 'L', 'O', 'G'};
+static const std::size_t LOG_BUFFER = 64 * 1024;   // written out when this full
+static const unsigned char LOG_ENDED = 0x80;
+
+static void putVarint(std::string& out, std::uint64_t n) {
+    while (n >= 0x80) {
+        out += static_cast<char>((n & 0x7F) | 0x80);
+        n >>= 7;
+    }
+    out += static_cast<char>(n);
+}
+
+// False if the varint runs past `end` or does not fit
+static bool getVarint(const char*& p, const char* end, std::uint64_t& n) {
+    n = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(*p++);
+        n |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool Input::record(const std::string& path) {
+    logFile.open(path, std::ios::binary | std::ios::trunc);
+    if (!logFile) return false;
+    logFile.write(LOG_MAGIC, sizeof LOG_MAGIC);
+    recording = true;
+    return true;
+}
+
+void Input::logEntry(ValueType type, SourceLocation where, const Value& value) {
+    logBuffer += static_cast<char>(type);
+    putVarint(logBuffer, static_cast<std::uint32_t>(where.line));
+    putVarint(logBuffer, static_cast<std::uint32_t>(where.column));
+    switch (type) {
+        case ValueType::INT: {
+            std::uint32_t n = static_cast<std::uint32_t>(value.intValue);
+            putVarint(logBuffer, (n << 1) ^ (value.intValue < 0 ? 0xFFFFFFFFu : 0));
+            break;
+        }
+        case ValueType::DOUBLE:
+            logBuffer.append(reinterpret_cast<const char*>(&value.doubleValue), sizeof value.doubleValue);
+            break;
+        default:
+            putVarint(logBuffer, value.text.size());
+            logBuffer += value.text;
+            break;
+    }
+    if (logBuffer.size() >= LOG_BUFFER) writeLog();
+}
+
+void Input::logEnd(ValueType type, SourceLocation where) {
+    logBuffer += static_cast<char>(static_cast<unsigned char>(type) | LOG_ENDED);
+    putVarint(logBuffer, static_cast<std::uint32_t>(where.line));
+    putVarint(logBuffer, static_cast<std::uint32_t>(where.column));
+}
+
+void Input::writeLog() {
+    logFile.write(logBuffer.data(), static_cast<std::streamsize>(logBuffer.size()));
+    logFile.flush();
+    logBuffer.clear();
+}
+
+// The entry at `position`, which is moved past it; false if there is none
+// in one piece
+bool Input::decodeEntry(std::string_view log, std::size_t& position, Entry& entry) {
+    const char* p = log.data() + position;
+    const char* end = log.data() + log.size();
+    std::uint64_t line = 0, column = 0, n = 0;
+    unsigned char tag = static_cast<unsigned char>(*p++);
+    entry.type = static_cast<ValueType>(tag & ~LOG_ENDED);
+    entry.ended = (tag & LOG_ENDED) != 0;
+    if (!getVarint(p, end, line) || !getVarint(p, end, column)) return false;
+    entry.line = static_cast<std::uint32_t>(line);
+    entry.column = static_cast<std::uint32_t>(column);
+    entry.value = Value();
+    if (entry.ended) {
+        position = static_cast<std::size_t>(p - log.data());
+        return true;
+    }
+    switch (entry.type) {
+        case ValueType::INT:
+            if (!getVarint(p, end, n)) return false;
+            entry.value.intValue = static_cast<int>(static_cast<std::uint32_t>((n >> 1) ^ (0 - (n & 1))));
+            break;
+        case ValueType::DOUBLE:
+            if (end - p < static_cast<std::ptrdiff_t>(sizeof(double))) return false;
+            std::memcpy(&entry.value.doubleValue, p, sizeof(double));
+            p += sizeof(double);
+            break;
+        case ValueType::STRING:
+            if (!getVarint(p, end, n) || n > static_cast<std::uint64_t>(end - p)) return false;
+            entry.value.text = std::string_view(p, n);
+            p += n;
+            break;
+        default:
+            return false;
+    }
+    position = static_cast<std::size_t>(p - log.data());
+    return true;
+}
+
+// The log is read whole, so replaying never waits on the disk; entries are
+// decoded as they are asked for
+bool Input::replay(const std::string& path, std::string& error) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    std::streamoff length = file ? static_cast<std::streamoff>(file.tellg()) : -1;
+    if (length < 0) {
+        error = "Could not open file '" + path + "'";
+        return false;
+    }
+    log.resize(static_cast<std::size_t>(length));
+    file.seekg(0);
+    file.read(&log[0], length);
+    if (log.size() < sizeof LOG_MAGIC || std::memcmp(log.data(), LOG_MAGIC, sizeof LOG_MAGIC) != 0) {
+        error = "'" + path + "' is not an input log";
+        return false;
+    }
+    logPosition = sizeof LOG_MAGIC;
+    replayed = 0;
+    damaged = false;
+    failedReplay = false;
+    replaying = true;
+    return true;
+}
+
+std::string Input::mismatch() const {
+    if (damaged && logPosition == log.size()) return "Input log ends after " + std::to_string(replayed) + " values";
+    if (damaged) return "Input log is damaged after " + std::to_string(replayed) + " values";
+    return std::string("Replayed input does not match: the log has ") + (next.ended ? "the end of " : "") +
+           typeName(next.type) + " input for line " + std::to_string(next.line) + ", column " +
+           std::to_string(next.column) + " next";
+}
+
+
+// from_chars() takes neither the leading blanks nor the '+' that stoi/stod
+// skip; those, and the errors, are left to the library functions
+static bool plainNumber(std::string_view text) {
+    return !text.empty() && text[0] != '+' && !std::isspace(static_cast<unsigned char>(text[0]));
+}
+
+int Input::toInt(std::string_view text) {
+    if (plainNumber(text)) {
+        int value;
+        if (std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc()) return value;
+    }
+    return std::stoi(std::string(text));
+}
+
+double Input::toDouble(std::string_view text) {
+    if (plainNumber(text)) {
+        double value;
+        const char* last = text.data() + text.size();
+        auto result = std::from_chars(text.data(), last, value);
+        // strtod also reads hex ("0x1p3", where from_chars stops at the x),
+        // and reports results too small for a normal double as out of
+        // range; a zero is exact unless it came with an exponent
+        if (result.ec == std::errc() && (result.ptr == last || (*result.ptr != 'x' && *result.ptr != 'X'))) {
+            std::string_view read = text.substr(0, result.ptr - text.data());
+            if (std::isnormal(value) || (value == 0 && read.find_first_of("eE") == std::string_view::npos)) return value;
+        }
+    }
+    return std::stod(std::string(text));
+}
@@ -1,6 +1,5 @@
 #include <unordered_map>
 #include <string>
-#include <any>
 #include <vector>
 #include <memory>
 #include <iostream>
@@ -15,283 +14,400 @@
 #include "./headers/instatement.h"
 #include "./headers/outstatement.h"
 #include "./headers/assignment.h"
+#include "./headers/input.h"
+#include "./headers/output.h"
 
 #include "./headers/literal.h"
 #include "./headers/binexrp.h"
 #include "./headers/varexpr.h"
 #include "./headers/unaryexpr.h"
+#include "./headers/sharedexpr.h"
 
-void Interpreter::execute(const std::vector<std::unique_ptr<Statements>>& statements) {
-    for (const auto& stmt : statements) {
-        executeStatement(stmt.get());
+void Interpreter::setSource(std::string_view src, int firstLine) {
+    source = src;
+    lines.reset();
+    lines.setFirstLine(firstLine);
+}
+
+
+void Interpreter::execute(const Ast& tree, NodeList statements) {
+    ast = &tree;
+    pieces.clear();   // left over by a statement that failed
+    if (useJit) jit.compile(tree, statements);
+    executeBlock(statements);
+}
+
+
+void Interpreter::execute(const Ast& tree, NodeId statement) {
+    ast = &tree;
+    pieces.clear();
+    if (useJit) jit.compile(tree, statement);
+    executeStatement(tree.statement(statement));
+}
+
+
+void Interpreter::executeBlock(NodeList statements) {
+    for (NodeId stmt : ast->statements(statements)) {
+        executeStatement(ast->statement(stmt));
+    }
+}
+
+
+void Interpreter::executeScope(NodeList statements, Frame frame) {
+    if (frame.count > 0) {
+        std::size_t end = std::size_t{frame.first} + frame.count;
+        if (locals.size() < end) locals.resize(end);
+        for (std::size_t i = frame.first; i < end; i++) locals[i] = Value();
     }
+    executeBlock(statements);
 }
 
 
 void Interpreter::executeStatement(const Statements* stmt) {
-    if (auto* v = dynamic_cast<const VarDecl*>(stmt)) handleVarDecl(v);
-    else if (auto* a = dynamic_cast<const Assignment*>(stmt)) handleAssignment(a);
-    else if (auto* o = dynamic_cast<const OutStatement*>(stmt)) handleOut(o);
-    else if (auto* i = dynamic_cast<const InStatement*>(stmt)) handleIn(i);
-    else if (auto* f = dynamic_cast<const IfStatement*>(stmt)) handleIf(f);
-    else runtimeError(stmt, "Unknown statement during execution");
+    ++epoch;  // values cached for the previous statement are stale now
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: handleVarDecl(static_cast<const VarDecl*>(stmt)); break;
+        case NodeKind::ASSIGNMENT: handleAssignment(static_cast<const Assignment*>(stmt)); break;
+        case NodeKind::OUT: handleOut(static_cast<const OutStatement*>(stmt)); break;
+        case NodeKind::IN: handleIn(static_cast<const InStatement*>(stmt)); break;
+        case NodeKind::IF: handleIf(static_cast<const IfStatement*>(stmt)); break;
+        default: runtimeError(stmt, "Unknown statement during execution");
+    }
 }
 
 
-std::any Interpreter::evaluateExpression(const Expressions* expr) {
-    if (auto* l = dynamic_cast<const Literal*>(expr)) return evaluateLiteral(l);
-    if (auto* v = dynamic_cast<const VarExpr*>(expr)) return evaluateVarExpr(v);
-    if (auto* b = dynamic_cast<const BinExpr*>(expr)) return evaluateBinExpr(b);
-    if (auto* u = dynamic_cast<const UnaryExpr*>(expr)) return evaluateUnaryExpr(u);  // Add this line
-    
-    runtimeError(expr, "Unknown expression type.");
+Value Interpreter::evaluateExpression(const Expressions* expr) {
+    switch (expr->type) {
+        case ValueType::INT: return Value(evaluateInt(expr));
+        case ValueType::DOUBLE: return Value(evaluateDouble(expr));
+        case ValueType::BOOL: return Value(evaluateBool(expr));
+        case ValueType::STRING: return evaluateString(expr);
+        default: break;
+    }
+    // Only the `endl` literal has no runtime value
+    runtimeError(expr, std::string("Unknown literal type: ") + typeName(expr->type));
+}
+
+
+Value Interpreter::evaluateRoot(NodeId id) {
+    const Expressions* expr = ast->expression(id);
+    const Jit::Function* compiled = jit.find(id);
+    if (!compiled) return evaluateExpression(expr);
+    switch (expr->type) {
+        case ValueType::INT: { int value; runCompiled(*compiled, &value); return Value(value); }
+        case ValueType::DOUBLE: { double value; runCompiled(*compiled, &value); return Value(value); }
+        default: { bool value; runCompiled(*compiled, &value); return Value(value); }
+    }
+}
+
+
+bool Interpreter::evaluateCondition(NodeId id) {
+    if (const Jit::Function* compiled = jit.find(id)) {
+        bool value;
+        runCompiled(*compiled, &value);
+        return value;
+    }
+    return evaluateBool(ast->expression(id));
+}
+
+
+// The errors raised are those the interpreter raises at the same node
+void Interpreter::runCompiled(const Jit::Function& function, void* result) {
+    if (globals.size() < function.globals) globals.resize(function.globals);
+    std::uint32_t failed = function.code(globals.data(), locals.data(), result);
+    if (failed == 0) return;
+
+    const Jit::Failure& failure = jit.failure(function, failed);
+    switch (failure.kind) {
+        case Jit::Failure::Kind::UNDEFINED:
+            runtimeError(failure.at, "Undefined variable: " + symbolName(static_cast<const VarExpr*>(failure.at)->name));
+        case Jit::Failure::Kind::DIVISION: runtimeError(failure.at, "Division by zero");
+        case Jit::Failure::Kind::MODULO: runtimeError(failure.at, "Modulo by zero");
+    }
 }
 
 
 void Interpreter::handleVarDecl(const VarDecl* stmt) {
-    if (variables.find(stmt->name) != variables.end()) {
-        runtimeError(stmt, "Variable already declared: " + stmt->name);
+    if (!variable(stmt->depth, stmt->slot).empty()) {
+        runtimeError(stmt, "Variable already declared: " + symbolName(stmt->name));
     }
-    std::any value = evaluateExpression(stmt->value.get());
-    variables[stmt->name] = value;
+    Value value = evaluateRoot(stmt->value);
+    variable(stmt->depth, stmt->slot) = std::move(value);
 }
 
 
 void Interpreter::handleAssignment(const Assignment* stmt) {
-    if (variables.find(stmt->name) == variables.end()) {
-        runtimeError(stmt, "Assignment to undeclared variable: " + stmt->name);
+    if (variable(stmt->depth, stmt->slot).empty()) {
+        runtimeError(stmt, "Assignment to undeclared variable: " + symbolName(stmt->name));
     }
-    variables[stmt->name] = evaluateExpression(stmt->value.get());
+    Value value = evaluateRoot(stmt->value);
+    variable(stmt->depth, stmt->slot) = std::move(value);
 }
 
 
 void Interpreter::handleOut(const OutStatement* stmt) {
-    for (const auto& expr : stmt->outputs) {
-        std::any result = evaluateExpression(expr.get());
-        if (result.type() == typeid(int)) std::cout << std::any_cast<int>(result);
-        else if (result.type() == typeid(double)) std::cout << std::any_cast<double>(result);
-        else if (result.type() == typeid(bool)) std::cout << (std::any_cast<bool>(result) ? "true" : "false");
-        else if (result.type() == typeid(std::string)) std::cout << std::any_cast<std::string>(result);
-        else std::cout << "[unknown]";
+    Output& out = Output::standard();
+    for (NodeId id : ast->expressions(stmt->outputs)) {
+        const Expressions* expr = ast->expression(id);
+        if (jit.find(id)) {
+            Value value = evaluateRoot(id);
+            switch (expr->type) {
+                case ValueType::INT: out.write(value.asInt()); break;
+                case ValueType::DOUBLE: out.write(value.asDouble()); break;
+                default: out.write(value.asBool()); break;
+            }
+            continue;
+        }
+        switch (expr->type) {
+            case ValueType::INT: out.write(evaluateInt(expr)); break;
+            case ValueType::DOUBLE: out.write(evaluateDouble(expr)); break;
+            case ValueType::BOOL: out.write(evaluateBool(expr)); break;
+            case ValueType::STRING:
+                // Literal text, often joined by the optimizer, is written as
+                // is, and a concatenation piece by piece without building
+                // the string. The pieces are all evaluated first, so an
+                // error in one leaves nothing of the item written.
+                if (auto* literal = nodeCast<Literal>(expr)) {
+                    out.write(ast->text(literal->value));
+                } else if (isConcat(expr)) {
+                    std::size_t base = pieces.size();
+                    pushPieces(expr);
+                    for (std::size_t i = base; i < pieces.size(); i++) out.write(pieces[i].asString());
+                    pieces.resize(base);
+                } else {
+                    Value scratch;
+                    out.write(stringOperand(expr, scratch).asString());
+                }
+                break;
+            default: evaluateExpression(expr); break;   // endl, which raises an error
+        }
     }
-    std::cout << std::endl;
+    out.endLine();
 }
 
 
 void Interpreter::handleIn(const InStatement* stmt) {
-    // Check if we have predefined input (for file mode)
-    if (!inputQueue.empty()) {
-        variables[stmt->varName] = inputQueue.front();
-        inputQueue.pop();
-        return;
-    }
-    
-    // Interactive mode
-    std::string input;
-    if (!std::getline(std::cin, input)) {
-        runtimeError(stmt, "Failed to read input");
+    Input& input = Input::standard();
+    SourceLocation where;
+    if (input.tracksLocation()) where = lines.locate(source, stmt->offset);
+    Input::Value read;
+    switch (input.read(stmt->type, where, read)) {
+        case Input::Status::OK: break;
+        case Input::Status::END: runtimeError(stmt, "Failed to read input");
+        case Input::Status::MISMATCH: runtimeError(stmt, input.mismatch());
     }
-    
-    // Convert based on variable type if known
-    if (variables.count(stmt->varName)) {
-        auto& var = variables[stmt->varName];
-        if (var.type() == typeid(int)) {
-            var = std::stoi(input);
-        } else if (var.type() == typeid(double)) {
-            var = std::stod(input);
-        } else {
-            var = input;
-        }
+
+    // Converted to the variable's static type; the parser rejects bool
+    Value& var = variable(stmt->depth, stmt->slot);
+    if (stmt->type == ValueType::INT) {
+        var = Value(read.intValue);
+    } else if (stmt->type == ValueType::DOUBLE) {
+        var = Value(read.doubleValue);
     } else {
-        variables[stmt->varName] = input;
+        var = Value(read.text);
     }
 }
 
 
 void Interpreter::handleIf(const IfStatement* stmt) {
-    std::any cond = evaluateExpression(stmt->condition.get());
-    bool isTrue = false;
+    // Conditions are bool, checked by the parser
+    if (evaluateCondition(stmt->condition)) {
+        executeScope(stmt->ifBranch, stmt->ifFrame);
+        return;
+    }
+    for (const ElifBranch& elif : ast->elifs(stmt->elifBranches)) {
+        if (evaluateCondition(elif.condition)) {
+            executeScope(elif.body, elif.frame);
+            return;
+        }
+    }
+    executeScope(stmt->elseBranch, stmt->elseFrame);
+}
 
-    if (cond.type() == typeid(bool)) isTrue = std::any_cast<bool>(cond);
-    else runtimeError(stmt, "Condition must be a boolean");
 
-    if (isTrue) {
-        for (const auto& s : stmt->ifBranch) {
-            executeStatement(s.get());
-        }
-    } else {
-        bool executed = false;
-        for (const auto& [elifCond, elifBranch] : stmt->elifBranches) {
-            std::any elifResult = evaluateExpression(elifCond.get());
-            if (elifResult.type() != typeid(bool)) continue;
-            if (std::any_cast<bool>(elifResult)) {
-                for (const auto& s : elifBranch) executeStatement(s.get());
-                executed = true;
-                break;
-            }
-        }
-        if (!executed) {
-            for (const auto& s : stmt->elseBranch) {
-                executeStatement(s.get());
+const Value& Interpreter::evaluateVarExpr(const VarExpr* expr) {
+    const Value& value = variable(expr->depth, expr->slot);
+    if (value.empty()) {
+        runtimeError(expr, "Undefined variable: " + symbolName(expr->name));
+    }
+    return value;
+}
+
+
+// Every value stored in a variable or cache slot has the static type of the
+// expression reading it, so the unchecked accessors below read the right member
+
+int Interpreter::evaluateInt(const Expressions* expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return static_cast<const Literal*>(expr)->intValue;
+        case NodeKind::VAR: return evaluateVarExpr(static_cast<const VarExpr*>(expr)).asInt();
+        case NodeKind::SHARED: return evaluateSharedExpr(static_cast<const SharedExpr*>(expr)).asInt();
+        case NodeKind::UNARY: return -evaluateInt(ast->expression(static_cast<const UnaryExpr*>(expr)->getExpr()));
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<const BinExpr*>(expr);
+            int l = evaluateInt(ast->expression(binary->left));
+            int r = evaluateInt(ast->expression(binary->right));
+            switch (binary->operation) {
+                case Operation::ADD_INT: return l + r;
+                case Operation::SUB_INT: return l - r;
+                case Operation::MUL_INT: return l * r;
+                case Operation::DIV_INT:
+                    if (r == 0) runtimeError(expr, "Division by zero");
+                    return divideInt(l, r);
+                case Operation::MOD_INT:
+                    if (r == 0) runtimeError(expr, "Modulo by zero");
+                    return remainderInt(l, r);
+                default: break;
             }
+            break;
         }
+        default: break;
     }
+    runtimeError(expr, "Unknown expression type.");
 }
 
 
-std::any Interpreter::evaluateLiteral(const Literal* expr) {
-    if (expr->type == "int") return std::stoi(expr->value);
-    if (expr->type == "double") return std::stod(expr->value);
-    if (expr->type == "bool") return expr->value == "true";
-    if (expr->type == "string") return expr->value;
-    runtimeError(expr, "Unknown literal type: " + expr->type);
+double Interpreter::evaluateDouble(const Expressions* expr) {
+    // An int operand of a mixed operation
+    if (expr->type == ValueType::INT) return evaluateInt(expr);
+
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return static_cast<const Literal*>(expr)->doubleValue;
+        case NodeKind::VAR: return evaluateVarExpr(static_cast<const VarExpr*>(expr)).asDouble();
+        case NodeKind::SHARED: return evaluateSharedExpr(static_cast<const SharedExpr*>(expr)).asDouble();
+        case NodeKind::UNARY: return -evaluateDouble(ast->expression(static_cast<const UnaryExpr*>(expr)->getExpr()));
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<const BinExpr*>(expr);
+            double l = evaluateDouble(ast->expression(binary->left));
+            double r = evaluateDouble(ast->expression(binary->right));
+            switch (binary->operation) {
+                case Operation::ADD_DOUBLE: return l + r;
+                case Operation::SUB_DOUBLE: return l - r;
+                case Operation::MUL_DOUBLE: return l * r;
+                case Operation::DIV_DOUBLE:
+                    if (r == 0.0) runtimeError(expr, "Division by zero");
+                    return l / r;
+                default: break;
+            }
+            break;
+        }
+        default: break;
+    }
+    runtimeError(expr, "Unknown expression type.");
 }
 
 
-std::any Interpreter::evaluateVarExpr(const VarExpr* expr) {
-    auto it = variables.find(expr->name);
-    if (it == variables.end()) {
-        runtimeError(expr, "Undefined variable: " + expr->name);
+bool Interpreter::evaluateBool(const Expressions* expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return static_cast<const Literal*>(expr)->boolValue;
+        case NodeKind::VAR: return evaluateVarExpr(static_cast<const VarExpr*>(expr)).asBool();
+        case NodeKind::SHARED: return evaluateSharedExpr(static_cast<const SharedExpr*>(expr)).asBool();
+        case NodeKind::UNARY: return !evaluateBool(ast->expression(static_cast<const UnaryExpr*>(expr)->getExpr()));
+        case NodeKind::BINARY: break;
+        default: runtimeError(expr, "Unknown expression type.");
     }
-    return it->second;
-}
 
-std::any Interpreter::evaluateBinExpr(const BinExpr* expr) {
-    // First evaluate the left operand
-    auto left = evaluateExpression(expr->left.get());
-
-    // For binary operators, evaluate the right operand
-    auto right = evaluateExpression(expr->right.get());
-
-    // Helper function to get numeric value as double
-    auto get_as_double = [](const std::any& value) {
-        if (value.type() == typeid(int)) return static_cast<double>(std::any_cast<int>(value));
-        if (value.type() == typeid(double)) return std::any_cast<double>(value);
-        throw std::runtime_error("Numeric value expected");
-    };
-
-    // Integer operations
-    if (left.type() == typeid(int) && right.type() == typeid(int)) {
-        int l = std::any_cast<int>(left);
-        int r = std::any_cast<int>(right);
-
-        if (expr->op == "+") return l + r;
-        if (expr->op == "-") return l - r;
-        if (expr->op == "*") return l * r;
-        if (expr->op == "/") {
-            if (r == 0) runtimeError(expr, "Division by zero");
-            return l / r;  // Integer division
+    // Comparisons and logic. Both sides are evaluated, left first; there is
+    // no short circuit.
+    auto* binary = static_cast<const BinExpr*>(expr);
+    const Expressions* left = ast->expression(binary->left);
+    const Expressions* right = ast->expression(binary->right);
+#define PANCAKE_BOTH(evaluate, op) { auto l = evaluate(left); return l op evaluate(right); }
+    switch (binary->operation) {
+        case Operation::EQ_INT: PANCAKE_BOTH(evaluateInt, ==)
+        case Operation::NE_INT: PANCAKE_BOTH(evaluateInt, !=)
+        case Operation::LT_INT: PANCAKE_BOTH(evaluateInt, <)
+        case Operation::GT_INT: PANCAKE_BOTH(evaluateInt, >)
+        case Operation::LE_INT: PANCAKE_BOTH(evaluateInt, <=)
+        case Operation::GE_INT: PANCAKE_BOTH(evaluateInt, >=)
+        case Operation::EQ_DOUBLE: PANCAKE_BOTH(evaluateDouble, ==)
+        case Operation::NE_DOUBLE: PANCAKE_BOTH(evaluateDouble, !=)
+        case Operation::LT_DOUBLE: PANCAKE_BOTH(evaluateDouble, <)
+        case Operation::GT_DOUBLE: PANCAKE_BOTH(evaluateDouble, >)
+        case Operation::LE_DOUBLE: PANCAKE_BOTH(evaluateDouble, <=)
+        case Operation::GE_DOUBLE: PANCAKE_BOTH(evaluateDouble, >=)
+        case Operation::AND: PANCAKE_BOTH(evaluateBool, &)   // not &&, which would skip the right side
+        case Operation::OR: PANCAKE_BOTH(evaluateBool, |)
+        case Operation::EQ_BOOL: PANCAKE_BOTH(evaluateBool, ==)
+        case Operation::NE_BOOL: PANCAKE_BOTH(evaluateBool, !=)
+        case Operation::EQ_STRING: {
+            Value a, b;
+            const Value& l = stringOperand(left, a);
+            return l.sameString(stringOperand(right, b));
         }
-        if (expr->op == "mod") {
-            if (r == 0) runtimeError(expr, "Modulo by zero");
-            return l % r;
-        }
-        if (expr->op == "==") return l == r;
-        if (expr->op == "!=") return l != r;
-        if (expr->op == "<") return l < r;
-        if (expr->op == ">") return l > r;
-        if (expr->op == "<=") return l <= r;
-        if (expr->op == ">=") return l >= r;
-    }
-    // Double operations
-    else if (left.type() == typeid(double) && right.type() == typeid(double)) {
-        double l = std::any_cast<double>(left);
-        double r = std::any_cast<double>(right);
-
-        if (expr->op == "+") return l + r;
-        if (expr->op == "-") return l - r;
-        if (expr->op == "*") return l * r;
-        if (expr->op == "/") {
-            if (r == 0.0) runtimeError(expr, "Division by zero");
-            return l / r;
+        case Operation::NE_STRING: {
+            Value a, b;
+            const Value& l = stringOperand(left, a);
+            return !l.sameString(stringOperand(right, b));
         }
-        if (expr->op == "==") return l == r;
-        if (expr->op == "!=") return l != r;
-        if (expr->op == "<") return l < r;
-        if (expr->op == ">") return l > r;
-        if (expr->op == "<=") return l <= r;
-        if (expr->op == ">=") return l >= r;
+        default: break;
     }
-    // Mixed numeric types (int + double)
-    else if ((left.type() == typeid(int) || left.type() == typeid(double)) &&
-             (right.type() == typeid(int) || right.type() == typeid(double))) {
-        double l = get_as_double(left);
-        double r = get_as_double(right);
-
-        if (expr->op == "+") return l + r;
-        if (expr->op == "-") return l - r;
-        if (expr->op == "*") return l * r;
-        if (expr->op == "/") {
-            if (r == 0.0) runtimeError(expr, "Division by zero");
-            return l / r;
+#undef PANCAKE_BOTH
+    runtimeError(expr, "Unknown expression type.");
+}
+
+
+Value Interpreter::evaluateString(const Expressions* expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return ast->stringValue(static_cast<const Literal*>(expr)->constant);
+        case NodeKind::VAR: return evaluateVarExpr(static_cast<const VarExpr*>(expr));
+        case NodeKind::SHARED: return evaluateSharedExpr(static_cast<const SharedExpr*>(expr));
+        case NodeKind::BINARY: {
+            // Concatenation, the only string operator
+            std::size_t base = pieces.size();
+            pushPieces(expr);
+            Value joined = Value::join(pieces.data() + base, pieces.size() - base);
+            pieces.resize(base);
+            return joined;
         }
-        if (expr->op == "==") return l == r;
-        if (expr->op == "!=") return l != r;
-        if (expr->op == "<") return l < r;
-        if (expr->op == ">") return l > r;
-        if (expr->op == "<=") return l <= r;
-        if (expr->op == ">=") return l >= r;
-    }
-    // String concatenation
-    else if (expr->op == "+" && 
-             left.type() == typeid(std::string) && 
-             right.type() == typeid(std::string)) {
-        return std::any_cast<std::string>(left) + std::any_cast<std::string>(right);
+        default: break;
     }
-    // String equality
-    else if ((expr->op == "==" || expr->op == "!=") &&
-             left.type() == typeid(std::string) && 
-             right.type() == typeid(std::string)) {
-        bool equal = std::any_cast<std::string>(left) == std::any_cast<std::string>(right);
-        return expr->op == "==" ? equal : !equal;
-    }
-    // Boolean operations
-    else if (left.type() == typeid(bool) && right.type() == typeid(bool)) {
-        bool l = std::any_cast<bool>(left);
-        bool r = std::any_cast<bool>(right);
-
-        if (expr->op == "and" ) return l && r;
-        if (expr->op == "or" ) return l || r;
-        if (expr->op == "==") return l == r;
-        if (expr->op == "!=") return l != r;
-    }
-
-    runtimeError(expr, "Unsupported operation '" + expr->op + "' for types " + 
-        left.type().name() + " and " + right.type().name());
+    runtimeError(expr, "Unknown expression type.");
 }
 
-std::any Interpreter::evaluateUnaryExpr(const class UnaryExpr* expr) {
-    auto operand = evaluateExpression(expr->getExpr());
-    const std::string& op = expr->getOp();
 
-    if (op == "!") {
-        // Handle logical NOT
-        if (operand.type() == typeid(bool)) {
-            return !std::any_cast<bool>(operand);
-        }
-        runtimeError(expr, "NOT operator '!' requires a boolean operand");
+void Interpreter::pushPieces(const Expressions* expr) {
+    if (isConcat(expr)) {
+        auto* binary = static_cast<const BinExpr*>(expr);
+        pushPieces(ast->expression(binary->left));
+        pushPieces(ast->expression(binary->right));
+        return;
     }
-    else if (op == "-") {
-        // Handle unary minus
-        if (operand.type() == typeid(int)) {
-            return -std::any_cast<int>(operand);
-        }
-        if (operand.type() == typeid(double)) {
-            return -std::any_cast<double>(operand);
-        }
-        runtimeError(expr, "Unary minus '-' requires a numeric operand");
+    Value piece = evaluateString(expr);   // may push and pop pieces of its own
+    pieces.push_back(std::move(piece));
+}
+
+
+// Shared values are copied: evaluating the other operand may add a slot and
+// move them
+const Value& Interpreter::stringOperand(const Expressions* expr, Value& scratch) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return ast->stringValue(static_cast<const Literal*>(expr)->constant);
+        case NodeKind::VAR: return evaluateVarExpr(static_cast<const VarExpr*>(expr));
+        default: return scratch = evaluateString(expr);
     }
+}
 
-    runtimeError(expr, "Unknown unary operator: " + op);
+
+const Value& Interpreter::evaluateSharedExpr(const SharedExpr* expr) {
+    if (expr->slot >= shared.size()) shared.resize(expr->slot + 1);
+    SharedValue& cached = shared[expr->slot];
+    if (cached.epoch != epoch) {
+        cached.value = evaluateExpression(ast->expression(expr->expr));
+        cached.epoch = epoch;
+    }
+    return cached.value;
 }
 
 
 [[noreturn]] void Interpreter::runtimeError(const Statements* stmt, const std::string& msg) {
-    throw std::runtime_error("Runtime Error at line " + std::to_string(stmt->line) + 
-                             ", column " + std::to_string(stmt->column) + ": " + msg);
+    SourceLocation loc = lines.locate(source, stmt->offset);
+    throw std::runtime_error("Runtime Error at line " + std::to_string(loc.line) + 
+                             ", column " + std::to_string(loc.column) + ": " + msg);
 }
 
 [[noreturn]] void Interpreter::runtimeError(const Expressions* expr, const std::string& msg) {
-    throw std::runtime_error("Runtime Error at line " + std::to_string(expr->line) + 
-                             ", column " + std::to_string(expr->column) + ": " + msg);
+    SourceLocation loc = lines.locate(source, expr->offset);
+    throw std::runtime_error("Runtime Error at line " + std::to_string(loc.line) + 
+                             ", column " + std::to_string(loc.column) + ": " + msg);
 }
@@ -0,0 +1,625 @@
+#include "./headers/jit.h"
+#include "./headers/astvisitor.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define PANCAKE_JIT 1
+#endif
+
+// Registers holding intermediate values, in the order they are taken. The
+// generated code calls nothing, so the caller-saved ones are free but for
+// rdi and rsi (the variables), r11 (the result), and rax and rdx, which
+// idiv needs; the callee-saved ones after them are saved when used.
+static const unsigned INT_REGISTERS[] = {1, 8, 9, 10, 3, 12, 13, 14, 15};   // rcx, r8-r10, rbx, r12-r15
+static const unsigned CALLER_SAVED = 4;
+static const unsigned INT_COUNT = sizeof INT_REGISTERS / sizeof INT_REGISTERS[0];
+static const unsigned DOUBLE_FIRST = 2;   // xmm2-xmm15; xmm0 and xmm1 are scratch
+static const unsigned DOUBLE_COUNT = 14;
+
+static const unsigned RAX = 0, RDX = 2, RSI = 6, RDI = 7, R11 = 11;
+
+// Condition codes, as the low nibble of jcc (0x80) and setcc (0x90)
+static const unsigned char CC_E = 0x4, CC_NE = 0x5, CC_AE = 0x3, CC_A = 0x7;
+static const unsigned char CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF;
+
+static const std::size_t PAGE = 4096;
+
+
+Jit::~Jit() {
+#ifdef PANCAKE_JIT
+    if (memory) munmap(memory, capacity);
+#endif
+}
+
+
+bool Jit::supported() {
+#ifdef PANCAKE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void Jit::compile(const Ast& tree, NodeList program) {
+    begin(tree);
+    if (supported()) collectBlock(program);
+    finish();
+}
+
+
+void Jit::compile(const Ast& tree, NodeId statement) {
+    begin(tree);
+    if (supported()) collectStatement(tree.statement(statement));
+    finish();
+}
+
+
+void Jit::begin(const Ast& tree) {
+    // Only the entries of the last program are set, so a program of one
+    // statement in a large tree, as the REPL runs, clears no more than that
+    for (NodeId id : roots) functions[id] = Function();
+    if (functions.size() < tree.expressionCount()) functions.resize(tree.expressionCount());
+    roots.clear();
+    starts.clear();
+    code.clear();
+    failures.clear();
+    ast = &tree;
+}
+
+
+void Jit::finish() {
+    ast = nullptr;
+    if (code.empty()) return;
+
+#ifdef PANCAKE_JIT
+    // Nothing compiled earlier runs any more, so the memory can be rewritten
+    bool mapped = memory != nullptr && capacity >= code.size();
+    if (!mapped) {
+        if (memory) munmap(memory, capacity);
+        capacity = std::max<std::size_t>(16 * PAGE, (code.size() + PAGE - 1) / PAGE * PAGE);
+        void* region = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        memory = region == MAP_FAILED ? nullptr : static_cast<unsigned char*>(region);
+    } else if (mprotect(memory, capacity, PROT_READ | PROT_WRITE) != 0) {
+        munmap(memory, capacity);
+        memory = nullptr;
+    }
+    if (memory) {
+        std::memcpy(memory, code.data(), code.size());
+        if (mprotect(memory, capacity, PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, capacity);
+            memory = nullptr;
+        }
+    }
+    if (!memory) {
+        // Left to the interpreter
+        capacity = 0;
+        for (NodeId id : roots) functions[id] = Function();
+        return;
+    }
+    for (std::size_t i = 0; i < roots.size(); i++) {
+        functions[roots[i]].code = reinterpret_cast<Code>(memory + starts[i]);
+    }
+#endif
+}
+
+
+void Jit::collectBlock(NodeList statements) {
+    for (NodeId id : ast->statements(statements)) collectStatement(ast->statement(id));
+}
+
+
+// The expressions the interpreter evaluates from a statement, which are the
+// roots of the trees compiled
+void Jit::collectStatement(const Statements* stmt) {
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: collectRoot(static_cast<const VarDecl*>(stmt)->value); break;
+        case NodeKind::ASSIGNMENT: collectRoot(static_cast<const Assignment*>(stmt)->value); break;
+        case NodeKind::OUT:
+            for (NodeId id : ast->expressions(static_cast<const OutStatement*>(stmt)->outputs)) collectRoot(id);
+            break;
+        case NodeKind::IF: {
+            auto* ifStmt = static_cast<const IfStatement*>(stmt);
+            collectRoot(ifStmt->condition);
+            collectBlock(ifStmt->ifBranch);
+            for (const ElifBranch& elif : ast->elifs(ifStmt->elifBranches)) {
+                collectRoot(elif.condition);
+                collectBlock(elif.body);
+            }
+            collectBlock(ifStmt->elseBranch);
+            break;
+        }
+        default: break;
+    }
+}
+
+
+void Jit::collectRoot(NodeId id) {
+    const Expressions* expr = ast->expression(id);
+    if (expr->type != ValueType::INT && expr->type != ValueType::DOUBLE && expr->type != ValueType::BOOL) return;
+    std::uint32_t operators = 0;
+    if (supports(expr, operators) && operators >= MIN_OPERATORS) generate(id);
+}
+
+
+bool Jit::supports(const Expressions* expr, std::uint32_t& operators) const {
+    if (expr->type == ValueType::STRING || expr->type == ValueType::ENDL) return false;
+    switch (expr->kind) {
+        case NodeKind::LITERAL: return true;
+        case NodeKind::VAR:   // its payload addressed with a 32-bit displacement
+            return static_cast<const VarExpr*>(expr)->slot < 0x7FFFFFFFu / sizeof(Value);
+        case NodeKind::UNARY:
+            operators++;
+            return supports(ast->expression(static_cast<const UnaryExpr*>(expr)->getExpr()), operators);
+        case NodeKind::BINARY: {
+            auto* binary = static_cast<const BinExpr*>(expr);
+            switch (binary->operation) {
+                case Operation::CONCAT:
+                case Operation::EQ_STRING:
+                case Operation::NE_STRING:
+                    return false;
+                default: break;
+            }
+            operators++;
+            return supports(ast->expression(binary->left), operators) &&
+                   supports(ast->expression(binary->right), operators);
+        }
+        default: return false;   // shared subexpressions, cached by the interpreter
+    }
+}
+
+
+// A function is laid out as
+//
+//     push     callee-saved registers used
+//     mov      r11, rdx
+//     ...      the tree, its value left in the first register
+//     mov      [r11], value
+//     xor      eax, eax
+//   exit:
+//     pop      the registers pushed
+//     ret
+//     mov      eax, k      for each failure k, jumped to by its check
+//     jmp      exit
+//
+// The body is generated first, the registers it takes deciding what the
+// prologue saves.
+void Jit::generate(NodeId id) {
+    const Expressions* expr = ast->expression(id);
+    std::size_t failuresBefore = failures.size();
+    length = 0;
+    jumps.clear();
+    functionFailures = 0;
+    intTop = doubleTop = intsUsed = 0;
+    globalsRead = 0;
+    checked.clear();
+    tooDeep = false;
+
+    emit({0x49, 0x89, 0xD3});   // mov r11, rdx
+    if (expr->type == ValueType::DOUBLE) {
+        unsigned value = generateDouble(expr);
+        sseOp(0xF2, 0x11, value, R11, 0);   // movsd [r11], xmm
+    } else if (expr->type == ValueType::INT) {
+        unsigned value = generateInt(expr);
+        intOp(0x89, value, R11, 0);   // mov [r11], r32
+    } else {
+        unsigned value = generateBool(expr);
+        rex(false, value, R11, true);
+        emit({0x88});   // mov [r11], r8
+        modrm(value, R11, 0);
+    }
+    if (tooDeep) {
+        failures.resize(failuresBefore);
+        return;
+    }
+    emit({0x31, 0xC0});   // xor eax, eax
+
+    std::size_t exit = length;
+    for (unsigned i = intsUsed; i-- > CALLER_SAVED;) {
+        unsigned reg = INT_REGISTERS[i];
+        if (reg >= 8) emit({0x41});
+        emit({static_cast<unsigned char>(0x58 + (reg & 7))});   // pop
+    }
+    emit({0xC3});   // ret
+
+    std::vector<std::size_t> stubs(functionFailures + 1);
+    for (std::uint32_t k = 1; k <= functionFailures; k++) {
+        stubs[k] = length;
+        emit({0xB8});   // mov eax, k
+        emit32(k);
+        emit({0xE9});   // jmp exit
+        emit32(static_cast<std::uint32_t>(exit - (length + 4)));
+    }
+    for (const Jump& jump : jumps) {
+        auto rel = static_cast<std::uint32_t>(stubs[jump.failure] - (jump.at + 4));
+        std::memcpy(body.data() + jump.at, &rel, 4);
+    }
+
+    roots.push_back(id);
+    starts.push_back(code.size());
+    for (unsigned i = CALLER_SAVED; i < intsUsed; i++) {
+        unsigned reg = INT_REGISTERS[i];
+        if (reg >= 8) code.push_back(0x41);
+        code.push_back(static_cast<unsigned char>(0x50 + (reg & 7)));   // push
+    }
+    code.insert(code.end(), body.begin(), body.begin() + length);
+
+    Function& function = functions[id];
+    function.globals = globalsRead;
+    function.firstFailure = static_cast<std::uint32_t>(failuresBefore);
+}
+
+
+// Each kind of value is generated as the interpreter evaluates it; see
+// Interpreter::evaluateInt() and the others
+
+unsigned Jit::generateInt(const Expressions* expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            unsigned reg = pushInt();
+            rex(false, 0, reg);
+            emit({static_cast<unsigned char>(0xB8 + (reg & 7))});   // mov r32, imm32
+            emit32(static_cast<std::uint32_t>(static_cast<const Literal*>(expr)->intValue));
+            return reg;
+        }
+        case NodeKind::VAR: {
+            unsigned base;
+            std::int32_t payload;
+            checkVariable(static_cast<const VarExpr*>(expr), base, payload);
+            unsigned reg = pushInt();
+            intOp(0x8B, reg, base, payload);   // mov r32, [base + payload]
+            return reg;
+        }
+        case NodeKind::UNARY: {
+            unsigned reg = generateInt(ast->expression(static_cast<const UnaryExpr*>(expr)->getExpr()));
+            rex(false, 0, reg);
+            emit({0xF7});   // neg r32
+            modrm(3, reg);
+            return reg;
+        }
+        default: break;
+    }
+
+    auto* binary = static_cast<const BinExpr*>(expr);
+    unsigned left = generateInt(ast->expression(binary->left));
+    unsigned right = generateInt(ast->expression(binary->right));
+    switch (binary->operation) {
+        case Operation::ADD_INT: intOp(0x03, left, right); break;
+        case Operation::SUB_INT: intOp(0x2B, left, right); break;
+        case Operation::MUL_INT:
+            rex(false, left, right);
+            emit({0x0F, 0xAF});   // imul r32, r32
+            modrm(left, right);
+            break;
+        default: {
+            // See divideInt(): idiv traps on INT_MIN / -1, so a divisor of
+            // -1 negates (or zeroes, for a remainder) instead
+            bool modulo = binary->operation == Operation::MOD_INT;
+            intOp(0x85, right, right);   // test
+            failIf(CC_E, modulo ? Failure::Kind::MODULO : Failure::Kind::DIVISION, expr);
+            rex(false, 0, right);
+            emit({0x83});   // cmp r32, -1
+            modrm(7, right);
+            emit({0xFF, 0x75, 0});   // jne divide
+            std::size_t divide = length;
+            if (modulo) {
+                intOp(0x33, left, left);   // xor
+            } else {
+                rex(false, 0, left);
+                emit({0xF7});   // neg r32
+                modrm(3, left);
+            }
+            emit({0xEB, 0});   // jmp done
+            std::size_t done = length;
+            body[divide - 1] = static_cast<unsigned char>(length - divide);
+            intOp(0x8B, RAX, left);
+            emit({0x99});   // cdq
+            rex(false, 0, right);
+            emit({0xF7});   // idiv r32
+            modrm(7, right);
+            intOp(0x8B, left, modulo ? RDX : RAX);
+            body[done - 1] = static_cast<unsigned char>(length - done);
+            break;
+        }
+    }
+    intTop--;
+    return left;
+}
+
+
+unsigned Jit::generateDouble(const Expressions* expr) {
+    // An int operand of a mixed operation
+    if (expr->type == ValueType::INT) {
+        unsigned from = generateInt(expr);
+        unsigned reg = pushDouble();
+        sseOp(0xF2, 0x2A, reg, from);   // cvtsi2sd xmm, r32
+        intTop--;
+        return reg;
+    }
+
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            std::uint64_t bits;
+            double value = static_cast<const Literal*>(expr)->doubleValue;
+            std::memcpy(&bits, &value, sizeof bits);
+            unsigned reg = pushDouble();
+            emit({0x48, 0xB8});   // mov rax, imm64
+            emit32(static_cast<std::uint32_t>(bits));
+            emit32(static_cast<std::uint32_t>(bits >> 32));
+            emit({0x66});
+            rex(true, reg, RAX);
+            emit({0x0F, 0x6E});   // movq xmm, rax
+            modrm(reg, RAX);
+            return reg;
+        }
+        case NodeKind::VAR: {
+            unsigned base;
+            std::int32_t payload;
+            checkVariable(static_cast<const VarExpr*>(expr), base, payload);
+            unsigned reg = pushDouble();
+            sseOp(0xF2, 0x10, reg, base, payload);   // movsd xmm, [base + payload]
+            return reg;
+        }
+        case NodeKind::UNARY: {
+            // The sign bit flipped, as C++ negates a double
+            unsigned reg = generateDouble(ast->expression(static_cast<const UnaryExpr*>(expr)->getExpr()));
+            emit({0x66});
+            rex(true, reg, RAX);
+            emit({0x0F, 0x7E});   // movq rax, xmm
+            modrm(reg, RAX);
+            emit({0x48, 0x0F, 0xBA, 0xF8, 63});   // btc rax, 63
+            emit({0x66});
+            rex(true, reg, RAX);
+            emit({0x0F, 0x6E});   // movq xmm, rax
+            modrm(reg, RAX);
+            return reg;
+        }
+        default: break;
+    }
+
+    auto* binary = static_cast<const BinExpr*>(expr);
+    unsigned left = generateDouble(ast->expression(binary->left));
+    unsigned right = generateDouble(ast->expression(binary->right));
+    switch (binary->operation) {
+        case Operation::ADD_DOUBLE: sseOp(0xF2, 0x58, left, right); break;
+        case Operation::SUB_DOUBLE: sseOp(0xF2, 0x5C, left, right); break;
+        case Operation::MUL_DOUBLE: sseOp(0xF2, 0x59, left, right); break;
+        default:
+            // Fails on +0 and -0 but not NaN, which compares unordered
+            emit({0x66, 0x0F, 0x57, 0xC0});   // xorpd xmm0, xmm0
+            sseOp(0x66, 0x2E, right, 0);      // ucomisd xmm, xmm0
+            emit({0x7A, 0x06});               // jp past the check
+            failIf(CC_E, Failure::Kind::DIVISION, expr);
+            sseOp(0xF2, 0x5E, left, right);   // divsd
+            break;
+    }
+    doubleTop--;
+    return left;
+}
+
+
+unsigned Jit::generateBool(const Expressions* expr) {
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            unsigned reg = pushInt();
+            rex(false, 0, reg);
+            emit({static_cast<unsigned char>(0xB8 + (reg & 7))});   // mov r32, imm32
+            emit32(static_cast<const Literal*>(expr)->boolValue ? 1 : 0);
+            return reg;
+        }
+        case NodeKind::VAR: {
+            unsigned base;
+            std::int32_t payload;
+            checkVariable(static_cast<const VarExpr*>(expr), base, payload);
+            unsigned reg = pushInt();
+            rex(false, reg, base);
+            emit({0x0F, 0xB6});   // movzx r32, byte [base + payload]
+            modrm(reg, base, payload);
+            return reg;
+        }
+        case NodeKind::UNARY: {
+            unsigned reg = generateBool(ast->expression(static_cast<const UnaryExpr*>(expr)->getExpr()));
+            rex(false, 0, reg);
+            emit({0x83});   // xor r32, 1
+            modrm(6, reg);
+            emit({0x01});
+            return reg;
+        }
+        default: break;
+    }
+
+    auto* binary = static_cast<const BinExpr*>(expr);
+    const Expressions* left = ast->expression(binary->left);
+    const Expressions* right = ast->expression(binary->right);
+    unsigned char condition = CC_E;
+    switch (binary->operation) {
+        case Operation::EQ_INT: condition = CC_E; break;
+        case Operation::NE_INT: condition = CC_NE; break;
+        case Operation::LT_INT: condition = CC_L; break;
+        case Operation::GT_INT: condition = CC_G; break;
+        case Operation::LE_INT: condition = CC_LE; break;
+        case Operation::GE_INT: condition = CC_GE; break;
+
+        case Operation::EQ_DOUBLE:
+        case Operation::NE_DOUBLE:
+        case Operation::LT_DOUBLE:
+        case Operation::GT_DOUBLE:
+        case Operation::LE_DOUBLE:
+        case Operation::GE_DOUBLE: {
+            // ucomisd leaves ZF, PF and CF all set for NaN, so only `above`
+            // conditions are false then; `<` is `>` with the operands swapped.
+            // == also needs PF clear, and != is true if it is set.
+            unsigned l = generateDouble(left);
+            unsigned r = generateDouble(right);
+            Operation operation = binary->operation;
+            bool swapped = operation == Operation::LT_DOUBLE || operation == Operation::LE_DOUBLE;
+            sseOp(0x66, 0x2E, swapped ? r : l, swapped ? l : r);   // ucomisd
+            if (operation == Operation::EQ_DOUBLE) {
+                emit({0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC2, 0x20, 0xD0});   // sete al; setnp dl; and al, dl
+            } else if (operation == Operation::NE_DOUBLE) {
+                emit({0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC2, 0x08, 0xD0});   // setne al; setp dl; or al, dl
+            } else {
+                bool strict = operation == Operation::LT_DOUBLE || operation == Operation::GT_DOUBLE;
+                emit({0x0F, static_cast<unsigned char>(0x90 | (strict ? CC_A : CC_AE)), 0xC0});   // seta/setae al
+            }
+            doubleTop -= 2;
+            unsigned reg = pushInt();
+            rex(false, reg, RAX);
+            emit({0x0F, 0xB6});   // movzx r32, al
+            modrm(reg, RAX);
+            return reg;
+        }
+
+        default: {
+            // Both sides evaluated; there is no short circuit
+            unsigned l = generateBool(left);
+            unsigned r = generateBool(right);
+            switch (binary->operation) {
+                case Operation::AND: intOp(0x23, l, r); break;
+                case Operation::OR: intOp(0x0B, l, r); break;
+                case Operation::NE_BOOL: intOp(0x33, l, r); break;
+                default:   // EQ_BOOL
+                    intOp(0x33, l, r);
+                    rex(false, 0, l);
+                    emit({0x83});   // xor r32, 1
+                    modrm(6, l);
+                    emit({0x01});
+                    break;
+            }
+            intTop--;
+            return l;
+        }
+    }
+
+    unsigned l = generateInt(left);
+    unsigned r = generateInt(right);
+    intOp(0x3B, l, r);   // cmp
+    setFlag(condition, l);
+    intTop--;
+    return l;
+}
+
+
+unsigned Jit::pushInt() {
+    unsigned index = intTop++;
+    if (index >= INT_COUNT) {
+        tooDeep = true;   // generated on into the last register, then dropped
+        index = INT_COUNT - 1;
+    }
+    intsUsed = std::max(intsUsed, index + 1);
+    return INT_REGISTERS[index];
+}
+
+
+unsigned Jit::pushDouble() {
+    unsigned index = doubleTop++;
+    if (index >= DOUBLE_COUNT) {
+        tooDeep = true;
+        index = DOUBLE_COUNT - 1;
+    }
+    return DOUBLE_FIRST + index;
+}
+
+
+void Jit::byte(unsigned char value) {
+    if (length == body.size()) body.resize(body.empty() ? 1024 : 2 * body.size());
+    body[length++] = value;
+}
+
+
+void Jit::emit(std::initializer_list<unsigned char> bytes) {
+    for (unsigned char value : bytes) byte(value);
+}
+
+
+void Jit::emit32(std::uint32_t value) {
+    for (int i = 0; i < 4; i++) byte(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+
+void Jit::rex(bool wide, unsigned reg, unsigned rm, bool always) {
+    unsigned char prefix = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+    if (prefix != 0x40 || always) byte(prefix);
+}
+
+
+void Jit::modrm(unsigned reg, unsigned rm) {
+    byte(static_cast<unsigned char>(0xC0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+
+void Jit::modrm(unsigned reg, unsigned base, std::int32_t disp) {
+    byte(static_cast<unsigned char>(0x80 | (reg & 7) << 3 | (base & 7)));
+    if ((base & 7) == 4) byte(0x24);   // rsp and r12 need a SIB byte
+    emit32(static_cast<std::uint32_t>(disp));
+}
+
+
+void Jit::intOp(unsigned char opcode, unsigned reg, unsigned rm) {
+    rex(false, reg, rm);
+    byte(opcode);
+    modrm(reg, rm);
+}
+
+
+void Jit::intOp(unsigned char opcode, unsigned reg, unsigned base, std::int32_t disp) {
+    rex(false, reg, base);
+    byte(opcode);
+    modrm(reg, base, disp);
+}
+
+
+void Jit::sseOp(unsigned char prefix, unsigned char opcode, unsigned reg, unsigned rm) {
+    byte(prefix);
+    rex(false, reg, rm);
+    emit({0x0F, opcode});
+    modrm(reg, rm);
+}
+
+
+void Jit::sseOp(unsigned char prefix, unsigned char opcode, unsigned reg, unsigned base, std::int32_t disp) {
+    byte(prefix);
+    rex(false, reg, base);
+    emit({0x0F, opcode});
+    modrm(reg, base, disp);
+}
+
+
+void Jit::checkVariable(const VarExpr* var, unsigned& base, std::int32_t& payload) {
+    static_assert(offsetof(Value, tag) == 0, "generated code reads the tag at the start of a value");
+    static_assert(sizeof(ValueType) == 1, "and compares it as a byte");
+
+    // See Interpreter::variable(): block locals are in the frame, globals
+    // by symbol, grown to cover the slots read before the code runs
+    base = var->depth > 0 ? RSI : RDI;
+    if (var->depth == 0) globalsRead = std::max(globalsRead, var->slot + 1);
+    auto at = static_cast<std::int32_t>(var->slot * sizeof(Value));
+    payload = at + static_cast<std::int32_t>(offsetof(Value, bits));
+
+    // A variable read again by the tree is set, or the first read failed
+    if (!checked.insert(std::uint64_t{var->depth > 0} << 32 | var->slot).second) return;
+    rex(false, 0, base);
+    byte(0x80);   // cmp byte [base + at], ENDL
+    modrm(7, base, at);
+    byte(static_cast<unsigned char>(ValueType::ENDL));
+    failIf(CC_E, Failure::Kind::UNDEFINED, var);
+}
+
+
+void Jit::failIf(unsigned char condition, Failure::Kind kind, const Expressions* at) {
+    failures.push_back(Failure{kind, at});
+    emit({0x0F, static_cast<unsigned char>(0x80 | condition)});   // jcc rel32
+    jumps.push_back(Jump{length, ++functionFailures});
+    emit32(0);
+}
+
+
+void Jit::setFlag(unsigned char condition, unsigned reg) {
+    emit({0x0F, static_cast<unsigned char>(0x90 | condition), 0xC0});   // setcc al
+    rex(false, reg, RAX);
+    emit({0x0F, 0xB6});   // movzx r32, al
+    modrm(reg, RAX);
+}
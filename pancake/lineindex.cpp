@@ -0,0 +1,37 @@
+#include "./headers/lineindex.h"
+#include "./headers/scanner.h"
+#include <algorithm>
+
+void LineIndex::reset() {
+    lineStarts.clear();
+    built = false;
+    lastLine = 1;
+}
+
+void LineIndex::build(std::string_view source) {
+    lineStarts.clear();
+    lineStarts.push_back(0);
+    scan::findLineStarts(source, lineStarts);
+    built = true;
+}
+
+SourceLocation LineIndex::locate(std::string_view source, std::uint32_t offset) {
+    if (!built) build(source);
+
+    // Last line start that is <= offset. Statements run in source order, so
+    // the line found last time, or the next one, usually is it.
+    std::size_t lineNo = lastLine;
+    auto holds = [&](std::size_t n) {   // whether line n holds the offset
+        return n <= lineStarts.size() && lineStarts[n - 1] <= offset && (n == lineStarts.size() || offset < lineStarts[n]);
+    };
+    if (!holds(lineNo) && !holds(++lineNo)) {
+        auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+        lineNo = static_cast<std::size_t>(it - lineStarts.begin());
+    }
+    lastLine = lineNo;
+
+    SourceLocation loc;
+    loc.line = static_cast<int>(lineNo) + firstLine - 1;
+    loc.column = static_cast<int>(offset - lineStarts[lineNo - 1]) + 1;
+    return loc;
+}
@@ -1,31 +1,193 @@
 #include "./headers/tokeniser.h"
 #include "./headers/parser.h"
 #include "./headers/interpreter.h"
+#include "./headers/document.h"
+#include "./headers/sourcestream.h"
+#include "./headers/optimizer.h"
+#include "./headers/programcache.h"
+#include "./headers/vm.h"
+#include "./headers/input.h"
+#include "./headers/output.h"
+#include "./headers/cppemitter.h"
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
+#include <thread>
+
+// Command line options for running a script
+struct RunOptions {
+    unsigned jobs = 0;   // tokeniser threads, 0 = one per core
+    bool watch = false;  // re-run the script whenever the file changes
+    bool stream = false; // run each statement as soon as it has been read
+    int optimize = Optimizer::DEFAULT_LEVEL;  // -O level
+    bool cache = true;   // reuse the compiled program of an unchanged script
+    bool vm = false;     // run compiled bytecode instead of walking the tree
+    bool jit = false;    // walk the tree, but run larger numeric expressions as machine code
+    bool flush = false;  // flush output after every line, not only on a terminal
+    std::string outFile; // program output goes here instead of stdout
+    std::size_t outQueue = 0;  // bytes queued for the output writer thread, 0 = no thread
+    std::string inFile;  // `in` statements read from here instead of stdin
+    std::string recordInput;  // log of the values `in` statements read
+    std::string replayInput;  // such a log, read instead of any input
+    std::string emitCpp;      // write the program as C++ to this file instead of running it
+    std::string compileTo;    // build it into this executable instead of running it
+};
 
 // Function prototypes
-void runConsole();
-void runFile(const std::string& filename);
+void runConsole(const RunOptions& options);
+void runFile(const std::string& filename, const RunOptions& options);
+void watchFile(const std::string& filename, const RunOptions& options);
+void streamFile(const std::string& filename, const RunOptions& options);
+int compileFile(const std::string& filename, const RunOptions& options);
+
+static int usage(const char* program) {
+    std::cerr << "Usage:\n";
+    std::cerr << "  " << program << "                   # interactive mode\n";
+    std::cerr << "  " << program << " [options] file.pnc # run script\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  -j, --jobs N   threads used to tokenise large files (1 = sequential)\n";
+    std::cerr << "  -w, --watch    re-run the script each time the file is saved\n";
+    std::cerr << "  -s, --stream   read, parse and run the script one statement at a time;\n";
+    std::cerr << "                 statements before an error have already run\n";
+    std::cerr << "  -O0, -O1, -O2  optimisation level (default -O" << Optimizer::DEFAULT_LEVEL << "); -O2 adds\n";
+    std::cerr << "                 whole-program passes, not used by the REPL or --stream\n";
+    std::cerr << "  --no-cache     always compile the script; by default the compiled program\n";
+    std::cerr << "                 is kept in $PANCAKE_CACHE_DIR (else ~/.cache/pancake, at\n";
+    std::cerr << "                 most $PANCAKE_CACHE_LIMIT KiB, else 256 MiB) and reused\n";
+    std::cerr << "                 while the script is unchanged\n";
+    std::cerr << "  --vm           run the program on the bytecode VM instead of walking\n";
+    std::cerr << "                 the tree; not used by --watch. Not faster than walking\n";
+    std::cerr << "                 yet, see tests/bench_vm.sh\n";
+    std::cerr << "  --jit          compile larger int, double and bool expressions to machine\n";
+    std::cerr << "                 code before running them (x86-64 Linux); not used by --vm\n";
+    std::cerr << "  --flush        write out each line of output at once; by default output\n";
+    std::cerr << "                 is line-buffered on a terminal, else block-buffered\n";
+    std::cerr << "  --out-file F   write the program's output to file F instead of stdout\n";
+    std::cerr << "  --async-out    write output from a separate thread, so the program only\n";
+    std::cerr << "                 waits for a slow reader when 1 MiB of output is queued\n";
+    std::cerr << "  --out-queue K  the same, queueing up to K KiB\n";
+    std::cerr << "  --in-file F    read input for `in` statements from file F; a script's\n";
+    std::cerr << "                 stdin is read the same way unless it is a terminal\n";
+    std::cerr << "  --record-input F  log every value `in` statements read to file F\n";
+    std::cerr << "  --replay-input F  take those values from such a log instead of reading\n";
+    std::cerr << "                 input; an error, and exit status 1, if the program asks\n";
+    std::cerr << "                 for other input\n";
+    std::cerr << "  --emit-cpp F   translate the script to a C++ program in file F, which\n";
+    std::cerr << "                 behaves as the script run here, without running it\n";
+    std::cerr << "  --compile F    build that program into executable F with the system\n";
+    std::cerr << "                 C++ compiler ($CXX, else c++)\n";
+    return 1;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc == 1) {
-        runConsole();
-    } else if (argc == 2) {
-        // One argument → treat as filename and run script
-        runFile(argv[1]);
-    } else {
-        std::cerr << "Usage:\n";
-        std::cerr << "  " << argv[0] << "          # interactive mode\n";
-        std::cerr << "  " << argv[0] << " file.pnc  # run script\n";
+    RunOptions options;
+    std::string filename;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            try {
+                options.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+            } catch (const std::exception&) {
+                return usage(argv[0]);
+            }
+        } else if (arg == "-w" || arg == "--watch") {
+            options.watch = true;
+        } else if (arg == "-s" || arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--no-cache") {
+            options.cache = false;
+        } else if (arg == "--vm") {
+            options.vm = true;
+        } else if (arg == "--jit") {
+            options.jit = true;
+        } else if (arg == "--flush") {
+            options.flush = true;
+        } else if (arg == "--out-file" && i + 1 < argc) {
+            options.outFile = argv[++i];
+        } else if (arg == "--in-file" && i + 1 < argc) {
+            options.inFile = argv[++i];
+        } else if (arg == "--record-input" && i + 1 < argc) {
+            options.recordInput = argv[++i];
+        } else if (arg == "--replay-input" && i + 1 < argc) {
+            options.replayInput = argv[++i];
+        } else if (arg == "--emit-cpp" && i + 1 < argc) {
+            options.emitCpp = argv[++i];
+        } else if (arg == "--compile" && i + 1 < argc) {
+            options.compileTo = argv[++i];
+        } else if (arg == "--async-out") {
+            options.outQueue = Output::DEFAULT_RING;
+        } else if (arg == "--out-queue" && i + 1 < argc) {
+            try {
+                options.outQueue = static_cast<std::size_t>(std::stoul(argv[++i])) * 1024;
+            } catch (const std::exception&) {
+                return usage(argv[0]);
+            }
+        } else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 &&
+                   arg[2] >= '0' && arg[2] <= '0' + Optimizer::MAX_LEVEL) {
+            options.optimize = arg[2] - '0';
+        } else if (!arg.empty() && arg[0] == '-') {
+            return usage(argv[0]);
+        } else if (filename.empty()) {
+            filename = arg;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    if (!options.emitCpp.empty() || !options.compileTo.empty()) {
+        if (filename.empty() || options.watch || options.stream) return usage(argv[0]);
+        return compileFile(filename, options);
+    }
+
+    Output& out = Output::standard();
+    if (!options.outFile.empty() && !out.openFile(options.outFile)) {
+        std::cerr << "Error: Could not open file '" << options.outFile << "' for writing\n";
         return 1;
     }
-    return 0;
+    if (options.flush) out.setFlush(Output::Flush::LINE);
+    if (options.outQueue > 0) out.startWriter(options.outQueue);
+
+    // Input is read ahead in bulk, so not from the stdin the REPL reads
+    // its lines from
+    Input& in = Input::standard();
+    std::string error;
+    if (!options.replayInput.empty()) {
+        if (!in.replay(options.replayInput, error)) {
+            std::cerr << "Error: " << error << '\n';
+            return 1;
+        }
+    } else if (!options.inFile.empty()) {
+        if (!in.openFile(options.inFile)) {
+            std::cerr << "Error: Could not open file '" << options.inFile << "'\n";
+            return 1;
+        }
+    } else if (!filename.empty()) {
+        in.openStandard();
+    }
+    if (!options.recordInput.empty() && !in.record(options.recordInput)) {
+        std::cerr << "Error: Could not open file '" << options.recordInput << "' for writing\n";
+        return 1;
+    }
+
+    if (filename.empty()) {
+        if (options.watch || options.stream) return usage(argv[0]);
+        runConsole(options);
+    } else if (options.watch) {
+        watchFile(filename, options);
+    } else if (options.stream) {
+        streamFile(filename, options);
+    } else {
+        // One file argument → run script
+        runFile(filename, options);
+    }
+    // A replay that went its own way is not a run of the recorded session
+    return in.replayFailed() ? 1 : 0;
 }
 
-void runConsole() {
+void runConsole(const RunOptions& options) {
     // version, compiler, and platform info
     std::string version = "Pancake 0.0.1";
     std::string buildDate = __DATE__;
@@ -58,8 +220,12 @@ void runConsole() {
     std::string line;
     TypeChecker checker;
     Interpreter interpreter;
+    interpreter.setJit(options.jit);
+    VM vm;
+    Ast ast;
 
     while (true) {
+        Output::standard().flush();   // the previous line's output before the prompt
         std::cout << "pan -> ";
         std::getline(std::cin, line);
         if (line == "exit;" || std::cin.eof()) break;
@@ -77,60 +243,233 @@ void runConsole() {
             
             /*
             std::cout << "=== Tokens ===\n";
-            for (const Token& t : lexer.getTokens()) {
-                t.debug();
+            for (std::size_t i = 0; i < lexer.getTokens().size(); i++) {
+                lexer.getTokens().debug(i);
             }
             std::cout << "==============\n"; */ //The clean debug lines just uncomment the code to use
 
-            Parser parser(lexer.getTokens(), checker);
-            auto ast = parser.parse();
+            ast.clear();  // the previous line's nodes are no longer needed
+            Parser parser(lexer.getTokens(), checker, ast);
+            NodeList program = parser.parse();
+
+            // Later lines may use this line's variables, so only passes that
+            // look at one statement at a time apply
+            program = Optimizer(ast, options.optimize, false).run(program);
 
             /*
             std::cout << "=== AST ===\n";
-            for (const auto& stmt : ast) {
-                stmt->debugPrint();
+            for (NodeId stmt : ast.statements(program)) {
+                ast.statement(stmt)->debugPrint(ast);
             }
             std::cout << "==============\n";
 
             std::cout << "=== Result ===\n";  *///The clean debug lines just uncomment the code to use
             
-            interpreter.execute(ast);
+            if (options.vm) {
+                vm.setSource(line);
+                vm.execute(ast, program);
+            } else {
+                interpreter.setSource(line);
+                interpreter.execute(ast, program);
+            }
             
         }
         catch(const std::exception& e)
         {
+            Output::standard().flush();
             std::cerr << "Syntax Error: " << e.what() << '\n';
         }
 
     }
 }
 
-void runFile(const std::string& filename) {
-    std::ifstream file(filename);
+// Whole file in one read; a cached run spends most of its startup here
+static bool readFile(const std::string& filename, std::string& out) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    std::streamoff size = file.tellg();
+    if (size < 0) return false;
+    out.resize(static_cast<std::size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(&out[0], size));
+}
+
+// The script's program: from the cache while the source is unchanged,
+// else parsed, optimised and cached
+static NodeList buildProgram(const std::string& source, const RunOptions& options, Ast& ast) {
+    NodeList program;
+    ProgramCache cache;
+    if (!options.cache || !cache.load(source, options.optimize, ast, program)) {
+        // Tokenize and parse
+        TypeChecker checker;
+        Tokeniser lexer(source);
+        lexer.tokenizeParallel(options.jobs);
+
+        Parser parser(lexer.getTokens(), checker, ast);
+        program = parser.parse();
+        program = Optimizer(ast, options.optimize, true).run(program);
+        if (options.cache) cache.store(source, options.optimize, ast, program);
+    }
+    return program;
+}
+
+void runFile(const std::string& filename, const RunOptions& options) {
+    Interpreter interpreter;
+    interpreter.setJit(options.jit);
+    std::string fullSource;
+
+    if (!readFile(filename, fullSource)) {
+        std::cerr << "Error: Could not open file '" << filename << "'\n";
+        return;
+    }
+
+    try {
+
+        Ast ast;
+        NodeList program = buildProgram(fullSource, options, ast);
+
+        if (options.vm) {
+            VM vm;
+            vm.setSource(fullSource);
+            vm.execute(ast, program);
+        } else {
+            interpreter.setSource(fullSource);
+            interpreter.execute(ast, program);
+        }
+
+    } catch (const std::exception& e) {
+        Output::standard().flush();
+        std::cerr << "Error: " << e.what() << '\n';
+    }
+}
+
+// Translate the script to C++ instead of running it, and build that if
+// asked to; the exit status says whether it all worked
+int compileFile(const std::string& filename, const RunOptions& options) {
+    std::string source;
+    if (!readFile(filename, source)) {
+        std::cerr << "Error: Could not open file '" << filename << "'\n";
+        return 1;
+    }
+
+    std::string code;
+    try {
+        Ast ast;
+        NodeList program = buildProgram(source, options, ast);
+        code = CppEmitter().emit(ast, program, source);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+
+    if (!options.emitCpp.empty()) {
+        std::ofstream file(options.emitCpp, std::ios::binary);
+        if (!file.write(code.data(), static_cast<std::streamsize>(code.size()))) {
+            std::cerr << "Error: Could not open file '" << options.emitCpp << "' for writing\n";
+            return 1;
+        }
+    }
+    if (!options.compileTo.empty() && !CppEmitter::compile(code, options.compileTo)) {
+        std::cerr << "Error: Could not build '" << options.compileTo << "'\n";
+        return 1;
+    }
+    return 0;
+}
+
+void streamFile(const std::string& filename, const RunOptions& options) {
+    std::ifstream file(filename, std::ios::binary);
     TypeChecker checker;
     Interpreter interpreter;
-    
+    interpreter.setJit(options.jit);
+    VM vm;
+
     if (!file) {
         std::cerr << "Error: Could not open file '" << filename << "'\n";
         return;
     }
 
     try {
-        // Read entire file
-        std::ostringstream buffer;
-        buffer << file.rdbuf();
-        std::string fullSource = buffer.str();
-
-        // Tokenize and parse
-        Tokeniser lexer(fullSource);
-        lexer.tokenize();
+        SourceStream stream(file);
+        Ast ast;
+        while (stream.next()) {
+            Parser parser(stream.tokens(), checker, ast);
+            interpreter.setSource(stream.text(), stream.firstLine());
+            vm.setSource(stream.text(), stream.firstLine());
 
-        Parser parser(lexer.getTokens(), checker);
-        auto ast = parser.parse();
+            // Each statement is freed as soon as it has run; the arena's
+            // memory is reused for the next one
+            for (NodeId statement = parser.parseNext(); statement != NO_NODE; statement = parser.parseNext()) {
+                NodeList unit = ast.addStatements({statement});
+                unit = Optimizer(ast, options.optimize, false).run(unit);
+                if (options.vm) {
+                    vm.execute(ast, unit);
+                } else {
+                    interpreter.execute(ast, unit);
+                }
+                ast.clear();
+            }
+        }
+    } catch (const std::exception& e) {
+        Output::standard().flush();
+        std::cerr << "Error: " << e.what() << '\n';
+    }
+}
 
-        interpreter.execute(ast);
+// Run the document's statements with a fresh interpreter, or print its
+// diagnostics if it has any
+static void runDocument(Document& doc, const RunOptions& options) {
+    auto errors = doc.diagnostics();
+    if (!errors.empty()) {
+        for (const auto& error : errors) std::cerr << "Error: " << error << '\n';
+        return;
+    }
 
+    Interpreter interpreter;
+    interpreter.setJit(options.jit);
+    interpreter.setSource(doc.text());
+    try {
+        for (NodeId statement : doc.statements()) {
+            interpreter.execute(doc.ast(), statement);
+        }
     } catch (const std::exception& e) {
+        Output::standard().flush();
         std::cerr << "Error: " << e.what() << '\n';
     }
+    Output::standard().flush();
+}
+
+void watchFile(const std::string& filename, const RunOptions& options) {
+    namespace fs = std::filesystem;
+    using Clock = std::chrono::steady_clock;
+
+    std::string text;
+    if (!readFile(filename, text)) {
+        std::cerr << "Error: Could not open file '" << filename << "'\n";
+        return;
+    }
+
+    auto started = Clock::now();
+    Document doc(text);
+    auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    std::cerr << "[watch] " << filename << ": " << doc.tokens().size() << " tokens in " << elapsed << " ms\n";
+    runDocument(doc, options);
+
+    std::error_code ec;
+    fs::file_time_type lastWrite = fs::last_write_time(filename, ec);
+
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        fs::file_time_type now = fs::last_write_time(filename, ec);
+        if (ec || now == lastWrite) continue;
+        lastWrite = now;
+        if (!readFile(filename, text) || text == doc.text()) continue;
+
+        started = Clock::now();
+        doc.setText(text);
+        elapsed = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+        std::cerr << "[watch] " << filename << ": relexed " << doc.relexedTokens()
+                  << " tokens, reparsed " << doc.reparsedStatements() << " statements in " << elapsed << " ms\n";
+        runDocument(doc, options);
+    }
 }
@@ -0,0 +1,779 @@
+#include "./headers/optimizer.h"
+#include "./headers/astvisitor.h"
+#include "./headers/output.h"
+#include "./headers/symbolmap.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string>
+
+const Optimizer::Pass Optimizer::PIPELINE[] = {
+    {"fold-constants", 1, false, &Optimizer::foldConstants},
+    {"prune-branches", 1, false, &Optimizer::pruneBranches},
+    {"propagate-constants", 2, true, &Optimizer::propagateConstants},
+    // Conditions on propagated values are constant now
+    {"fold-constants", 2, true, &Optimizer::foldConstants},
+    {"prune-branches", 2, true, &Optimizer::pruneBranches},
+    {"eliminate-dead-stores", 2, true, &Optimizer::eliminateDeadStores},
+    {"eliminate-common-subexpressions", 1, false, &Optimizer::eliminateCommonSubexpressions},
+    {"join-outputs", 1, false, &Optimizer::joinOutputs},
+};
+
+Optimizer::Optimizer(Ast& ast, int level, bool wholeProgram)
+    : ast(ast), level(level), wholeProgram(wholeProgram) {}
+
+NodeList Optimizer::run(NodeList program) {
+    for (const Pass& pass : PIPELINE) {
+        if (level < pass.level || (pass.wholeProgram && !wholeProgram)) continue;
+        program = (this->*pass.run)(program);
+    }
+    return program;
+}
+
+
+// ---- Tree walking ----
+
+template <typename F>
+static void forEachIn(Ast& ast, NodeList block, F& f);
+
+// Call f on `stmt` and every statement nested in it, parents first. Lists
+// are indexed afresh at each step because f may add new ones.
+template <typename F>
+static void forEachNested(Ast& ast, Statements* stmt, F& f) {
+    f(stmt);
+    auto* branch = nodeCast<IfStatement>(stmt);
+    if (!branch) return;
+    forEachIn(ast, branch->ifBranch, f);
+    for (std::uint32_t k = 0; k < branch->elifBranches.count; k++) {
+        forEachIn(ast, ast.elifs(branch->elifBranches)[k].body, f);
+    }
+    forEachIn(ast, branch->elseBranch, f);
+}
+
+template <typename F>
+static void forEachIn(Ast& ast, NodeList block, F& f) {
+    for (std::uint32_t k = 0; k < block.count; k++) {
+        forEachNested(ast, ast.statement(ast.statements(block)[k]), f);
+    }
+}
+
+// Replace each expression `stmt` evaluates itself (not those of nested
+// statements) with rewrite(id), visiting them in evaluation order
+template <typename F>
+static void rewriteExpressions(Ast& ast, Statements* stmt, F& rewrite) {
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: {
+            auto* decl = static_cast<VarDecl*>(stmt);
+            decl->value = rewrite(decl->value);
+            break;
+        }
+        case NodeKind::ASSIGNMENT: {
+            auto* assignment = static_cast<Assignment*>(stmt);
+            assignment->value = rewrite(assignment->value);
+            break;
+        }
+        case NodeKind::EXPRESSION_STATEMENT: {
+            auto* statement = static_cast<ExpressionStatement*>(stmt);
+            statement->expression = rewrite(statement->expression);
+            break;
+        }
+        case NodeKind::OUT: {
+            auto* out = static_cast<OutStatement*>(stmt);
+            for (std::uint32_t k = 0; k < out->outputs.count; k++) {
+                NodeId replaced = rewrite(ast.expressions(out->outputs)[k]);
+                ast.expressionAt(out->outputs, k) = replaced;
+            }
+            break;
+        }
+        case NodeKind::IF: {
+            auto* branch = static_cast<IfStatement*>(stmt);
+            branch->condition = rewrite(branch->condition);
+            for (std::uint32_t k = 0; k < branch->elifBranches.count; k++) {
+                NodeId replaced = rewrite(ast.elifs(branch->elifBranches)[k].condition);
+                ast.elifAt(branch->elifBranches, k).condition = replaced;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Rebuild the expression `id` bottom-up: children first, then the node
+// itself is replaced with f(id)
+template <typename F>
+static NodeId rewriteTree(Ast& ast, NodeId id, F& f) {
+    Expressions* expr = ast.expression(id);
+    if (auto* binary = nodeCast<BinExpr>(expr)) {
+        binary->left = rewriteTree(ast, binary->left, f);
+        binary->right = rewriteTree(ast, binary->right, f);
+    } else if (auto* unary = nodeCast<UnaryExpr>(expr)) {
+        unary->setExpr(rewriteTree(ast, unary->getExpr(), f));
+    } else if (auto* shared = nodeCast<SharedExpr>(expr)) {
+        shared->expr = rewriteTree(ast, shared->expr, f);
+    }
+    return f(id);
+}
+
+// The literal `id` refers to, if it is one with a runtime value
+static const Literal* asConstant(const Ast& ast, NodeId id) {
+    const Literal* literal = nodeCast<Literal>(ast.expression(id));
+    return literal && literal->type != ValueType::ENDL ? literal : nullptr;
+}
+
+
+// ---- Constant folding ----
+
+static Literal intConstant(int value) {
+    Literal literal(ValueType::INT, {});
+    literal.intValue = value;
+    return literal;
+}
+
+static Literal doubleConstant(double value) {
+    Literal literal(ValueType::DOUBLE, {});
+    literal.doubleValue = value;
+    return literal;
+}
+
+static Literal boolConstant(bool value) {
+    Literal literal(ValueType::BOOL, {});
+    literal.boolValue = value;
+    return literal;
+}
+
+static bool isNumber(const Literal& literal) {
+    return literal.type == ValueType::INT || literal.type == ValueType::DOUBLE;
+}
+
+static double numberValue(const Literal& literal) {
+    return literal.type == ValueType::INT ? static_cast<double>(literal.intValue) : literal.doubleValue;
+}
+
+// `l op r` computed the way the interpreter does. False where
+// the interpreter raises an error, so the error still happens, at the same
+// point, when the program runs. Integer arithmetic wraps instead of being
+// left undefined.
+static bool foldBinary(Ast& ast, BinaryOp op, const Literal& l, const Literal& r, Literal& result) {
+    if (l.type == ValueType::INT && r.type == ValueType::INT) {
+        int a = l.intValue;
+        int b = r.intValue;
+        unsigned ua = static_cast<unsigned>(a);
+        unsigned ub = static_cast<unsigned>(b);
+        switch (op) {
+            case BinaryOp::ADD: result = intConstant(static_cast<int>(ua + ub)); return true;
+            case BinaryOp::SUB: result = intConstant(static_cast<int>(ua - ub)); return true;
+            case BinaryOp::MUL: result = intConstant(static_cast<int>(ua * ub)); return true;
+            case BinaryOp::DIV:
+                if (b == 0) return false;
+                result = intConstant(divideInt(a, b));
+                return true;
+            case BinaryOp::MOD:
+                if (b == 0) return false;
+                result = intConstant(remainderInt(a, b));
+                return true;
+            case BinaryOp::EQ: result = boolConstant(a == b); return true;
+            case BinaryOp::NE: result = boolConstant(a != b); return true;
+            case BinaryOp::LT: result = boolConstant(a < b); return true;
+            case BinaryOp::GT: result = boolConstant(a > b); return true;
+            case BinaryOp::LE: result = boolConstant(a <= b); return true;
+            case BinaryOp::GE: result = boolConstant(a >= b); return true;
+            default: return false;
+        }
+    }
+    if (isNumber(l) && isNumber(r)) {
+        double a = numberValue(l);
+        double b = numberValue(r);
+        switch (op) {
+            case BinaryOp::ADD: result = doubleConstant(a + b); return true;
+            case BinaryOp::SUB: result = doubleConstant(a - b); return true;
+            case BinaryOp::MUL: result = doubleConstant(a * b); return true;
+            case BinaryOp::DIV:
+                if (b == 0.0) return false;
+                result = doubleConstant(a / b);
+                return true;
+            case BinaryOp::EQ: result = boolConstant(a == b); return true;
+            case BinaryOp::NE: result = boolConstant(a != b); return true;
+            case BinaryOp::LT: result = boolConstant(a < b); return true;
+            case BinaryOp::GT: result = boolConstant(a > b); return true;
+            case BinaryOp::LE: result = boolConstant(a <= b); return true;
+            case BinaryOp::GE: result = boolConstant(a >= b); return true;
+            default: return false;
+        }
+    }
+    if (l.type == ValueType::STRING && r.type == ValueType::STRING) {
+        if (op == BinaryOp::ADD) {
+            std::string joined(ast.text(l.value));
+            joined += ast.text(r.value);
+            result = Literal::string(ast, joined);
+            return true;
+        }
+        bool equal = ast.text(l.value) == ast.text(r.value);
+        if (op == BinaryOp::EQ) { result = boolConstant(equal); return true; }
+        if (op == BinaryOp::NE) { result = boolConstant(!equal); return true; }
+        return false;
+    }
+    if (l.type == ValueType::BOOL && r.type == ValueType::BOOL) {
+        bool a = l.boolValue;
+        bool b = r.boolValue;
+        switch (op) {
+            case BinaryOp::AND: result = boolConstant(a && b); return true;
+            case BinaryOp::OR: result = boolConstant(a || b); return true;
+            case BinaryOp::EQ: result = boolConstant(a == b); return true;
+            case BinaryOp::NE: result = boolConstant(a != b); return true;
+            default: return false;
+        }
+    }
+    return false;
+}
+
+// Same for Interpreter::evaluateUnaryExpr
+static bool foldUnary(UnaryOp op, const Literal& operand, Literal& result) {
+    if (op == UnaryOp::NOT) {
+        if (operand.type != ValueType::BOOL) return false;
+        result = boolConstant(!operand.boolValue);
+        return true;
+    }
+    if (operand.type == ValueType::INT) {
+        result = intConstant(static_cast<int>(0u - static_cast<unsigned>(operand.intValue)));
+        return true;
+    }
+    if (operand.type == ValueType::DOUBLE) {
+        result = doubleConstant(-operand.doubleValue);
+        return true;
+    }
+    return false;
+}
+
+NodeList Optimizer::foldConstants(NodeList program) {
+    auto fold = [this](NodeId id) { return foldNode(id); };
+    auto foldTree = [this, &fold](NodeId root) { return rewriteTree(ast, root, fold); };
+    auto foldStatement = [this, &foldTree](Statements* stmt) { rewriteExpressions(ast, stmt, foldTree); };
+    forEachIn(ast, program, foldStatement);
+    return program;
+}
+
+// A literal in place of `id` if its operands already are literals
+NodeId Optimizer::foldNode(NodeId id) {
+    const Expressions* expr = ast.expression(id);
+    Literal folded(ValueType::INT, {});
+    if (const auto* binary = nodeCast<BinExpr>(expr)) {
+        const Literal* left = asConstant(ast, binary->left);
+        const Literal* right = asConstant(ast, binary->right);
+        if (left && right && foldBinary(ast, binary->op, *left, *right, folded)) {
+            return makeConstant(folded, expr->offset);
+        }
+    } else if (const auto* unary = nodeCast<UnaryExpr>(expr)) {
+        const Literal* operand = asConstant(ast, unary->getExpr());
+        if (operand && foldUnary(unary->getOp(), *operand, folded)) {
+            return makeConstant(folded, expr->offset);
+        }
+    }
+    return id;
+}
+
+// Add `literal` to the tree, giving it a lexeme for debugPrint
+NodeId Optimizer::makeConstant(Literal literal, std::uint32_t offset) {
+    char text[32];
+    if (literal.type == ValueType::INT) {
+        literal.value = ast.addText(std::string_view(text, std::to_chars(text, text + sizeof text, literal.intValue).ptr - text));
+    } else if (literal.type == ValueType::DOUBLE) {
+        literal.value = ast.addText(std::string_view(text, std::to_chars(text, text + sizeof text, literal.doubleValue).ptr - text));
+    } else if (literal.type == ValueType::BOOL) {
+        literal.value = ast.addText(literal.boolValue ? "true" : "false");
+    }
+    NodeId id = ast.makeExpression<Literal>(literal);
+    ast.expression(id)->offset = offset;
+    return id;
+}
+
+
+// ---- Dead branch removal ----
+
+NodeList Optimizer::pruneBranches(NodeList program) {
+    return pruneBlock(program);
+}
+
+NodeList Optimizer::pruneBlock(NodeList block) {
+    // Only if statements change; most blocks have none
+    bool hasBranch = false;
+    for (NodeId id : ast.statements(block)) hasBranch |= ast.statement(id)->kind == NodeKind::IF;
+    if (!hasBranch) return block;
+
+    std::vector<NodeId> kept;
+    kept.reserve(block.count);
+    for (std::uint32_t k = 0; k < block.count; k++) pruneStatement(ast.statements(block)[k], kept);
+
+    ListView<NodeId> old = ast.statements(block);
+    if (std::equal(kept.begin(), kept.end(), old.begin(), old.end())) return block;
+    return ast.addStatements(kept);
+}
+
+// Append the statement to `out`, or, when which branch of it runs is known
+// before the program does, that branch's statements in its place. A branch
+// that declares variables keeps its block, which they are local to.
+void Optimizer::pruneStatement(NodeId id, std::vector<NodeId>& out) {
+    auto* branch = nodeCast<IfStatement>(ast.statement(id));
+    if (!branch) {
+        out.push_back(id);
+        return;
+    }
+
+    const Literal* condition = asConstant(ast, branch->condition);
+    if (condition && condition->type != ValueType::BOOL) {
+        // A runtime error whatever the branches hold
+        out.push_back(id);
+        return;
+    }
+    if (condition && condition->boolValue) {
+        if (branch->ifFrame.count == 0) {
+            spliceBlock(branch->ifBranch, out);
+            return;
+        }
+        branch->elifBranches = NodeList{};
+        branch->elseBranch = NodeList{};
+        branch->elseFrame = Frame{};
+        branch->ifBranch = pruneBlock(branch->ifBranch);
+        out.push_back(id);
+        return;
+    }
+
+    // Elifs are only looked at once the condition is false. One whose
+    // condition is a literal other than `true` never runs; `elif (true)`
+    // always does, and nothing after it can.
+    bool constantElif = false;
+    for (const ElifBranch& elif : ast.elifs(branch->elifBranches)) {
+        constantElif |= asConstant(ast, elif.condition) != nullptr;
+    }
+    if (constantElif) {
+        std::vector<ElifBranch> elifs;
+        for (const ElifBranch& elif : ast.elifs(branch->elifBranches)) {
+            const Literal* elifCondition = asConstant(ast, elif.condition);
+            if (!elifCondition) {
+                elifs.push_back(elif);
+            } else if (elifCondition->type == ValueType::BOOL && elifCondition->boolValue) {
+                branch->elseBranch = elif.body;
+                branch->elseFrame = elif.frame;
+                break;
+            }
+        }
+        branch->elifBranches = ast.addElifs(elifs);
+    }
+
+    if (condition && branch->elifBranches.count == 0 && branch->elseFrame.count == 0) {
+        spliceBlock(branch->elseBranch, out);
+        return;
+    }
+
+    branch->ifBranch = condition ? NodeList{} : pruneBlock(branch->ifBranch);
+    for (std::uint32_t k = 0; k < branch->elifBranches.count; k++) {
+        NodeList body = pruneBlock(ast.elifs(branch->elifBranches)[k].body);
+        ast.elifAt(branch->elifBranches, k).body = body;
+    }
+    branch->elseBranch = pruneBlock(branch->elseBranch);
+    out.push_back(id);
+}
+
+void Optimizer::spliceBlock(NodeList block, std::vector<NodeId>& out) {
+    for (std::uint32_t k = 0; k < block.count; k++) pruneStatement(ast.statements(block)[k], out);
+}
+
+
+// ---- Whole program passes ----
+
+namespace {
+
+const std::size_t NOT_TOP_LEVEL = static_cast<std::size_t>(-1);
+
+// How a variable is used across the program
+struct VariableUse {
+    std::uint32_t declarations = 0;
+    std::uint32_t assignments = 0;
+    std::uint32_t inputs = 0;       // `in` statements; they also read its type
+    std::uint32_t reads = 0;
+    std::size_t declaredAt = NOT_TOP_LEVEL;     // top-level statement that declares it
+    std::size_t firstAssigned = NOT_TOP_LEVEL;  // first top-level statement assigning it
+    NodeId value = NO_NODE;         // initializer of the declaration
+    bool literalStores = true;      // every value stored is a literal
+};
+
+// Stand-in for a variable's reads
+struct KnownValue {
+    NodeId value;
+    std::size_t from;   // top-level statements after this one see it
+};
+
+}
+
+static void countReads(const Ast& ast, NodeId id, SymbolMap<VariableUse>& uses) {
+    const Expressions* expr = ast.expression(id);
+    switch (expr->kind) {
+        case NodeKind::VAR:
+            uses[static_cast<const VarExpr*>(expr)->name].reads++;
+            break;
+        case NodeKind::BINARY:
+            countReads(ast, static_cast<const BinExpr*>(expr)->left, uses);
+            countReads(ast, static_cast<const BinExpr*>(expr)->right, uses);
+            break;
+        case NodeKind::UNARY:
+            countReads(ast, static_cast<const UnaryExpr*>(expr)->getExpr(), uses);
+            break;
+        case NodeKind::SHARED:
+            countReads(ast, static_cast<const SharedExpr*>(expr)->expr, uses);
+            break;
+        default:
+            break;
+    }
+}
+
+static SymbolMap<VariableUse> analyseUses(Ast& ast, NodeList program) {
+    SymbolMap<VariableUse> uses;
+    for (std::uint32_t i = 0; i < program.count; i++) {
+        Statements* topStatement = ast.statement(ast.statements(program)[i]);
+        auto read = [&](NodeId expr) {
+            countReads(ast, expr, uses);
+            return expr;
+        };
+        auto record = [&](Statements* stmt) {
+            rewriteExpressions(ast, stmt, read);
+            if (auto* decl = nodeCast<VarDecl>(stmt)) {
+                VariableUse& use = uses[decl->name];
+                use.declarations++;
+                if (stmt == topStatement) use.declaredAt = i;
+                use.value = decl->value;
+                use.literalStores &= asConstant(ast, decl->value) != nullptr;
+            } else if (auto* assignment = nodeCast<Assignment>(stmt)) {
+                VariableUse& use = uses[assignment->name];
+                use.assignments++;
+                if (use.firstAssigned == NOT_TOP_LEVEL) use.firstAssigned = i;
+                use.literalStores &= asConstant(ast, assignment->value) != nullptr;
+            } else if (auto* input = nodeCast<InStatement>(stmt)) {
+                uses[input->varName].inputs++;
+            }
+        };
+        forEachNested(ast, topStatement, record);
+    }
+    return uses;
+}
+
+// A variable declared once at top level with a literal and never assigned
+// holds that literal from its declaration on, so reads after it can use the
+// literal directly. Reads before it still fail at runtime as they should.
+NodeList Optimizer::propagateConstants(NodeList program) {
+    SymbolMap<VariableUse> uses = analyseUses(ast, program);
+    SymbolMap<KnownValue> known;
+    uses.forEach([&](Symbol name, const VariableUse& use) {
+        if (use.reads > 0 && use.declarations == 1 && use.declaredAt != NOT_TOP_LEVEL &&
+            use.assignments == 0 && use.inputs == 0 && asConstant(ast, use.value)) {
+            known[name] = KnownValue{use.value, use.declaredAt};
+        }
+    });
+    if (known.size() == 0) return program;
+
+    for (std::uint32_t i = 0; i < program.count; i++) {
+        auto substitute = [&](NodeId id) {
+            const VarExpr* var = nodeCast<VarExpr>(ast.expression(id));
+            if (!var) return id;
+            const KnownValue* value = known.find(var->name);
+            return value && i > value->from ? value->value : id;
+        };
+        auto substituteTree = [&](NodeId root) { return rewriteTree(ast, root, substitute); };
+        auto substituteStatement = [&](Statements* stmt) { rewriteExpressions(ast, stmt, substituteTree); };
+        forEachNested(ast, ast.statement(ast.statements(program)[i]), substituteStatement);
+    }
+    return program;
+}
+
+static NodeList removeStores(Ast& ast, NodeList block, const SymbolMap<bool>& dead) {
+    std::vector<NodeId> kept;
+    for (std::uint32_t k = 0; k < block.count; k++) {
+        NodeId id = ast.statements(block)[k];
+        Statements* stmt = ast.statement(id);
+        if (auto* decl = nodeCast<VarDecl>(stmt)) {
+            if (dead.contains(decl->name)) continue;
+        } else if (auto* assignment = nodeCast<Assignment>(stmt)) {
+            if (dead.contains(assignment->name)) continue;
+        } else if (auto* branch = nodeCast<IfStatement>(stmt)) {
+            branch->ifBranch = removeStores(ast, branch->ifBranch, dead);
+            for (std::uint32_t e = 0; e < branch->elifBranches.count; e++) {
+                NodeList body = removeStores(ast, ast.elifs(branch->elifBranches)[e].body, dead);
+                ast.elifAt(branch->elifBranches, e).body = body;
+            }
+            branch->elseBranch = removeStores(ast, branch->elseBranch, dead);
+        }
+        kept.push_back(id);
+    }
+    return kept.size() == block.count ? block : ast.addStatements(kept);
+}
+
+// Declarations and assignments of variables nothing reads. Removing them
+// must not remove an error as well, so the variable has to be declared
+// exactly once, at top level, before anything assigns it, and only ever
+// be given literals.
+NodeList Optimizer::eliminateDeadStores(NodeList program) {
+    SymbolMap<VariableUse> uses = analyseUses(ast, program);
+    SymbolMap<bool> dead;
+    uses.forEach([&](Symbol name, const VariableUse& use) {
+        if (use.reads == 0 && use.inputs == 0 && use.declarations == 1 &&
+            use.declaredAt != NOT_TOP_LEVEL && use.literalStores &&
+            (use.firstAssigned == NOT_TOP_LEVEL || use.firstAssigned > use.declaredAt)) {
+            dead[name] = true;
+        }
+    });
+    if (dead.size() == 0) return program;
+    return removeStores(ast, program, dead);
+}
+
+
+// ---- Common subexpression elimination ----
+
+static std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return h * 0xBF58476D1CE4E5B9ull;
+}
+
+static bool isOperator(const Expressions* expr) {
+    return expr->kind == NodeKind::BINARY || expr->kind == NodeKind::UNARY;
+}
+
+static std::uint64_t literalBits(const Ast& ast, const Literal& literal) {
+    std::uint64_t bits = 0;
+    switch (literal.type) {
+        case ValueType::INT: bits = static_cast<std::uint32_t>(literal.intValue); break;
+        case ValueType::DOUBLE: std::memcpy(&bits, &literal.doubleValue, sizeof bits); break;
+        case ValueType::BOOL: bits = literal.boolValue; break;
+        case ValueType::STRING: bits = literal.constant; break;   // interned, so equal texts have one
+        default: bits = std::hash<std::string_view>()(ast.text(literal.value)); break;
+    }
+    return bits;
+}
+
+static bool sameTree(const Ast& ast, NodeId a, NodeId b) {
+    if (a == b) return true;
+    const Expressions* x = ast.expression(a);
+    const Expressions* y = ast.expression(b);
+    if (x->kind != y->kind) return false;
+    switch (x->kind) {
+        case NodeKind::LITERAL: {
+            const auto* l = static_cast<const Literal*>(x);
+            const auto* r = static_cast<const Literal*>(y);
+            if (l->type != r->type) return false;
+            if (l->type == ValueType::STRING || l->type == ValueType::ENDL) return ast.text(l->value) == ast.text(r->value);
+            return literalBits(ast, *l) == literalBits(ast, *r);
+        }
+        case NodeKind::VAR:
+            return static_cast<const VarExpr*>(x)->name == static_cast<const VarExpr*>(y)->name;
+        case NodeKind::BINARY: {
+            const auto* l = static_cast<const BinExpr*>(x);
+            const auto* r = static_cast<const BinExpr*>(y);
+            return l->op == r->op && sameTree(ast, l->left, r->left) && sameTree(ast, l->right, r->right);
+        }
+        case NodeKind::UNARY: {
+            const auto* l = static_cast<const UnaryExpr*>(x);
+            const auto* r = static_cast<const UnaryExpr*>(y);
+            return l->getOp() == r->getOp() && sameTree(ast, l->getExpr(), r->getExpr());
+        }
+        default:
+            return false;
+    }
+}
+
+namespace {
+
+// An operator node of the statement being looked at
+struct Candidate {
+    NodeId id;
+    NodeId rep = NO_NODE;           // first equal node in evaluation order
+    std::uint32_t order = 0;        // position in evaluation order
+    std::uint32_t occurrences = 0;  // of this node, when it is a representative
+    NodeId sharedAs = NO_NODE;      // its SharedExpr, when it is a representative
+    std::uint64_t hash = 0;
+};
+
+// Scratch state, reused from statement to statement
+struct Sharing {
+    std::vector<Candidate> nodes;   // sorted by id once collected
+    std::vector<std::size_t> reps;
+    std::uint32_t slots = 0;
+
+    Candidate& find(NodeId id) {
+        auto it = std::lower_bound(nodes.begin(), nodes.end(), id,
+            [](const Candidate& c, NodeId key) { return c.id < key; });
+        return *it;
+    }
+};
+
+}
+
+// Structural hash of an expression; its operator nodes are added to
+// `nodes` in evaluation order. Equal trees hash equal.
+static std::uint64_t collect(const Ast& ast, NodeId id, std::vector<Candidate>& nodes) {
+    const Expressions* expr = ast.expression(id);
+    std::uint64_t h = static_cast<std::uint64_t>(expr->kind) + 1;
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            const auto* literal = static_cast<const Literal*>(expr);
+            return mix(mix(h, static_cast<std::uint64_t>(literal->type)), literalBits(ast, *literal));
+        }
+        case NodeKind::VAR:
+            return mix(h, static_cast<const VarExpr*>(expr)->name);
+        case NodeKind::BINARY: {
+            const auto* binary = static_cast<const BinExpr*>(expr);
+            h = mix(h, static_cast<std::uint64_t>(binary->op));
+            h = mix(h, collect(ast, binary->left, nodes));
+            h = mix(h, collect(ast, binary->right, nodes));
+            break;
+        }
+        case NodeKind::UNARY: {
+            const auto* unary = static_cast<const UnaryExpr*>(expr);
+            h = mix(h, static_cast<std::uint64_t>(unary->getOp()));
+            h = mix(h, collect(ast, unary->getExpr(), nodes));
+            break;
+        }
+        default:
+            return mix(h, id);
+    }
+    Candidate node;
+    node.id = id;
+    node.order = static_cast<std::uint32_t>(nodes.size());
+    node.hash = h;
+    nodes.push_back(node);
+    return h;
+}
+
+// Give every candidate its representative; false if no two are equal
+static bool findRepresentatives(const Ast& ast, std::vector<Candidate>& nodes, std::vector<std::size_t>& reps) {
+    std::sort(nodes.begin(), nodes.end(), [](const Candidate& a, const Candidate& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.order < b.order;
+    });
+    bool repeated = false;
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        // Representatives seen so far with this hash, in evaluation order
+        if (i == 0 || nodes[i].hash != nodes[i - 1].hash) reps.clear();
+        nodes[i].rep = nodes[i].id;
+        for (std::size_t r : reps) {
+            if (sameTree(ast, nodes[r].id, nodes[i].id)) {
+                nodes[i].rep = nodes[r].id;
+                repeated = true;
+                break;
+            }
+        }
+        if (nodes[i].rep == nodes[i].id) reps.push_back(i);
+    }
+    return repeated;
+}
+
+// Occurrences as the interpreter would meet them: a repeated subexpression
+// is only looked into once, since it will be evaluated once
+static void countOccurrences(const Ast& ast, NodeId id, Sharing& s) {
+    const Expressions* expr = ast.expression(id);
+    if (!isOperator(expr)) return;
+    if (++s.find(s.find(id).rep).occurrences > 1) return;
+    if (const auto* binary = nodeCast<BinExpr>(expr)) {
+        countOccurrences(ast, binary->left, s);
+        countOccurrences(ast, binary->right, s);
+    } else {
+        countOccurrences(ast, static_cast<const UnaryExpr*>(expr)->getExpr(), s);
+    }
+}
+
+static NodeId share(Ast& ast, NodeId id, Sharing& s);
+
+static void shareChildren(Ast& ast, NodeId id, Sharing& s) {
+    Expressions* expr = ast.expression(id);
+    if (auto* binary = nodeCast<BinExpr>(expr)) {
+        binary->left = share(ast, binary->left, s);
+        binary->right = share(ast, binary->right, s);
+    } else if (auto* unary = nodeCast<UnaryExpr>(expr)) {
+        unary->setExpr(share(ast, unary->getExpr(), s));
+    }
+}
+
+static NodeId share(Ast& ast, NodeId id, Sharing& s) {
+    if (!isOperator(ast.expression(id))) return id;
+    NodeId rep = s.find(id).rep;
+    if (s.find(rep).occurrences < 2) {
+        shareChildren(ast, id, s);
+        return id;
+    }
+    if (s.find(rep).sharedAs != NO_NODE) return s.find(rep).sharedAs;
+
+    shareChildren(ast, rep, s);
+    NodeId shared = ast.makeExpression<SharedExpr>(rep, ast.expression(rep)->type, s.slots++);
+    ast.expression(shared)->offset = ast.expression(rep)->offset;
+    s.find(rep).sharedAs = shared;
+    return shared;
+}
+
+// Within a statement nothing is stored between the evaluation of its
+// expressions (an if's condition and elif conditions included), so a
+// subexpression repeated there has the same value every time.
+NodeList Optimizer::eliminateCommonSubexpressions(NodeList program) {
+    Sharing s;
+    auto shareStatement = [&](Statements* stmt) {
+        s.nodes.clear();
+        s.slots = 0;
+        auto collectRoot = [&](NodeId root) { collect(ast, root, s.nodes); return root; };
+        rewriteExpressions(ast, stmt, collectRoot);
+        if (s.nodes.size() < 2 || !findRepresentatives(ast, s.nodes, s.reps)) return;
+
+        std::sort(s.nodes.begin(), s.nodes.end(), [](const Candidate& a, const Candidate& b) { return a.id < b.id; });
+        auto countRoot = [&](NodeId root) { countOccurrences(ast, root, s); return root; };
+        rewriteExpressions(ast, stmt, countRoot);
+        auto shareRoot = [&](NodeId root) { return share(ast, root, s); };
+        rewriteExpressions(ast, stmt, shareRoot);
+    };
+    forEachIn(ast, program, shareStatement);
+    return program;
+}
+
+
+// ---- Output joining ----
+
+// `literal` as an out statement writes it
+static void appendOutput(const Ast& ast, const Literal& literal, std::string& text) {
+    char number[Output::NUMBER_WIDTH];
+    switch (literal.type) {
+        case ValueType::INT: text.append(number, Output::format(number, literal.intValue)); break;
+        case ValueType::DOUBLE: text.append(number, Output::format(number, literal.doubleValue)); break;
+        case ValueType::BOOL: text += literal.boolValue ? "true" : "false"; break;
+        default: text += ast.text(literal.value); break;
+    }
+}
+
+// Each run of constants in an out statement becomes one string literal, so
+// the fixed parts of a line are formatted once, here, and written with a
+// single copy. Only neighbours are joined: output before a runtime error is
+// still written, and none after it.
+NodeList Optimizer::joinOutputs(NodeList program) {
+    std::vector<NodeId> joined;
+    auto joinStatement = [&](Statements* stmt) {
+        auto* out = nodeCast<OutStatement>(stmt);
+        if (!out) return;
+        joined.clear();
+        bool changed = false;
+        std::uint32_t count = out->outputs.count;
+        for (std::uint32_t k = 0, end; k < count; k = end) {
+            NodeId id = ast.expressions(out->outputs)[k];
+            const Literal* first = asConstant(ast, id);
+            end = k + 1;
+            if (first) {
+                while (end < count && asConstant(ast, ast.expressions(out->outputs)[end])) end++;
+            }
+            if (!first || (end == k + 1 && first->type == ValueType::STRING)) {
+                joined.push_back(id);
+                continue;
+            }
+            std::string text;
+            for (std::uint32_t j = k; j < end; j++) {
+                appendOutput(ast, *asConstant(ast, ast.expressions(out->outputs)[j]), text);
+            }
+            joined.push_back(makeConstant(Literal::string(ast, text), first->offset));
+            changed = true;
+        }
+        if (changed) out->outputs = ast.addExpressions(joined);
+    };
+    forEachIn(ast, program, joinStatement);
+    return program;
+}
@@ -0,0 +1,312 @@
+#include "./headers/output.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+static bool isTerminal(int fd) { return _isatty(fd) != 0; }
+
+static int openForWriting(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+static void trimFile(int, std::uint64_t) {}
+static void closeHandle(int fd) { _close(fd); }
+
+// All of `size` bytes, false if the file refuses them
+static bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        unsigned chunk = size > 0x40000000 ? 0x40000000u : static_cast<unsigned>(size);
+        int written = _write(fd, data, chunk);
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+#else
+
+static bool isTerminal(int fd) { return isatty(fd) != 0; }
+
+static int openForWriting(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+}
+
+// Space reserved past `size` is given back
+static void trimFile(int fd, std::uint64_t size) {
+    int truncated = ftruncate(fd, static_cast<off_t>(size));
+    (void)truncated;   // the output is complete either way
+}
+
+static void closeHandle(int fd) { ::close(fd); }
+
+// All of the parts, false if the file refuses them
+static bool writeAll(int fd, iovec* parts, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, parts, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        // Skip what went out; a partial write leaves a part half done
+        std::size_t left = static_cast<std::size_t>(written);
+        while (count > 0 && left >= parts->iov_len) {
+            left -= parts->iov_len;
+            parts++;
+            count--;
+        }
+        if (count > 0) {
+            parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+            parts->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const char* data, std::size_t size) {
+    iovec part = {const_cast<char*>(data), size};
+    return writeAll(fd, &part, 1);
+}
+
+#endif
+
+static void closeFile(int fd, std::uint64_t size) {
+    trimFile(fd, size);
+    closeHandle(fd);
+}
+
+
+// ---- Writer thread ----
+
+// A ring of buffer-sized chunks between the interpreter, which fills them,
+// and the writer thread, which empties them in order. Each side advances
+// its own counter and only reads the other's, so handing over a chunk takes
+// no lock; the mutex is only for sleeping, when the ring is empty or full.
+struct Output::Writer {
+    std::size_t chunks;
+    std::unique_ptr<char[]> ring;
+    std::unique_ptr<std::size_t[]> lengths;   // bytes used in each chunk
+
+    std::atomic<std::uint64_t> published{0};   // chunks handed over so far
+    std::atomic<std::uint64_t> drained{0};     // chunks written out so far
+    std::atomic<bool> stopping{false};
+
+    // A side sets its flag before it sleeps, and the other side, having
+    // moved its counter, looks at the flag to know whether to wake it
+    std::atomic<bool> writerAsleep{false};
+    std::atomic<bool> producerAsleep{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+
+    std::thread thread;
+
+    explicit Writer(std::size_t chunks)
+        : chunks(chunks), ring(new char[chunks * CAPACITY]), lengths(new std::size_t[chunks]) {}
+
+    char* chunk(std::uint64_t n) { return ring.get() + (n % chunks) * CAPACITY; }
+
+    void wakeWriter() {
+        if (!writerAsleep.load()) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_all();
+    }
+
+    void wakeProducer() {
+        if (!producerAsleep.load()) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_all();
+    }
+
+    // Block the interpreter until `count` chunks have been written
+    void waitDrained(std::uint64_t count) {
+        if (drained.load() >= count) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        producerAsleep.store(true);
+        wake.wait(lock, [&] { return drained.load() >= count; });
+        producerAsleep.store(false);
+    }
+};
+
+
+// ---- Output ----
+
+Output::Output(int fd)
+    : fd(fd), flushPolicy(isTerminal(fd) ? Flush::LINE : Flush::BLOCK),
+      storage(new char[CAPACITY]), buffer(storage.get()) {}
+
+Output::~Output() {
+    close();
+}
+
+Output& Output::standard() {
+    static Output out(1);
+    return out;
+}
+
+bool Output::openFile(const std::string& path) {
+    flush();
+    // Trimmed before `path` is opened: if it is the same file, trimming
+    // afterwards would grow the emptied file back to its old size
+    if (ownsFile) trimFile(fd, written);
+    int file = openForWriting(path);
+    if (file < 0) return false;
+    if (ownsFile) closeHandle(fd);
+    fd = file;
+    ownsFile = true;
+    flushPolicy = isTerminal(fd) ? Flush::LINE : Flush::BLOCK;
+    written = 0;
+    reserved = 0;
+#ifdef __linux__
+    preallocate = true;
+#endif
+    return true;
+}
+
+void Output::startWriter(std::size_t capacity) {
+    if (writer) return;
+    flush();
+    writer.reset(new Writer(std::max<std::size_t>(capacity / CAPACITY, 2)));
+    storage.reset();
+    buffer = writer->chunk(0);
+    writer->thread = std::thread(&Output::drain, this);
+}
+
+void Output::stopWriter() {
+    if (!writer) return;
+    flush();
+    writer->stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(writer->mutex);
+        writer->wake.notify_all();
+    }
+    writer->thread.join();
+    writer.reset();
+    storage.reset(new char[CAPACITY]);
+    buffer = storage.get();
+}
+
+void Output::close() {
+    stopWriter();
+    flush();
+    if (ownsFile) closeFile(fd, written);
+    ownsFile = false;
+}
+
+void Output::flush() {
+    if (used > 0) handOver();
+    if (writer) writer->waitDrained(writer->published.load());
+}
+
+void Output::handOver() {
+    if (!writer) {
+        sink(buffer, used);
+        used = 0;
+        return;
+    }
+    Writer& w = *writer;
+    std::uint64_t n = w.published.load(std::memory_order_relaxed);
+    w.lengths[n % w.chunks] = used;
+    w.published.store(n + 1);
+    w.wakeWriter();
+
+    // The chunk after it is free once the writer is less than a ring behind
+    if (n + 2 > w.chunks) w.waitDrained(n + 2 - w.chunks);
+    buffer = w.chunk(n + 1);
+    used = 0;
+}
+
+void Output::drain() {
+    Writer& w = *writer;
+    for (std::uint64_t n = 0;; n++) {
+        if (w.published.load() == n) {
+            std::unique_lock<std::mutex> lock(w.mutex);
+            w.writerAsleep.store(true);
+            w.wake.wait(lock, [&] { return w.published.load() != n || w.stopping.load(); });
+            w.writerAsleep.store(false);
+            if (w.published.load() == n) return;   // stopped, and nothing left
+        }
+        sink(w.chunk(n), w.lengths[n % w.chunks]);
+        w.drained.store(n + 1);
+        w.wakeProducer();
+    }
+}
+
+void Output::writeLong(std::string_view text) {
+    if (text.size() < DIRECT || writer) {
+        // Copied, a buffer at a time; the writer thread could not hold on
+        // to the caller's string
+        for (;;) {
+            std::size_t part = std::min(CAPACITY - used, text.size());
+            std::memcpy(buffer + used, text.data(), part);
+            used += part;
+            text.remove_prefix(part);
+            if (text.empty()) return;
+            handOver();
+        }
+    }
+    // The buffered text and the string in one call, neither copied
+#ifdef _WIN32
+    handOver();
+    sink(text.data(), text.size());
+#else
+    if (preallocate) reserve(used + text.size());
+    iovec parts[2] = {{buffer, used}, {const_cast<char*>(text.data()), text.size()}};
+    writeAll(fd, parts, 2);
+    written += used + text.size();
+    used = 0;
+#endif
+}
+
+// Output that cannot be written, e.g. to a closed pipe, is dropped, as it
+// would be by a stream in a failed state
+void Output::sink(const char* data, std::size_t size) {
+    if (preallocate) reserve(size);
+    writeAll(fd, data, size);
+    written += size;
+}
+
+// Make sure the file has space for `size` more bytes, reserving it in steps
+// that grow with the file so the filesystem can lay it out contiguously
+void Output::reserve(std::size_t size) {
+#ifdef __linux__
+    static const std::uint64_t MIN_STEP = 1 << 20;
+    static const std::uint64_t MAX_STEP = 64 << 20;
+    if (written + size <= reserved) return;
+    std::uint64_t step = std::min(std::max(reserved, MIN_STEP), MAX_STEP);
+    std::uint64_t end = std::max<std::uint64_t>(written + size, reserved + step);
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(reserved), static_cast<off_t>(end - reserved)) != 0) {
+        preallocate = false;   // not supported here; plain writes still work
+        return;
+    }
+    reserved = end;
+#else
+    (void)size;
+#endif
+}
+
+std::size_t Output::format(char* out, int value) {
+    return static_cast<std::size_t>(std::to_chars(out, out + NUMBER_WIDTH, value).ptr - out);
+}
+
+// As printf("%g"): to_chars with a precision follows its rules, including
+// "inf" and "nan"
+std::size_t Output::format(char* out, double value) {
+    return static_cast<std::size_t>(std::to_chars(out, out + NUMBER_WIDTH, value, std::chars_format::general, 6).ptr - out);
+}
@@ -1,6 +1,7 @@
 #include "./headers/parser.h"
 #include "./headers/token.h"      // for Token
 #include "./headers/typechecker.h"
+#include "./headers/syntaxerror.h"
 
 #include "./headers/statements.h" // for Statements and subclasses
 #include "./headers/vardecl.h"
@@ -16,26 +17,39 @@
 #include "./headers/unaryexpr.h"
 
 #include <stdexcept>
+#include <charconv>
 
 const int LOWEST_PRECEDENCE = 1;
 
-Parser::Parser(const std::vector<Token>& tokens, TypeChecker& typeChecker)
-    : tokens(tokens), typeChecker(typeChecker), current(0) {}
+Parser::Parser(const TokenBuffer& tokens, TypeChecker& typeChecker, Ast& ast)
+    : tokens(tokens), current(0), typeChecker(typeChecker), ast(ast) {}
 
     
-std::vector<std::unique_ptr<Statements>> Parser::parse() {
-    std::vector<std::unique_ptr<Statements>> statements;
-    while (!isAtEnd()) {
-        auto stmt = parseStatement();
-        if (stmt) {  // Only add if not null
-            statements.push_back(std::move(stmt));
-        }
+NodeList Parser::parse() {
+    std::vector<NodeId> statements;
+    for (NodeId stmt = parseNext(); stmt != NO_NODE; stmt = parseNext()) {
+        statements.push_back(stmt);
+    }
+    return ast.addStatements(statements);
+}
+
+
+NodeId Parser::parseNext() {
+    NodeId stmt = parseStatement();
+    if (stmt == NO_NODE && !isAtEnd()) {
+        // parseStatement() stops at a '}' so blocks can end; at top level it is stray
+        error(peek(), "Unexpected '}' outside of a block");
     }
-    return statements;
+    return stmt;
+}
+
+
+void Parser::seek(std::size_t tokenIndex) {
+    current = tokenIndex;
 }
 
 
-std::unique_ptr<Statements> Parser::parseStatement() {
+NodeId Parser::parseStatement() {
     // Skip any empty lines or unexpected tokens before statements
     while (!isAtEnd()) {
         // Accept these as valid "empty" statements
@@ -44,13 +58,13 @@ std::unique_ptr<Statements> Parser::parseStatement() {
         }
         // Stop skipping when we hit a closing brace
         if (check(TokenType::RBRACE)) {
-            return nullptr;
+            return NO_NODE;
         }
         break;
     }
 
     if (isAtEnd()) {
-        return nullptr;
+        return NO_NODE;
     }
 
     // Handle actual statements
@@ -62,18 +76,17 @@ std::unique_ptr<Statements> Parser::parseStatement() {
         return parseExpressionStatement();
     }
 
-    throw std::runtime_error( "Unexpected Statement: '"  + peek().value + "' at line " 
-        + std::to_string(peek().line) +
-        ", column " + std::to_string(peek().column));
+    throw SyntaxError(peek().offset, tokens.location(peek()),
+        "Unexpected Statement: '"  + text(peek()) + "' at ", "");
 }
 
-std::unique_ptr<Statements> Parser::parseVarDecl() {
+NodeId Parser::parseVarDecl() {
     consume(TokenType::LET, "Expected 'let' keyword");
-    std::string type;
-    if (peek().type == TokenType::TYPE_INT) type = "int";
-    else if (peek().type == TokenType::TYPE_DOUBLE) type = "double";
-    else if (peek().type == TokenType::TYPE_STRING) type = "string";
-    else if (peek().type == TokenType::TYPE_BOOL) type = "bool";
+    ValueType type = ValueType::INT;
+    if (peek().type == TokenType::TYPE_INT) type = ValueType::INT;
+    else if (peek().type == TokenType::TYPE_DOUBLE) type = ValueType::DOUBLE;
+    else if (peek().type == TokenType::TYPE_STRING) type = ValueType::STRING;
+    else if (peek().type == TokenType::TYPE_BOOL) type = ValueType::BOOL;
     else error(peek(), "Expected variable type");
 
     advance();
@@ -81,33 +94,40 @@ std::unique_ptr<Statements> Parser::parseVarDecl() {
     if (peek().type != TokenType::IDENTIFIER)
         error(peek(), "Expected variable name");
 
-    std::string name = peek().value;
+    Token nameToken = peek();
+    Symbol name = nameToken.symbol;
     advance();
 
     consume(TokenType::EQ, "Expected '=' in variable declaration");
-    auto value = parseExpression();
+    NodeId value = parseExpression();
 
     // Check type match
-    if (auto* literal = dynamic_cast<Literal*>(value.get())) {
-        if (literal->type != type) {
-            error(peek(), "Type mismatch: expected " + type + " but got " + literal->type);
-        }
+    ValueType valueType = ast.expression(value)->type;
+    if (valueType != type) {
+        error(peek(), std::string("Type mismatch: expected ") + typeName(type) + " but got " + typeName(valueType));
     }
 
     consume(TokenType::SEMICOLON, "Expected ';' after variable declaration");
 
-    // Register in type checker
-    typeChecker.declare(name, type);
+    // A name has one type in its scope, whichever of its declarations
+    // there runs; a block may shadow it with another
+    std::optional<TypeChecker::Binding> declared = typeChecker.resolve(name);
+    if (declared && declared->depth == typeChecker.depth() && declared->type != type) {
+        typeError(nameToken.offset, "Variable '" + symbolName(name) + "' already declared as " + typeName(declared->type));
+    }
+    std::uint32_t slot = typeChecker.declare(name, type);
 
-    auto varDecl = std::make_unique<VarDecl>(type, name, std::move(value));
-    varDecl->column = peek().column;
-    varDecl->line = peek().line;
+    NodeId varDecl = ast.makeStatement<VarDecl>(type, name, value);
+    auto* decl = static_cast<VarDecl*>(ast.statement(varDecl));
+    decl->offset = peek().offset;
+    decl->depth = typeChecker.depth();
+    decl->slot = slot;
     return varDecl;
 }
 
 
-std::unique_ptr<Statements> Parser::parseOut() {
-    std::vector<std::unique_ptr<Expressions>> expressions;
+NodeId Parser::parseOut() {
+    std::vector<NodeId> expressions;
 
     do {
         consume(TokenType::GT, "Expected '>' after 'out' or expression");
@@ -116,113 +136,138 @@ std::unique_ptr<Statements> Parser::parseOut() {
 
     consume(TokenType::SEMICOLON, "Expected ';' after out statement");
 
-    auto outStmt = std::make_unique<OutStatement>(std::move(expressions));
-    outStmt->column = peek().column;
-    outStmt->line = peek().line;
+    NodeId outStmt = ast.makeStatement<OutStatement>(ast.addExpressions(expressions));
+    ast.statement(outStmt)->offset = peek().offset;
     return outStmt;
 }
 
 
-std::unique_ptr<Statements> Parser::parseIn() {
+NodeId Parser::parseIn() {
 
     consume(TokenType::LT, "Expected '<' after 'in'");
 
     if (peek().type != TokenType::IDENTIFIER)
         error(peek(), "Expected identifier after '<' in input statement");
 
-    std::string name = peek().value;
+    Token nameToken = peek();
+    Symbol name = nameToken.symbol;
     advance();
 
     consume(TokenType::SEMICOLON, "Expected ';' after input statement");
 
-    auto inStmt = std::make_unique<InStatement>(name);
-    inStmt->column = peek().column;
-    inStmt->line = peek().line;
+    // Input into an unknown name declares it as a string
+    std::optional<TypeChecker::Binding> binding = typeChecker.resolve(name);
+    if (!binding) {
+        binding = TypeChecker::Binding{ValueType::STRING, typeChecker.depth(), typeChecker.declare(name, ValueType::STRING)};
+    }
+    if (binding->type == ValueType::BOOL) {
+        typeError(nameToken.offset, "Cannot read input into bool variable: " + symbolName(name));
+    }
+
+    NodeId inStmt = ast.makeStatement<InStatement>(name, binding->type);
+    auto* in = static_cast<InStatement*>(ast.statement(inStmt));
+    in->offset = peek().offset;
+    in->depth = binding->depth;
+    in->slot = binding->slot;
     return inStmt;
 }
 
 
-std::unique_ptr<Statements> Parser::parseIf() {
+NodeId Parser::parseIf() {
     // Parse initial `if` condition
     consume(TokenType::LPAREN, "Expected '(' after 'if'");
-    auto condition = parseExpression();
+    NodeId condition = parseExpression();
+    checkCondition(condition);
     consume(TokenType::RPAREN, "Expected ')' after condition");
 
     // Parse main 'if' block
     consume(TokenType::LBRACE, "Expected '{' after if condition");
-    std::vector<std::unique_ptr<Statements>> ifBranch;
-    while (!check(TokenType::RBRACE) && !isAtEnd()) {
-        auto stmt = parseStatement();
-        if (stmt) ifBranch.push_back(std::move(stmt));
-    }
-    consume(TokenType::RBRACE, "Expected '}' after if block");
+    Frame ifFrame;
+    NodeList ifBranch = parseBlock("Expected '}' after if block", ifFrame);
 
     // Parse `elif` branches
-    std::vector<std::pair<std::unique_ptr<Expressions>, std::vector<std::unique_ptr<Statements>>>> elifBranches;
+    std::vector<ElifBranch> elifBranches;
     while (match(TokenType::ELIF)) {
         consume(TokenType::LPAREN, "Expected '(' after 'elif'");
-        auto elifCondition = parseExpression();
+        NodeId elifCondition = parseExpression();
+        checkCondition(elifCondition);
         consume(TokenType::RPAREN, "Expected ')' after condition");
 
         consume(TokenType::LBRACE, "Expected '{' after 'elif' condition");
-        std::vector<std::unique_ptr<Statements>> elifBlock;
-        while (!check(TokenType::RBRACE) && !isAtEnd()) {
-            auto stmt = parseStatement();
-            if (stmt) elifBlock.push_back(std::move(stmt));
-        }
-        consume(TokenType::RBRACE, "Expected '}' after 'elif' block");
+        Frame elifFrame;
+        NodeList elifBlock = parseBlock("Expected '}' after 'elif' block", elifFrame);
 
-        elifBranches.emplace_back(std::move(elifCondition), std::move(elifBlock));
+        elifBranches.push_back(ElifBranch{elifCondition, elifBlock, elifFrame});
     }
 
     // Parse else branch (if present)
-    std::vector<std::unique_ptr<Statements>> elseBranch;
+    NodeList elseBranch;
+    Frame elseFrame;
     if (match(TokenType::ELSE)) {
         consume(TokenType::LBRACE, "Expected '{' after 'else'");
-        while (!check(TokenType::RBRACE) && !isAtEnd()) {
-            auto stmt = parseStatement();
-            if (stmt) elseBranch.push_back(std::move(stmt));
-        }
-        consume(TokenType::RBRACE, "Expected '}' after 'else' block");
+        elseBranch = parseBlock("Expected '}' after 'else' block", elseFrame);
     }
 
-    auto ifStmt = std::make_unique<IfStatement>(
-        std::move(condition),
-        std::move(ifBranch),
-        std::move(elifBranches),
-        std::move(elseBranch)
+    NodeId ifStmt = ast.makeStatement<IfStatement>(
+        condition,
+        ifBranch,
+        ast.addElifs(elifBranches),
+        elseBranch
     );
-    ifStmt->column = peek().column;
-    ifStmt->line = peek().line;
+    auto* branch = static_cast<IfStatement*>(ast.statement(ifStmt));
+    branch->offset = peek().offset;
+    branch->ifFrame = ifFrame;
+    branch->elseFrame = elseFrame;
     return ifStmt;
 }
 
 
-std::unique_ptr<Statements> Parser::parseExpressionStatement() {
+// Statements up to the closing '}' of a block, stored as one contiguous list.
+// The block is a scope; `frame` is set to the slots of its variables.
+NodeList Parser::parseBlock(const std::string& closeMessage, Frame& frame) {
+    std::vector<NodeId> block;
+    typeChecker.enterScope();
+    try {
+        while (!check(TokenType::RBRACE) && !isAtEnd()) {
+            NodeId stmt = parseStatement();
+            if (stmt != NO_NODE) block.push_back(stmt);
+        }
+        consume(TokenType::RBRACE, closeMessage);
+    } catch (...) {
+        // The checker outlives a failed parse, e.g. in the REPL
+        typeChecker.exitScope();
+        throw;
+    }
+    frame = typeChecker.exitScope();
+    return ast.addStatements(block);
+}
+
+
+NodeId Parser::parseExpressionStatement() {
     // Only allow assignments like: x = expression;
     if (peek().type == TokenType::IDENTIFIER && peekNext().type == TokenType::EQ) {
-        std::string name = peek().value;
+        Symbol name = peek().symbol;
         advance(); // consume identifier
         advance(); // consume '='
-        auto value = parseExpression();
+        NodeId value = parseExpression();
 
         // Type check
-        std::string expectedType = typeChecker.getType(name);
-        if (expectedType.empty()) {
-            error(peek(), "Assignment to undeclared variable: " + name);
+        std::optional<TypeChecker::Binding> target = typeChecker.resolve(name);
+        if (!target) {
+            error(peek(), "Assignment to undeclared variable: " + symbolName(name));
         }
 
-        // Literal check
-        if (auto* literal = dynamic_cast<Literal*>(value.get())) {
-            if (literal->type != expectedType) {
-                error(peek(), "Type mismatch: variable '" + name + "' expects " + expectedType + " but got " + literal->type);
-            }
+        ValueType valueType = ast.expression(value)->type;
+        if (valueType != target->type) {
+            error(peek(), "Type mismatch: variable '" + symbolName(name) + "' expects " + typeName(target->type) + " but got " + typeName(valueType));
         }
 
         consume(TokenType::SEMICOLON, "Expected ';' after assignment");
-        auto assignment = std::make_unique<Assignment>(name, std::move(value));
-        assignment->column = peek().column;
-        assignment->line = peek().line;
+        NodeId assignment = ast.makeStatement<Assignment>(name, value);
+        auto* stmt = static_cast<Assignment*>(ast.statement(assignment));
+        stmt->offset = peek().offset;
+        stmt->depth = target->depth;
+        stmt->slot = target->slot;
         return assignment;
     }
     error(peek(),"Invalid expression statement");
@@ -230,91 +275,65 @@ std::unique_ptr<Statements> Parser::parseExpressionStatement() {
 
 
 
-std::unique_ptr<Expressions> Parser::parseExpression() {
+NodeId Parser::parseExpression() {
     // Handle unary operators
     if (match(TokenType::NOT) || match(TokenType::MINUS)) {
         Token op = previous(); // capture the operator token
-        auto expr = parseExpression(); // parse the operand
-        
+        NodeId expr = parseExpression(); // parse the operand
+
         // Create the appropriate unary expression
-        if (op.type == TokenType::NOT) {
-            auto unexpr = std::make_unique<UnaryExpr>("!", std::move(expr));
-            unexpr->line = op.line;
-            unexpr->column = op.column;
-            return unexpr;
-        } else { // MINUS
-            auto unexpr = std::make_unique<UnaryExpr>("-", std::move(expr));
-            unexpr->line = op.line;
-            unexpr->column = op.column;
-            return unexpr;
+        UnaryOp unaryOp = op.type == TokenType::NOT ? UnaryOp::NOT : UnaryOp::NEGATE;
+        std::optional<ValueType> type = TypeChecker::unaryType(unaryOp, ast.expression(expr)->type);
+        if (!type) {
+            typeError(op.offset, unaryOp == UnaryOp::NOT
+                ? "NOT operator '!' requires a boolean operand"
+                : "Unary minus '-' requires a numeric operand");
         }
+
+        NodeId unexpr = ast.makeExpression<UnaryExpr>(unaryOp, expr);
+        ast.expression(unexpr)->offset = op.offset;
+        ast.expression(unexpr)->type = *type;
+        return unexpr;
     }
 
-    auto leftHandSide = parsePrimary();
-    return parseBinary(std::move(leftHandSide), LOWEST_PRECEDENCE);
+    NodeId leftHandSide = parsePrimary();
+    return parseBinary(leftHandSide, LOWEST_PRECEDENCE);
 }
 
 
 
-std::unique_ptr<Expressions> Parser::parsePrimary() {
+NodeId Parser::parsePrimary() {
     Token token = peek();
 
     if (token.type == TokenType::ENDL) {
-        auto lit = std::make_unique<Literal>("endl", "endl");
+        NodeId lit = ast.makeExpression<Literal>(ValueType::ENDL, ast.addText("endl"));
         advance();
-        lit->column = token.column;
-        lit->line = token.line;
+        ast.expression(lit)->offset = token.offset;
         return lit;
     }
 
-    if (token.type == TokenType::INT_LITERAL) {
-        std::string value = token.value;
-        advance();
-        auto lit = std::make_unique<Literal>(value, "int");
-        lit->column = peek().column;
-        lit->line = peek().line;
-        return lit;
-    }
-
-    if (token.type == TokenType::DOUBLE_LITERAL) {
-        std::string value = token.value;
-        advance();
-        auto lit = std::make_unique<Literal>(value, "double");
-        lit->column = peek().column;
-        lit->line = peek().line;
-        return lit;
-    }
-
-    if (token.type == TokenType::STRING_LITERAL) {
-        std::string value = token.value;
-        advance();
-        auto lit = std::make_unique<Literal>(value, "string");
-        lit->column = peek().column;
-        lit->line = peek().line;
-        return lit;
-    }
-
-    if (token.type == TokenType::BOOL_LITERAL) {
-        std::string value = token.value;
-        advance();
-        auto lit = std::make_unique<Literal>(value, "bool");
-        lit->column = peek().column;
-        lit->line = peek().line;
-        return lit;
-    }
+    if (token.type == TokenType::INT_LITERAL) return parseLiteral(ValueType::INT);
+    if (token.type == TokenType::DOUBLE_LITERAL) return parseLiteral(ValueType::DOUBLE);
+    if (token.type == TokenType::STRING_LITERAL) return parseLiteral(ValueType::STRING);
+    if (token.type == TokenType::BOOL_LITERAL) return parseLiteral(ValueType::BOOL);
 
     if (token.type == TokenType::IDENTIFIER) {
-        std::string name = token.value;
+        std::optional<TypeChecker::Binding> binding = typeChecker.resolve(token.symbol);
+        if (!binding) typeError(token.offset, "Undefined variable: " + symbolName(token.symbol));
+
         advance();
-        auto varExp = std::make_unique<VarExpr>(name);
-        varExp->column = peek().column;
-        varExp->line = peek().line;
+        NodeId varExp = ast.makeExpression<VarExpr>(token.symbol);
+        auto* var = static_cast<VarExpr*>(ast.expression(varExp));
+        var->offset = peek().offset;
+        var->type = binding->type;
+        var->depth = binding->depth;
+        var->slot = binding->slot;
         return varExp;
     }
 
     if (token.type == TokenType::LPAREN) {
         advance(); // consume '('
-        auto expr = parseExpression();
+        NodeId expr = parseExpression();
         consume(TokenType::RPAREN, "Expected ')' after expression");
         return expr;
     }
@@ -322,30 +341,69 @@ std::unique_ptr<Expressions> Parser::parsePrimary() {
 }
 
 
-std::unique_ptr<Expressions> Parser::parseBinary(std::unique_ptr<Expressions> left, int minPrecedence) {
+NodeId Parser::parseBinary(NodeId left, int minPrecedence) {
     while (true) {
         int precedence = getPrecedence(peek());
         if (precedence < minPrecedence) break;
 
-        Token opToken = peek();  // Save token for line/col
-        std::string op = opToken.value;
+        Token opToken = peek();  // Save token for its source offset
+        BinaryOp op = binaryOp(opToken.type);
         advance();
 
-        auto right = parsePrimary();
+        NodeId right = parsePrimary();
         int nextPrecedence = getPrecedence(peek());
         if (precedence < nextPrecedence) {
-            right = parseBinary(std::move(right), precedence + 1);
+            right = parseBinary(right, precedence + 1);
         }
 
-        auto binExpr = std::make_unique<BinExpr>(op, std::move(left), std::move(right));
-        binExpr->line = opToken.line;
-        binExpr->column = opToken.column;
-        left = std::move(binExpr);
+        ValueType leftType = ast.expression(left)->type;
+        ValueType rightType = ast.expression(right)->type;
+        std::optional<ValueType> type = TypeChecker::binaryType(op, leftType, rightType);
+        if (!type) {
+            typeError(opToken.offset, std::string("Unsupported operation '") + opName(op) + "' for types " +
+                typeName(leftType) + " and " + typeName(rightType));
+        }
+
+        NodeId binExpr = ast.makeExpression<BinExpr>(op, left, right);
+        auto* node = static_cast<BinExpr*>(ast.expression(binExpr));
+        node->offset = opToken.offset;
+        node->type = *type;
+        node->operands = TypeChecker::operandType(leftType, rightType);
+        node->operation = TypeChecker::specialize(op, node->operands);
+        left = binExpr;
     }
     return left;
 }
 
 
+// Literal at the cursor, decoded to its value once here rather than on
+// every evaluation
+NodeId Parser::parseLiteral(ValueType type) {
+    Token token = peek();
+    std::string_view text = tokens.text(token);
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+
+    Literal literal = type == ValueType::STRING ? Literal::string(ast, text) : Literal(type, ast.addText(text));
+    std::from_chars_result result{last, std::errc()};
+    if (type == ValueType::INT) result = std::from_chars(first, last, literal.intValue);
+    else if (type == ValueType::DOUBLE) result = std::from_chars(first, last, literal.doubleValue);
+    else if (type == ValueType::BOOL) literal.boolValue = text == "true";
+
+    if (result.ec == std::errc::result_out_of_range) {
+        error(token, std::string("Literal out of range for ") + typeName(type));
+    }
+    if (result.ec != std::errc() || result.ptr != last) {
+        error(token, std::string("Malformed ") + typeName(type) + " literal");
+    }
+
+    advance();
+    NodeId lit = ast.makeExpression<Literal>(literal);
+    ast.expression(lit)->offset = peek().offset;
+    return lit;
+}
+
+
 bool Parser::match(TokenType type) {
     if (check(type)) {
         advance();
@@ -421,10 +479,24 @@ int Parser::getPrecedence(const Token& tok) {
     }
 }
 
+std::string Parser::text(const Token& tok) const {
+    return std::string(tokens.text(tok));
+}
+
+// `if` and `elif` conditions are decided at run time, so they must be bool
+void Parser::checkCondition(NodeId condition) const {
+    const Expressions* expr = ast.expression(condition);
+    if (expr->type != ValueType::BOOL) {
+        typeError(expr->offset, std::string("Condition must be a boolean, got ") + typeName(expr->type));
+    }
+}
+
 [[noreturn]] void Parser::error(const Token& token, const std::string& message) const {
-    throw std::runtime_error(
-        "Syntax Error at line " + std::to_string(token.line) +
-        ", column " + std::to_string(token.column) +
-        ": " + message + " got '" + token.value + "' "
-    );
+    throw SyntaxError(token.offset, tokens.location(token),
+        "Syntax Error at ", ": " + message + " got '" + text(token) + "' ");
+}
+
+[[noreturn]] void Parser::typeError(std::uint32_t offset, const std::string& message) const {
+    Token at{TokenType::UNKNOWN, offset, 0};
+    throw SyntaxError(offset, tokens.location(at), "Type Error at ", ": " + message);
 }
@@ -0,0 +1,593 @@
+#include "./headers/programcache.h"
+#include "./headers/astvisitor.h"
+#include "./headers/symboltable.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <random>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Version of the entry format: bump it whenever the header, a section, a
+// node struct or the meaning of a stored field (a NodeKind, an Operation,
+// a slot) changes. The struct layouts are part of the key as well (see
+// ProgramCache::layout), so a change missed here, or another compiler's
+// padding, still never maps an entry onto the wrong structs.
+static const std::uint32_t FORMAT_VERSION = 4;
+
+static const char MAGIC[8] = {'P', 'N', 'C', 'C', 'A', 'C', 'H', 'E'};
+
+// Most bytes of entries kept unless $PANCAKE_CACHE_LIMIT says otherwise;
+// beyond it the least recently used go
+static const std::uintmax_t DEFAULT_CAPACITY = std::uintmax_t{256} << 20;
+
+// Layout of an entry: the header, then each section at an 8-byte boundary
+// in the order of the fields below
+struct Header {
+    char magic[8];
+    std::uint64_t key;
+    std::uint64_t sourceSize;
+    NodeList program;
+    std::uint64_t nodeBytes;          // nodes, each at its own alignment
+    std::uint32_t statements;         // offsets of statement nodes
+    std::uint32_t expressions;        // offsets of expression nodes
+    std::uint32_t statementLists;
+    std::uint32_t expressionLists;
+    std::uint32_t elifLists;
+    std::uint64_t textBytes;          // the Ast's text pool
+    std::uint32_t strings;            // interned strings, as TextRefs into it
+    std::uint32_t symbols;            // names of symbols 1.., each ending in '\0'
+    std::uint64_t symbolBytes;
+    // then the source itself, sourceSize bytes: the key is only a hash
+    std::uint64_t checksum;           // hash of the entry with this field 0
+};
+
+static std::size_t aligned(std::size_t n, std::size_t align = 8) {
+    return (n + align - 1) & ~(align - 1);
+}
+
+// Multiply-xorshift steps of eight bytes, in four independent lanes so
+// the multiplies overlap; sources and entries are hashed on every run, so
+// this has to be much cheaper than tokenising them
+static std::uint64_t hashBytes(std::uint64_t h, const void* data, std::size_t size) {
+    const char* p = static_cast<const char*>(data);
+    auto mix = [](std::uint64_t& lane, std::uint64_t word) {
+        lane = (lane ^ word) * 0x9e3779b97f4a7c15ull;
+        lane ^= lane >> 29;
+    };
+    auto word = [p](std::size_t at) {
+        std::uint64_t w;
+        std::memcpy(&w, p + at, 8);
+        return w;
+    };
+    std::size_t i = 0;
+    if (size >= 32) {
+        std::uint64_t lanes[4] = {h, h + 1, h + 2, h + 3};
+        for (; i + 32 <= size; i += 32) {
+            for (int k = 0; k < 4; k++) mix(lanes[k], word(i + 8 * k));
+        }
+        for (std::uint64_t lane : lanes) mix(h, lane);
+    }
+    for (; i + 8 <= size; i += 8) mix(h, word(i));
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, p + i, size - i);
+    mix(h, tail ^ (static_cast<std::uint64_t>(size) << 56));
+    return h;
+}
+
+static std::uint64_t checksum(Header header, const char* sections, std::size_t size) {
+    header.checksum = 0;
+    return hashBytes(hashBytes(0, &header, sizeof header), sections, size);
+}
+
+
+
+// ---- Mapping entries into memory ----
+
+// An entry mapped read-only; nodes are used where they lie in the file
+class MappedFile {
+public:
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+    ~MappedFile();
+
+private:
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER size;
+    auto mapped = std::make_shared<MappedFile>();
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapped->mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapped->mapping) {
+            mapped->data = static_cast<const char*>(MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0));
+            mapped->size = static_cast<std::size_t>(size.QuadPart);
+        }
+    }
+    CloseHandle(file);
+    return mapped->data ? mapped : nullptr;
+}
+
+MappedFile::~MappedFile() {
+    if (data) UnmapViewOfFile(const_cast<char*>(data));
+    if (mapping) CloseHandle(mapping);
+}
+
+#else
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    auto mapped = std::make_shared<MappedFile>();
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* p = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            mapped->data = static_cast<const char*>(p);
+            mapped->size = static_cast<std::size_t>(info.st_size);
+        }
+    }
+    ::close(fd);
+    return mapped->data ? mapped : nullptr;
+}
+
+MappedFile::~MappedFile() {
+    if (data) munmap(const_cast<char*>(data), size);
+}
+
+#endif
+
+
+// ---- Checking entries ----
+
+namespace {
+
+// The sections of a mapped entry. Nothing in the file is trusted: a cache
+// directory can hold a torn write, a damaged disk block or anything else,
+// so the sections are summed and every offset, id, list and text reference
+// in them checked before the tree is used.
+struct Entry {
+    Header header;
+    const char* nodes = nullptr;
+    const std::uint32_t* statementOffsets = nullptr;
+    const std::uint32_t* expressionOffsets = nullptr;
+    const NodeId* statementLists = nullptr;
+    const NodeId* expressionLists = nullptr;
+    const ElifBranch* elifLists = nullptr;
+    const char* text = nullptr;
+    const TextRef* strings = nullptr;
+    const char* names = nullptr;
+    const char* source = nullptr;
+
+    // Point the sections into the `size` bytes at `base`; false if they
+    // do not fit or their sum is wrong
+    bool locate(const char* base, std::size_t size);
+
+    // Whether every node lies inside the nodes, at its alignment, and refers
+    // only to nodes, lists, text and strings that exist
+    bool valid() const;
+
+private:
+    template <typename Node>
+    const Node* node(std::uint32_t offset) const {
+        if (offset % alignof(Node) != 0 || offset > header.nodeBytes || sizeof(Node) > header.nodeBytes - offset) {
+            return nullptr;
+        }
+        return reinterpret_cast<const Node*>(nodes + offset);
+    }
+
+    bool statement(NodeId id) const { return id < header.statements; }
+    bool expression(NodeId id) const { return id < header.expressions; }
+    bool statements(NodeList list) const { return list.first <= header.statementLists && list.count <= header.statementLists - list.first; }
+    bool expressions(NodeList list) const { return list.first <= header.expressionLists && list.count <= header.expressionLists - list.first; }
+    bool elifs(NodeList list) const { return list.first <= header.elifLists && list.count <= header.elifLists - list.first; }
+    bool inText(TextRef ref) const { return ref.offset <= header.textBytes && ref.length <= header.textBytes - ref.offset; }
+
+    bool validStatement(std::uint32_t offset) const;
+    bool validExpression(std::uint32_t offset) const;
+};
+
+bool Entry::locate(const char* base, std::size_t size) {
+    std::size_t at = aligned(sizeof(Header));
+    if (size < at || checksum(header, base + at, size - at) != header.checksum) return false;
+
+    bool fits = true;
+    auto section = [&](std::uint64_t bytes) -> const char* {
+        if (at > size || bytes > size - at) {
+            fits = false;
+            return base;
+        }
+        const char* p = base + at;
+        at = aligned(at + static_cast<std::size_t>(bytes));
+        return p;
+    };
+    nodes = section(header.nodeBytes);
+    statementOffsets = reinterpret_cast<const std::uint32_t*>(section(std::uint64_t{header.statements} * sizeof(std::uint32_t)));
+    expressionOffsets = reinterpret_cast<const std::uint32_t*>(section(std::uint64_t{header.expressions} * sizeof(std::uint32_t)));
+    statementLists = reinterpret_cast<const NodeId*>(section(std::uint64_t{header.statementLists} * sizeof(NodeId)));
+    expressionLists = reinterpret_cast<const NodeId*>(section(std::uint64_t{header.expressionLists} * sizeof(NodeId)));
+    elifLists = reinterpret_cast<const ElifBranch*>(section(std::uint64_t{header.elifLists} * sizeof(ElifBranch)));
+    text = section(header.textBytes);
+    strings = reinterpret_cast<const TextRef*>(section(std::uint64_t{header.strings} * sizeof(TextRef)));
+    names = section(header.symbolBytes);
+    source = section(header.sourceSize);
+    return fits;
+}
+
+bool Entry::validStatement(std::uint32_t offset) const {
+    const Statements* stmt = node<Statements>(offset);
+    if (!stmt) return false;
+    switch (stmt->kind) {
+        case NodeKind::VAR_DECL: {
+            auto* decl = node<VarDecl>(offset);
+            return decl && expression(decl->value);
+        }
+        case NodeKind::ASSIGNMENT: {
+            auto* assignment = node<Assignment>(offset);
+            return assignment && expression(assignment->value);
+        }
+        case NodeKind::OUT: {
+            auto* out = node<OutStatement>(offset);
+            return out && expressions(out->outputs);
+        }
+        case NodeKind::IN:
+            return node<InStatement>(offset) != nullptr;
+        case NodeKind::IF: {
+            auto* branch = node<IfStatement>(offset);
+            return branch && expression(branch->condition) && statements(branch->ifBranch) &&
+                   elifs(branch->elifBranches) && statements(branch->elseBranch);
+        }
+        case NodeKind::EXPRESSION_STATEMENT: {
+            auto* expr = node<ExpressionStatement>(offset);
+            return expr && expression(expr->expression);
+        }
+        default:
+            return false;
+    }
+}
+
+bool Entry::validExpression(std::uint32_t offset) const {
+    const Expressions* expr = node<Expressions>(offset);
+    if (!expr) return false;
+    switch (expr->kind) {
+        case NodeKind::LITERAL: {
+            auto* literal = node<Literal>(offset);
+            return literal && inText(literal->value) &&
+                   (literal->type != ValueType::STRING || literal->constant < header.strings);
+        }
+        case NodeKind::VAR:
+            return node<VarExpr>(offset) != nullptr;
+        case NodeKind::BINARY: {
+            auto* binary = node<BinExpr>(offset);
+            return binary && expression(binary->left) && expression(binary->right);
+        }
+        case NodeKind::UNARY: {
+            auto* unary = node<UnaryExpr>(offset);
+            return unary && expression(unary->getExpr());
+        }
+        case NodeKind::SHARED: {
+            auto* shared = node<SharedExpr>(offset);
+            return shared && expression(shared->expr);
+        }
+        default:
+            return false;
+    }
+}
+
+bool Entry::valid() const {
+    if (!statements(header.program)) return false;
+    for (std::uint32_t i = 0; i < header.statements; i++) {
+        if (!validStatement(statementOffsets[i])) return false;
+    }
+    for (std::uint32_t i = 0; i < header.expressions; i++) {
+        if (!validExpression(expressionOffsets[i])) return false;
+    }
+    for (std::uint32_t i = 0; i < header.statementLists; i++) {
+        if (!statement(statementLists[i])) return false;
+    }
+    for (std::uint32_t i = 0; i < header.expressionLists; i++) {
+        if (!expression(expressionLists[i])) return false;
+    }
+    for (std::uint32_t i = 0; i < header.elifLists; i++) {
+        if (!expression(elifLists[i].condition) || !statements(elifLists[i].body)) return false;
+    }
+    for (std::uint32_t i = 0; i < header.strings; i++) {
+        if (!inText(strings[i])) return false;
+    }
+    return true;
+}
+
+}
+
+
+// ---- ProgramCache ----
+
+static std::string defaultDirectory() {
+    namespace fs = std::filesystem;
+    if (const char* dir = std::getenv("PANCAKE_CACHE_DIR")) return dir;
+#ifdef _WIN32
+    if (const char* local = std::getenv("LOCALAPPDATA")) return (fs::path(local) / "pancake").string();
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) return (fs::path(xdg) / "pancake").string();
+    if (const char* home = std::getenv("HOME")) return (fs::path(home) / ".cache" / "pancake").string();
+#endif
+    return "";
+}
+
+// $PANCAKE_CACHE_LIMIT in KiB, if it is a number
+static std::uintmax_t defaultCapacity() {
+    const char* limit = std::getenv("PANCAKE_CACHE_LIMIT");
+    if (!limit) return DEFAULT_CAPACITY;
+    std::uintmax_t kib = 0;
+    const char* end = limit + std::strlen(limit);
+    auto parsed = std::from_chars(limit, end, kib);
+    if (parsed.ec != std::errc() || parsed.ptr != end || kib > UINTMAX_MAX / 1024) return DEFAULT_CAPACITY;
+    return kib * 1024;
+}
+
+ProgramCache::ProgramCache(std::string dir)
+    : directory(dir.empty() ? defaultDirectory() : std::move(dir)), capacity(defaultCapacity()) {}
+
+std::string ProgramCache::entryPath(std::uint64_t key) const {
+    static const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; i--, key >>= 4) name[i] = digits[key & 15];
+    return (std::filesystem::path(directory) / (name + ".pnco")).string();
+}
+
+std::uint64_t ProgramCache::layout() {
+    std::vector<std::uint32_t> shape;
+    // Size and alignment of `object`, and where each of `fields` lies in it
+    auto record = [&shape](const auto& object, std::initializer_list<const void*> fields) {
+        shape.push_back(static_cast<std::uint32_t>(sizeof object));
+        shape.push_back(static_cast<std::uint32_t>(alignof(std::decay_t<decltype(object)>)));
+        for (const void* field : fields) {
+            auto at = static_cast<const char*>(field) - reinterpret_cast<const char*>(&object);
+            shape.push_back(static_cast<std::uint32_t>(at));
+        }
+    };
+
+    Header header{};
+    record(header, {&header.magic, &header.key, &header.sourceSize, &header.program, &header.nodeBytes,
+                    &header.statements, &header.expressions, &header.statementLists, &header.expressionLists,
+                    &header.elifLists, &header.textBytes, &header.strings, &header.symbols,
+                    &header.symbolBytes, &header.checksum});
+    NodeList list;
+    record(list, {&list.first, &list.count});
+    TextRef text;
+    record(text, {&text.offset, &text.length});
+    Frame frame;
+    record(frame, {&frame.first, &frame.count});
+    ElifBranch elif{};
+    record(elif, {&elif.condition, &elif.body, &elif.frame});
+
+    VarDecl decl(ValueType::INT, 0, 0);
+    record(decl, {&decl.kind, &decl.offset, &decl.type, &decl.name, &decl.value, &decl.depth, &decl.slot});
+    Assignment assignment(0, 0);
+    record(assignment, {&assignment.kind, &assignment.offset, &assignment.name, &assignment.value,
+                        &assignment.depth, &assignment.slot});
+    OutStatement out(NodeList{});
+    record(out, {&out.kind, &out.offset, &out.outputs});
+    InStatement in(0, ValueType::INT);
+    record(in, {&in.kind, &in.offset, &in.varName, &in.type, &in.depth, &in.slot});
+    IfStatement branch(0, NodeList{}, NodeList{}, NodeList{});
+    record(branch, {&branch.kind, &branch.offset, &branch.condition, &branch.ifBranch, &branch.elifBranches,
+                    &branch.elseBranch, &branch.ifFrame, &branch.elseFrame});
+    ExpressionStatement statement(0);
+    record(statement, {&statement.kind, &statement.offset, &statement.expression});
+
+    Literal literal(ValueType::INT, TextRef{});
+    record(literal, {&literal.kind, &literal.offset, &literal.type, &literal.value, &literal.intValue,
+                     &literal.doubleValue, &literal.boolValue, &literal.constant});
+    VarExpr var(0);
+    record(var, {&var.kind, &var.offset, &var.type, &var.name, &var.depth, &var.slot});
+    BinExpr binary(BinaryOp::ADD, 0, 0);
+    record(binary, {&binary.kind, &binary.offset, &binary.type, &binary.op, &binary.left, &binary.right,
+                    &binary.operands, &binary.operation});
+    UnaryExpr unary(UnaryOp::NEGATE, 0);
+    record(unary, {&unary.kind, &unary.offset, &unary.type, &unary.op, &unary.expr});
+    SharedExpr shared(0, ValueType::INT, 0);
+    record(shared, {&shared.kind, &shared.offset, &shared.type, &shared.expr, &shared.slot});
+
+    return hashBytes(FORMAT_VERSION, shape.data(), shape.size() * sizeof(std::uint32_t));
+}
+
+std::uint64_t ProgramCache::entryKey(const std::string& source, int optimize) {
+    static const std::uint64_t structs = layout();
+    std::uint64_t h = hashBytes(structs, &optimize, sizeof optimize);
+    return hashBytes(h, source.data(), source.size());
+}
+
+bool ProgramCache::load(const std::string& source, int optimize, Ast& ast, NodeList& program) {
+    if (directory.empty()) return false;
+    std::uint64_t key = entryKey(source, optimize);
+    std::string path = entryPath(key);
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file || file->size < sizeof(Header)) return false;
+
+    Entry entry;
+    std::memcpy(&entry.header, file->data, sizeof entry.header);
+    const Header& header = entry.header;
+    if (std::memcmp(header.magic, MAGIC, sizeof MAGIC) != 0 || header.key != key ||
+        header.sourceSize != source.size()) {
+        return false;
+    }
+    if (!entry.locate(file->data, file->size) || !entry.valid() ||
+        std::memcmp(entry.source, source.data(), source.size()) != 0) {
+        return false;
+    }
+
+    // Symbols are numbered in the order they were first seen; interning the
+    // names in that order into a fresh table gives the same numbers
+    SymbolTable& table = SymbolTable::global();
+    const char* name = entry.names;
+    for (Symbol symbol = 1; symbol <= header.symbols; symbol++) {
+        if (name >= entry.names + header.symbolBytes) return false;
+        std::size_t length = strnlen(name, static_cast<std::size_t>(entry.names + header.symbolBytes - name));
+        if (table.intern(std::string_view(name, length)) != symbol) return false;
+        name += length + 1;
+    }
+
+    ast.clear();
+    ast.statementNodes.resize(header.statements);
+    for (std::uint32_t i = 0; i < header.statements; i++) {
+        ast.statementNodes[i] = reinterpret_cast<Statements*>(const_cast<char*>(entry.nodes + entry.statementOffsets[i]));
+    }
+    ast.expressionNodes.resize(header.expressions);
+    for (std::uint32_t i = 0; i < header.expressions; i++) {
+        ast.expressionNodes[i] = reinterpret_cast<Expressions*>(const_cast<char*>(entry.nodes + entry.expressionOffsets[i]));
+    }
+    ast.statementLists.assign(entry.statementLists, entry.statementLists + header.statementLists);
+    ast.expressionLists.assign(entry.expressionLists, entry.expressionLists + header.expressionLists);
+    ast.elifLists.assign(entry.elifLists, entry.elifLists + header.elifLists);
+    ast.textPool.assign(entry.text, header.textBytes);
+    ast.strings.assign(entry.strings, entry.strings + header.strings);
+    ast.indexStrings();
+    ast.image = file;
+
+    // Entries are evicted by age; a hit makes this one the youngest
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+    program = header.program;
+    return true;
+}
+
+void ProgramCache::store(const std::string& source, int optimize, const Ast& ast, NodeList program) {
+    namespace fs = std::filesystem;
+    if (directory.empty()) return;
+
+    // Nodes, copied byte for byte
+    std::string nodes;
+    std::vector<std::uint32_t> statementOffsets, expressionOffsets;
+    auto copyNode = [&](const auto& node) {
+        using Node = std::decay_t<decltype(node)>;
+        static_assert(std::is_trivially_copyable<Node>::value, "cached nodes are copied byte for byte");
+        std::size_t offset = aligned(nodes.size(), alignof(Node));
+        nodes.resize(offset + sizeof(Node));
+        std::memcpy(&nodes[offset], &node, sizeof(Node));
+        return static_cast<std::uint32_t>(offset);
+    };
+    for (const Statements* stmt : ast.statementNodes) {
+        statementOffsets.push_back(visit(stmt, copyNode));
+    }
+    for (const Expressions* expr : ast.expressionNodes) {
+        expressionOffsets.push_back(visit(expr, copyNode));
+    }
+    if (nodes.size() > UINT32_MAX) return;   // offsets are 32 bits
+
+    std::string names;
+    SymbolTable& table = SymbolTable::global();
+    std::uint32_t symbols = static_cast<std::uint32_t>(table.size() - 1);
+    for (Symbol symbol = 1; symbol <= symbols; symbol++) {
+        names += table.name(symbol);
+        names += '\0';
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+    header.key = entryKey(source, optimize);
+    header.sourceSize = source.size();
+    header.program = program;
+    header.nodeBytes = nodes.size();
+    header.statements = static_cast<std::uint32_t>(statementOffsets.size());
+    header.expressions = static_cast<std::uint32_t>(expressionOffsets.size());
+    header.statementLists = static_cast<std::uint32_t>(ast.statementLists.size());
+    header.expressionLists = static_cast<std::uint32_t>(ast.expressionLists.size());
+    header.elifLists = static_cast<std::uint32_t>(ast.elifLists.size());
+    header.textBytes = ast.textPool.size();
+    header.strings = static_cast<std::uint32_t>(ast.strings.size());
+    header.symbols = symbols;
+    header.symbolBytes = names.size();
+
+    std::string image;
+    auto append = [&](const void* data, std::size_t size) {
+        image.append(static_cast<const char*>(data), size);
+        image.resize(aligned(image.size()), '\0');
+    };
+    append(&header, sizeof header);
+    append(nodes.data(), nodes.size());
+    append(statementOffsets.data(), statementOffsets.size() * sizeof(std::uint32_t));
+    append(expressionOffsets.data(), expressionOffsets.size() * sizeof(std::uint32_t));
+    append(ast.statementLists.data(), ast.statementLists.size() * sizeof(NodeId));
+    append(ast.expressionLists.data(), ast.expressionLists.size() * sizeof(NodeId));
+    append(ast.elifLists.data(), ast.elifLists.size() * sizeof(ElifBranch));
+    append(ast.textPool.data(), ast.textPool.size());
+    append(ast.strings.data(), ast.strings.size() * sizeof(TextRef));
+    append(names.data(), names.size());
+    append(source.data(), source.size());
+    if (image.size() > capacity / 2) return;   // would crowd out everything else
+    std::size_t sections = aligned(sizeof header);
+    header.checksum = checksum(header, image.data() + sections, image.size() - sections);
+    std::memcpy(&image[0], &header, sizeof header);
+
+    // Written under a temporary name and renamed, so a run that starts
+    // meanwhile never maps half an entry
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    std::string path = entryPath(header.key);
+    std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        if (!out.write(image.data(), static_cast<std::streamsize>(image.size()))) {
+            out.close();
+            fs::remove(temporary, ec);
+            return;
+        }
+    }
+    fs::rename(temporary, path, ec);
+    if (ec) fs::remove(temporary, ec);
+    evict();
+}
+
+void ProgramCache::evict() const {
+    namespace fs = std::filesystem;
+    struct Kept {
+        fs::path path;
+        fs::file_time_type used;
+        std::uintmax_t size;
+    };
+    std::vector<Kept> entries;
+    std::uintmax_t total = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".pnco") continue;
+        Kept entry{it->path(), it->last_write_time(ec), it->file_size(ec)};
+        if (ec) continue;   // removed meanwhile by another run
+        total += entry.size;
+        entries.push_back(std::move(entry));
+    }
+    if (total <= capacity) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Kept& a, const Kept& b) { return a.used < b.used; });
+    for (const Kept& entry : entries) {
+        if (total <= capacity) break;
+        if (fs::remove(entry.path, ec)) total -= entry.size;
+    }
+}
@@ -0,0 +1,257 @@
+#include "./headers/scanner.h"
+#include "./headers/lexertables.h"
+
+#if !defined(PANCAKE_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define PANCAKE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define PANCAKE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+
+    using scan::Kernels;
+
+    inline int countTrailingZeros(unsigned mask) {
+    #if defined(__GNUC__)
+        return __builtin_ctz(mask);
+    #else
+        int n = 0;
+        while (!(mask & 1u)) { mask >>= 1; n++; }
+        return n;
+    #endif
+    }
+
+    // ---- scalar ----
+
+    std::size_t findByteScalar(const char* data, std::size_t pos, std::size_t size, char c, bool* nonAscii) {
+        bool high = false;
+        while (pos < size && data[pos] != c) {
+            high |= static_cast<unsigned char>(data[pos]) >= 0x80;
+            pos++;
+        }
+        if (nonAscii) *nonAscii |= high;
+        return pos;
+    }
+
+    std::size_t skipSpacesScalar(const char* data, std::size_t pos, std::size_t size) {
+        while (pos < size && lexer::is(data[pos], lexer::CC_SPACE)) pos++;
+        return pos;
+    }
+
+    void lineStartsFrom(const char* data, std::size_t pos, std::size_t size, std::vector<std::uint32_t>& out) {
+        for (; pos < size; pos++) {
+            if (data[pos] == '\n') out.push_back(static_cast<std::uint32_t>(pos + 1));
+        }
+    }
+
+    void lineStartsScalar(const char* data, std::size_t size, std::vector<std::uint32_t>& out) {
+        lineStartsFrom(data, 0, size, out);
+    }
+
+#ifdef PANCAKE_SSE2
+
+    // ---- SSE2, 16 bytes per step ----
+
+    std::size_t findByteSse2(const char* data, std::size_t pos, std::size_t size, char c, bool* nonAscii) {
+        const __m128i needle = _mm_set1_epi8(c);
+        bool high = false;
+        while (pos + 16 <= size) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            unsigned hit = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+            unsigned top = static_cast<unsigned>(_mm_movemask_epi8(block));
+            if (hit) {
+                unsigned before = hit & (0u - hit);   // lowest hit bit
+                high |= (top & (before - 1)) != 0;
+                if (nonAscii) *nonAscii |= high;
+                return pos + countTrailingZeros(hit);
+            }
+            high |= top != 0;
+            pos += 16;
+        }
+        if (nonAscii) *nonAscii |= high;
+        return findByteScalar(data, pos, size, c, nonAscii);
+    }
+
+    inline unsigned blankMaskSse2(__m128i block) {
+        __m128i m = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(block, _mm_set1_epi8('\r')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(block, _mm_set1_epi8('\v')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(block, _mm_set1_epi8('\f')));
+        return static_cast<unsigned>(_mm_movemask_epi8(m));
+    }
+
+    std::size_t skipSpacesSse2(const char* data, std::size_t pos, std::size_t size) {
+        // Most runs are a single space, so check one byte before going wide
+        if (pos >= size || !lexer::is(data[pos], lexer::CC_SPACE)) return pos;
+        while (pos + 16 <= size) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            unsigned other = ~blankMaskSse2(block) & 0xFFFFu;
+            if (other) return pos + countTrailingZeros(other);
+            pos += 16;
+        }
+        return skipSpacesScalar(data, pos, size);
+    }
+
+    void lineStartsSse2(const char* data, std::size_t size, std::vector<std::uint32_t>& out) {
+        const __m128i newline = _mm_set1_epi8('\n');
+        std::size_t pos = 0;
+        while (pos + 16 <= size) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            unsigned hits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+            while (hits) {
+                out.push_back(static_cast<std::uint32_t>(pos + countTrailingZeros(hits) + 1));
+                hits &= hits - 1;
+            }
+            pos += 16;
+        }
+        lineStartsFrom(data, pos, size, out);
+    }
+
+#endif
+
+#ifdef PANCAKE_AVX2
+
+    // ---- AVX2, 32 bytes per step ----
+
+    __attribute__((target("avx2")))
+    std::size_t findByteAvx2(const char* data, std::size_t pos, std::size_t size, char c, bool* nonAscii) {
+        const __m256i needle = _mm256_set1_epi8(c);
+        bool high = false;
+        while (pos + 32 <= size) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            unsigned hit = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+            unsigned top = static_cast<unsigned>(_mm256_movemask_epi8(block));
+            if (hit) {
+                unsigned before = hit & (0u - hit);
+                high |= (top & (before - 1)) != 0;
+                if (nonAscii) *nonAscii |= high;
+                return pos + countTrailingZeros(hit);
+            }
+            high |= top != 0;
+            pos += 32;
+        }
+        if (nonAscii) *nonAscii |= high;
+        return findByteSse2(data, pos, size, c, nonAscii);
+    }
+
+    __attribute__((target("avx2")))
+    std::size_t skipSpacesAvx2(const char* data, std::size_t pos, std::size_t size) {
+        if (pos >= size || !lexer::is(data[pos], lexer::CC_SPACE)) return pos;
+        while (pos + 32 <= size) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            __m256i m = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\v')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\f')));
+            unsigned other = ~static_cast<unsigned>(_mm256_movemask_epi8(m));
+            if (other) return pos + countTrailingZeros(other);
+            pos += 32;
+        }
+        return skipSpacesSse2(data, pos, size);
+    }
+
+    __attribute__((target("avx2")))
+    void lineStartsAvx2(const char* data, std::size_t size, std::vector<std::uint32_t>& out) {
+        const __m256i newline = _mm256_set1_epi8('\n');
+        std::size_t pos = 0;
+        while (pos + 32 <= size) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            unsigned hits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+            while (hits) {
+                out.push_back(static_cast<std::uint32_t>(pos + countTrailingZeros(hits) + 1));
+                hits &= hits - 1;
+            }
+            pos += 32;
+        }
+        lineStartsFrom(data, pos, size, out);
+    }
+
+#endif
+
+    Kernels selectKernels() {
+    #ifdef PANCAKE_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Kernels{"avx2", findByteAvx2, skipSpacesAvx2, lineStartsAvx2};
+        }
+    #endif
+    #ifdef PANCAKE_SSE2
+        return Kernels{"sse2", findByteSse2, skipSpacesSse2, lineStartsSse2};
+    #else
+        return Kernels{"scalar", findByteScalar, skipSpacesScalar, lineStartsScalar};
+    #endif
+    }
+
+    const Kernels& kernels() {
+        static const Kernels selected = selectKernels();
+        return selected;
+    }
+
+}
+
+namespace scan {
+
+    std::size_t findByte(std::string_view source, std::size_t pos, char c, bool* nonAscii) {
+        if (pos >= source.size()) return source.size();
+        return kernels().findByte(source.data(), pos, source.size(), c, nonAscii);
+    }
+
+    std::size_t skipSpaces(std::string_view source, std::size_t pos) {
+        return kernels().skipSpaces(source.data(), pos, source.size());
+    }
+
+    void findLineStarts(std::string_view source, std::vector<std::uint32_t>& out) {
+        kernels().lineStarts(source.data(), source.size(), out);
+    }
+
+    bool validUtf8(std::string_view text) {
+        std::size_t i = 0;
+        const std::size_t n = text.size();
+        while (i < n) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c < 0x80) { i++; continue; }
+
+            std::size_t len;
+            std::uint32_t cp;
+            if (c >= 0xC2 && c <= 0xDF) { len = 2; cp = c & 0x1F; }
+            else if (c >= 0xE0 && c <= 0xEF) { len = 3; cp = c & 0x0F; }
+            else if (c >= 0xF0 && c <= 0xF4) { len = 4; cp = c & 0x07; }
+            else return false;
+
+            if (i + len > n) return false;
+            for (std::size_t k = 1; k < len; k++) {
+                unsigned char cc = static_cast<unsigned char>(text[i + k]);
+                if ((cc & 0xC0) != 0x80) return false;
+                cp = (cp << 6) | (cc & 0x3F);
+            }
+            if (len == 3 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) return false;
+            if (len == 4 && (cp < 0x10000 || cp > 0x10FFFF)) return false;
+            i += len;
+        }
+        return true;
+    }
+
+    const char* kernelName() {
+        return kernels().name;
+    }
+
+    std::vector<Kernels> kernelSets() {
+        std::vector<Kernels> sets{Kernels{"scalar", findByteScalar, skipSpacesScalar, lineStartsScalar}};
+    #ifdef PANCAKE_SSE2
+        sets.push_back(Kernels{"sse2", findByteSse2, skipSpacesSse2, lineStartsSse2});
+    #endif
+    #ifdef PANCAKE_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            sets.push_back(Kernels{"avx2", findByteAvx2, skipSpacesAvx2, lineStartsAvx2});
+        }
+    #endif
+        return sets;
+    }
+
+}
@@ -0,0 +1,73 @@
+#include "./headers/sourcestream.h"
+#include "./headers/tokeniser.h"
+#include <algorithm>
+
+SourceStream::SourceStream(std::istream& in, std::size_t blockSize)
+    : in(in), blockSize(std::max<std::size_t>(blockSize, 1)) {}
+
+void SourceStream::fill(std::size_t bytes) {
+    std::size_t old = buffer.size();
+    buffer.resize(old + bytes);
+    in.read(&buffer[old], static_cast<std::streamsize>(bytes));
+    buffer.resize(old + static_cast<std::size_t>(in.gcount()));
+    if (!in) eof = true;
+}
+
+bool SourceStream::next() {
+    // Drop the chunk handed out last time
+    chunkLine += static_cast<int>(std::count(chunk.begin(), chunk.end(), '\n'));
+    buffer.erase(0, chunk.size());
+    chunk = {};
+    chunkTokens.reset({});
+
+    std::size_t want = blockSize;
+    while (true) {
+        if (!eof && buffer.size() < want) fill(want - buffer.size());
+        if (buffer.empty()) return false;
+
+        // Only lex whole lines: a block may end inside a token or a UTF-8 sequence
+        std::size_t end = buffer.size();
+        if (!eof) {
+            std::size_t newline = buffer.rfind('\n');
+            if (newline == std::string::npos) {
+                want = buffer.size() * 2;
+                continue;
+            }
+            end = newline + 1;
+        }
+
+        std::string_view lines(buffer.data(), end);
+        Tokeniser lexer(lines, chunkLine);
+        lexer.tokenize();
+        TokenBuffer tokens = lexer.takeTokens();
+
+        // Cut after the last end of line outside braces; a statement never
+        // continues past it. At end of input everything left is one chunk.
+        std::size_t cut = 0;
+        std::size_t eofToken = tokens.size() - 1;
+        if (eof) {
+            cut = eofToken;
+        } else {
+            int depth = 0;
+            for (std::size_t i = 0; i < eofToken; i++) {
+                TokenType type = tokens.type(i);
+                if (type == TokenType::LBRACE) depth++;
+                else if (type == TokenType::RBRACE) depth--;
+                else if (type == TokenType::END_OF_LINE && depth <= 0) cut = i + 1;
+            }
+            if (cut == 0) {
+                // One statement (an `if` block) is longer than the buffer
+                want = buffer.size() * 2;
+                continue;
+            }
+        }
+
+        std::size_t bytes = cut == eofToken ? end : tokens[cut - 1].offset + 1;
+        chunk = std::string_view(buffer.data(), bytes);
+        tokens.truncate(cut);
+        tokens.push(TokenType::END_OF_FILE, static_cast<std::uint32_t>(bytes), 0);
+        tokens.rebind(chunk);
+        chunkTokens = std::move(tokens);
+        return true;
+    }
+}
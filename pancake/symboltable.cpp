@@ -0,0 +1,38 @@
+#include "./headers/symboltable.h"
+#include <mutex>
+
+SymbolTable& SymbolTable::global() {
+    static SymbolTable table;
+    return table;
+}
+
+SymbolTable::SymbolTable() {
+    names.emplace_back();   // NO_SYMBOL
+}
+
+Symbol SymbolTable::intern(std::string_view name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(name);   // another thread may have added it meanwhile
+    if (it != ids.end()) return it->second;
+
+    Symbol symbol = static_cast<Symbol>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), symbol);
+    return symbol;
+}
+
+const std::string& SymbolTable::name(Symbol symbol) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names[symbol];
+}
+
+std::size_t SymbolTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+}
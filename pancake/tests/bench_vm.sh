@@ -0,0 +1,64 @@
+#!/bin/sh
+# Times the bytecode VM against the tree walker on generated scripts, so
+# the numbers quoted for --vm can be reproduced.
+#
+#   sh tests/bench_vm.sh [pancake binary]
+#
+# Without a binary one is built with $CXX (default c++) at -O2. Scripts of
+# 50k and 200k statements are generated with a fixed seed: arithmetic on a
+# few int and double variables, if/elif/else chains on them, and output of
+# their values. Each is run RUNS times per mode without the program cache
+# and the fastest wall time is printed, in milliseconds.
+
+here=$(cd "$(dirname "$0")" && pwd)
+src=$(dirname "$here")
+work=${TMPDIR:-/tmp}/pancake-bench
+RUNS=${RUNS:-5}
+mkdir -p "$work" || exit 1
+
+pancake=$1
+if [ -z "$pancake" ]; then
+    pancake=$work/pancake
+    ${CXX:-c++} -std=c++17 -O2 -pthread -o "$pancake" "$src"/*.cpp || exit 1
+fi
+
+# A script of $1 statements. Values stay small, so nothing overflows.
+generate() {
+    awk -v n="$1" 'BEGIN {
+        srand(14);
+        for (i = 0; i < 8; i++) printf "let int v%d = %d;\nlet double d%d = %d.5;\n", i, i + 1, i, i;
+        for (s = 0; s < n; s++) {
+            a = int(rand() * 8); b = int(rand() * 8); c = int(rand() * 100) + 1;
+            k = s % 4;
+            if (k == 0) printf "v%d = (v%d + %d) / 2 - v%d / 3;\n", a, b, c, a;
+            else if (k == 1) printf "d%d = d%d * 0.5 + v%d * 1.25 - %d.0;\n", a, b, a, c;
+            else if (k == 2) printf "if (v%d > v%d) { v%d = v%d - %d; } elif (d%d < %d.0) { d%d = d%d + 1.0; } else { v%d = %d; }\n", a, b, a, a, c, b, c, b, b, a, c;
+            else printf "out > v%d + v%d * 2 > \" \" > d%d;\n", a, b, a;
+        }
+    }'
+}
+
+# Fastest of RUNS runs of the script with the given options, in ms
+best() {
+    fastest=
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(date +%s%N)
+        "$pancake" --no-cache "$@" > /dev/null 2>&1 < /dev/null
+        end=$(date +%s%N)
+        ms=$(( (end - start) / 1000000 ))
+        if [ -z "$fastest" ] || [ $ms -lt $fastest ]; then fastest=$ms; fi
+        i=$((i + 1))
+    done
+    echo "$fastest"
+}
+
+echo "machine: $(uname -m), compiler: $(${CXX:-c++} --version | head -n 1)"
+printf '%-12s %-5s %10s %10s\n' statements level "tree (ms)" "vm (ms)"
+for statements in 50000 200000; do
+    script=$work/bench_$statements.pnc
+    generate $statements > "$script"
+    for level in -O0 -O1; do
+        printf '%-12s %-5s %10s %10s\n' $statements $level "$(best $level "$script")" "$(best $level --vm "$script")"
+    done
+done
@@ -0,0 +1,267 @@
+// Checks that Document::applyEdit and Document::setText keep a document
+// as a fresh parse of its text would be. Random inserts, deletes and
+// replacements are applied to scripts with multi-line strings, comments,
+// CRLF line ends and if/elif/else blocks, many of them aimed inside those.
+// After every edit the tokens, the diagnostics and, when there are none,
+// the output of running the statements must be those of a new Document
+// built from the same text. Edits that leave errors are mostly undone by
+// the next ones, so many of the edits are made to a script that runs.
+//
+// Hundreds of edits per document also make it compact its tree now and
+// then, so statements copied by compact() are run too.
+
+#include "../headers/document.h"
+#include "../headers/interpreter.h"
+#include "../headers/output.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const int SEEDS = 12;
+static const int EDITS = 600;
+
+// Pieces of script that edits insert, whole or in part
+static const char* const SNIPPETS[] = {
+    "let int a = 4;\n",
+    "let double d = a * 1.5;\n",
+    "let string s = \"two\nlines\";\n",
+    "out > a / (b - 2);\n",
+    "out > s + \"!\";\r\n",
+    "b = b + 1;\n",
+    "if (a > b) {\n    out > \"bigger\";\n}\n",
+    " elif (b == 3) { out > b; }",
+    " else {\n    let int inner = 2;\n    out > inner * a;\n}\n",
+    "// comment with \"a quote\n",
+    "\"",
+    "//",
+    "\r\n",
+    "\n",
+    "{",
+    "}",
+    ";",
+    "let int b = 7;\n",
+    "a",
+    "1",
+    " ",
+};
+
+// A script of `lines` statements that runs without errors
+static std::string generate(std::mt19937& random, int lines) {
+    std::string text = "let int a = 3;\nlet int b = 5;\nlet string s = \"x\";\n";
+    for (int i = 0; i < lines; i++) {
+        std::string end = random() % 4 == 0 ? "\r\n" : "\n";
+        std::string n = std::to_string(random() % 9 + 1);
+        switch (random() % 8) {
+            case 0: text += "let int v" + std::to_string(i) + " = a * " + n + " - b;" + end; break;
+            case 1: text += "a = a + " + n + ";" + end; break;
+            case 2: text += "out > a * b - " + n + ";" + end; break;
+            case 3: text += "out > \"text " + n + end + "more // not a comment\";" + end; break;
+            case 4: text += "// a comment \"" + n + end; break;
+            case 5:
+                text += "if (a > b) {" + end + "    out > a;" + end + "} elif (b > " + n + ") {" + end +
+                        "    let int w = b;" + end + "    out > w + " + n + ";" + end + "} else {" + end +
+                        "    out > \"neither\";" + end + "}" + end;
+                break;
+            case 6: text += "s = s + \"" + n + "\";" + end + "out > s;" + end; break;
+            default: text += "out > a / (b - " + n + ");" + end; break;
+        }
+    }
+    return text;
+}
+
+// Offsets edits aim at: inside strings and comments, between \r and \n,
+// and inside if blocks
+static std::vector<std::size_t> targets(const std::string& text) {
+    std::vector<std::size_t> result;
+    for (std::size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '"' || c == '\n' || c == '{' || c == '}') result.push_back(i + 1);
+        if (c == '/' && i + 1 < text.size() && text[i + 1] == '/') result.push_back(i + 2);
+        if (c == '\r') result.push_back(i + 1);
+        if (text.compare(i, 3, "if ") == 0) result.push_back(i + 2);
+    }
+    return result;
+}
+
+// Statements a script stays valid with, inserted at line starts
+static const char* const STATEMENTS[] = {
+    "out > a * 2;\n",
+    "a = a - 1;\r\n",
+    "out > \"in\nserted\";\n",
+    "// note \"\n",
+    "if (b > a) { out > b; } else { out > a; }\n",
+    "if (a == 1) {\n    out > 1;\n} elif (a == 2) {\n    out > 2;\n}\n",
+    "\r\n",
+};
+
+static TextEdit randomEdit(std::mt19937& random, const std::string& text) {
+    TextEdit edit;
+    if (random() % 3 == 0) {
+        // A statement at the start of a line, or a digit changed
+        std::size_t at = text.empty() ? 0 : random() % text.size();
+        if (random() % 2 == 0) {
+            std::size_t digit = text.find_first_of("0123456789", at);
+            if (digit != std::string::npos) {
+                edit.offset = digit;
+                edit.removed = 1;
+                edit.inserted = std::string(1, static_cast<char>('0' + random() % 10));
+                return edit;
+            }
+        }
+        std::size_t line = text.rfind('\n', at);
+        edit.offset = line == std::string::npos ? 0 : line + 1;
+        edit.inserted = STATEMENTS[random() % (sizeof(STATEMENTS) / sizeof(STATEMENTS[0]))];
+        return edit;
+    }
+
+    std::vector<std::size_t> aims = targets(text);
+    if (!aims.empty() && random() % 2 == 0) {
+        edit.offset = std::min(aims[random() % aims.size()], text.size());
+    } else {
+        edit.offset = text.empty() ? 0 : random() % (text.size() + 1);
+    }
+    std::size_t left = text.size() - edit.offset;
+    switch (random() % 4) {
+        case 0: edit.removed = 0; break;
+        case 1: edit.removed = std::min<std::size_t>(left, random() % 3); break;
+        case 2: edit.removed = std::min<std::size_t>(left, random() % 40); break;
+        default: edit.removed = std::min<std::size_t>(left, 1); break;
+    }
+    if (random() % 5 != 0) {
+        std::string snippet = SNIPPETS[random() % (sizeof(SNIPPETS) / sizeof(SNIPPETS[0]))];
+        if (random() % 4 == 0) snippet = snippet.substr(0, random() % (snippet.size() + 1));
+        edit.inserted = snippet;
+    } else if (!text.empty()) {
+        // A piece of the text itself, as a paste
+        std::size_t from = random() % text.size();
+        edit.inserted = text.substr(from, random() % 60);
+    }
+    return edit;
+}
+
+// What running the document's statements writes, its runtime error included
+static std::string run(Document& doc, const std::string& outPath) {
+    Output& out = Output::standard();
+    if (!out.openFile(outPath)) throw std::runtime_error("cannot write " + outPath);
+    Interpreter interpreter;
+    interpreter.setSource(doc.text());
+    std::string error;
+    try {
+        for (NodeId statement : doc.statements()) interpreter.execute(doc.ast(), statement);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    out.flush();
+    std::ifstream file(outPath, std::ios::binary);
+    std::stringstream written;
+    written << file.rdbuf();
+    return written.str() + (error.empty() ? "" : "Error: " + error + "\n");
+}
+
+static std::string tokenDump(const Document& doc) {
+    std::string dump;
+    const TokenBuffer& tokens = doc.tokens();
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        Token t = tokens[i];
+        dump += std::to_string(static_cast<int>(t.type)) + ' ' + std::to_string(t.offset) + ' ' +
+                std::to_string(t.length) + ' ' + std::to_string(t.symbol) + '\n';
+    }
+    return dump;
+}
+
+static std::string diagnosticDump(const Document& doc) {
+    std::string dump;
+    for (const std::string& error : doc.diagnostics()) dump += error + '\n';
+    return dump;
+}
+
+// First line where two dumps differ, for the failure message
+static std::string firstDifference(const std::string& expected, const std::string& got) {
+    std::istringstream a(expected), b(got);
+    std::string x, y;
+    for (int line = 1; ; line++) {
+        bool moreA = static_cast<bool>(std::getline(a, x));
+        bool moreB = static_cast<bool>(std::getline(b, y));
+        if (!moreA && !moreB) return "same";
+        if (!moreA || !moreB || x != y) {
+            return "line " + std::to_string(line) + ": \"" + (moreB ? y : "<end>") + "\", expected \"" +
+                   (moreA ? x : "<end>") + "\"";
+        }
+    }
+}
+
+int main() {
+    namespace fs = std::filesystem;
+    std::string outPath = (fs::temp_directory_path() / "pancake_document_test.out").string();
+    int failures = 0;
+    std::size_t ran = 0, diagnosed = 0;
+
+    for (int seed = 1; seed <= SEEDS && failures == 0; seed++) {
+        std::mt19937 random(static_cast<std::uint32_t>(seed));
+        std::string text = generate(random, 40 + seed * 10);
+        Document doc(text);
+
+        // Edits that undo those made since the script last ran, latest last
+        std::vector<TextEdit> undo;
+        for (int i = 0; i < EDITS; i++) {
+            TextEdit edit;
+            if (!undo.empty() && random() % 5 != 0) {
+                edit = undo.back();
+                undo.pop_back();
+            } else {
+                edit = randomEdit(random, text);
+                undo.push_back(TextEdit{edit.offset, edit.inserted.size(), text.substr(edit.offset, edit.removed)});
+            }
+            text.replace(edit.offset, edit.removed, edit.inserted);
+            // Every third edit goes through setText, as --watch applies them
+            if (i % 3 == 0) doc.setText(text);
+            else doc.applyEdit(edit);
+
+            Document fresh(text);
+            std::string where = "seed " + std::to_string(seed) + ", edit " + std::to_string(i) + " (" +
+                                std::to_string(edit.removed) + " bytes at " + std::to_string(edit.offset) + ")";
+            std::string expected = tokenDump(fresh), got = tokenDump(doc);
+            if (doc.text() != text || got != expected) {
+                std::cerr << where << ": tokens differ, " << firstDifference(expected, got) << "\n";
+                failures++;
+                break;
+            }
+            expected = diagnosticDump(fresh);
+            got = diagnosticDump(doc);
+            if (got != expected) {
+                std::cerr << where << ": diagnostics differ, " << firstDifference(expected, got) << "\n";
+                failures++;
+                break;
+            }
+            if (!expected.empty()) {
+                diagnosed++;
+                continue;
+            }
+            undo.clear();
+            expected = run(fresh, outPath);
+            got = run(doc, outPath);
+            if (got != expected) {
+                std::cerr << where << ": output differs, " << firstDifference(expected, got) << "\n";
+                failures++;
+                break;
+            }
+            ran++;
+        }
+    }
+    std::error_code ignored;
+    fs::remove(outPath, ignored);
+
+    if (failures) {
+        std::cerr << failures << " failed\n";
+        return 1;
+    }
+    std::cout << "document: " << ran << " edited documents ran as fresh ones, " << diagnosed
+              << " gave the same diagnostics\n";
+    return 0;
+}
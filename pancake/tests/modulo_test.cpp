@@ -0,0 +1,177 @@
+// Checks int remainder (Operation::MOD_INT) in every engine. The parser
+// never produces the node, so scripts are parsed with '/' and each int
+// division is turned into a remainder before they run. The tree walker,
+// the tree walker with compiled expressions, the VM and, when there is a
+// C++ compiler, a --compile build must all print the remainder C++ gives,
+// 0 for INT_MIN mod -1, and the same error for a divisor of 0.
+
+#include "../headers/tokeniser.h"
+#include "../headers/parser.h"
+#include "../headers/binexrp.h"
+#include "../headers/interpreter.h"
+#include "../headers/vm.h"
+#include "../headers/jit.h"
+#include "../headers/cppemitter.h"
+#include "../headers/output.h"
+
+#include <climits>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Case {
+    int dividend;
+    int divisor;
+};
+
+static const Case CASES[] = {
+    {7, 3}, {-7, 3}, {7, -3}, {-7, -3}, {0, 5}, {6, 3},
+    {INT_MIN, -1}, {INT_MIN, 1}, {INT_MIN, 7}, {INT_MAX, -1}, {INT_MAX, INT_MIN},
+    {5, 0},
+};
+
+// How a script writes an int: INT_MIN has no literal
+static std::string literal(int value) {
+    return value == INT_MIN ? "0 - 2147483647 - 1" : std::to_string(value);
+}
+
+// The remainder walked (one operator) and compiled (at least
+// Jit::MIN_OPERATORS), each written before its line ends
+static std::string script(const Case& c) {
+    return "let int a = " + literal(c.dividend) + ";\n"
+           "let int b = " + literal(c.divisor) + ";\n"
+           "out > a / b;\n"
+           "out > a / b + (b - b) + (b - b) + (b - b) + (b - b);\n"
+           "out > \"end\";\n";
+}
+
+static std::string expected(const Case& c) {
+    if (c.divisor == 0) return "Error: Runtime Error at line 3, column 9: Modulo by zero\n";
+    std::string value = std::to_string(c.divisor == -1 ? 0 : c.dividend % c.divisor);
+    return value + "\n" + value + "\nend\n";
+}
+
+// Parsed, with every int division made a remainder
+static NodeList parse(const std::string& source, Ast& ast) {
+    TypeChecker checker;
+    Tokeniser lexer(source);
+    lexer.tokenize();
+    Parser parser(lexer.getTokens(), checker, ast);
+    NodeList program = parser.parse();
+    for (NodeId id = 0; id < ast.expressionCount(); id++) {
+        if (auto* binary = nodeCast<BinExpr>(ast.expression(id))) {
+            if (binary->operation == Operation::DIV_INT) {
+                binary->op = BinaryOp::MOD;
+                binary->operation = Operation::MOD_INT;
+            }
+        }
+    }
+    return program;
+}
+
+static std::string readAll(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+enum class Engine { WALK, JIT, VM };
+
+// What the script writes run by `engine`, its runtime error included
+static std::string run(const std::string& source, Engine engine, const std::string& outPath) {
+    Ast ast;
+    NodeList program = parse(source, ast);
+    Output& out = Output::standard();
+    if (!out.openFile(outPath)) throw std::runtime_error("cannot write " + outPath);
+    std::string error;
+    try {
+        if (engine == Engine::VM) {
+            VM vm;
+            vm.setSource(source);
+            vm.execute(ast, program);
+        } else {
+            Interpreter interpreter;
+            interpreter.setJit(engine == Engine::JIT);
+            interpreter.setSource(source);
+            interpreter.execute(ast, program);
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    out.flush();
+    return readAll(outPath) + (error.empty() ? "" : "Error: " + error + "\n");
+}
+
+// Whether the padded remainder is compiled, where there is a code generator
+static bool compiled(const std::string& source) {
+    Ast ast;
+    NodeList program = parse(source, ast);
+    Jit jit;
+    jit.compile(ast, program);
+    for (NodeId id = 0; id < ast.expressionCount(); id++) {
+        if (jit.find(id)) return true;
+    }
+    return false;
+}
+
+int main() {
+    fs::path dir = fs::temp_directory_path();
+    std::string outPath = (dir / "pancake_modulo_test.out").string();
+    std::string exe = (dir / "pancake_modulo_test").string();
+    int failures = 0;
+    bool compiler = true;
+
+    for (const Case& c : CASES) {
+        std::string source = script(c);
+        std::string want = expected(c);
+        std::string name = std::to_string(c.dividend) + " mod " + std::to_string(c.divisor);
+
+        const char* names[] = {"walked", "jit", "vm"};
+        for (Engine engine : {Engine::WALK, Engine::JIT, Engine::VM}) {
+            std::string got = run(source, engine, outPath);
+            if (got != want) {
+                std::cerr << name << ", " << names[static_cast<int>(engine)] << ": \"" << got << "\", expected \""
+                          << want << "\"\n";
+                failures++;
+            }
+        }
+        if (Jit::supported() && !compiled(source)) {
+            std::cerr << name << ": the remainder was not compiled to machine code\n";
+            failures++;
+        }
+
+        if (!compiler) continue;
+        Ast ast;
+        NodeList program = parse(source, ast);
+        if (!CppEmitter::compile(CppEmitter().emit(ast, program, source), exe)) {
+            std::cout << "modulo: no C++ compiler, --compile builds skipped\n";
+            compiler = false;
+            continue;
+        }
+        std::string command = "\"" + exe + "\" > \"" + outPath + "\" 2>&1 < /dev/null";
+        int status = std::system(command.c_str());
+        std::string got = readAll(outPath);
+        if (status != 0 || got != want) {
+            std::cerr << name << ", compiled: \"" << got << "\", expected \"" << want << "\"\n";
+            failures++;
+        }
+    }
+
+    std::error_code ignored;
+    fs::remove(outPath, ignored);
+    fs::remove(exe, ignored);
+
+    if (failures) {
+        std::cerr << failures << " failed\n";
+        return 1;
+    }
+    std::cout << "modulo: every engine gives C++'s remainder\n";
+    return 0;
+}
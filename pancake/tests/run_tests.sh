@@ -0,0 +1,329 @@
+#!/bin/sh
+# Builds and runs pancake's tests. Run from anywhere; binaries go to the
+# directory given, else $TMPDIR/pancake-tests. $CXX picks the compiler.
+#
+# Besides the unit tests, every program in tests/programs (with input from
+# the .in file of the same name, if any) is run by the tree walker and by
+# each other way of running it, at every -O level, and built into an
+# executable with --compile when there is a C++ compiler. Their output,
+# errors included, and exit status must be the same. They are also run
+# from a recording of their input, and through the program cache in a
+# directory of its own under the build directory.
+#
+#   sh tests/run_tests.sh [build directory]
+
+here=$(cd "$(dirname "$0")" && pwd)
+src=$(dirname "$here")
+build=${1:-${TMPDIR:-/tmp}/pancake-tests}
+CXX=${CXX:-c++}
+mkdir -p "$build" || exit 1
+
+# Every source but main.cpp, for the tests that link the pieces directly
+library=
+for f in "$src"/*.cpp; do
+    [ "$(basename "$f")" = main.cpp ] || library="$library $f"
+done
+
+failed=0
+
+echo "== tokeniser"
+if $CXX -std=c++17 -O2 -pthread -o "$build/tokeniser_test" "$here/tokeniser_test.cpp" $library; then
+    "$build/tokeniser_test" || failed=1
+else
+    failed=1
+fi
+
+echo "== scanner"
+if $CXX -std=c++17 -O2 -pthread -o "$build/scanner_test" "$here/scanner_test.cpp" $library; then
+    "$build/scanner_test" || failed=1
+else
+    failed=1
+fi
+
+echo "== document"
+if $CXX -std=c++17 -O2 -pthread -o "$build/document_test" "$here/document_test.cpp" $library; then
+    "$build/document_test" || failed=1
+else
+    failed=1
+fi
+
+echo "== modulo"
+if $CXX -std=c++17 -O2 -pthread -o "$build/modulo_test" "$here/modulo_test.cpp" $library; then
+    CXX=$CXX "$build/modulo_test" || failed=1
+else
+    failed=1
+fi
+
+echo "== pancake"
+$CXX -std=c++17 -O2 -pthread -o "$build/pancake" $library "$src/main.cpp" || exit 1
+
+# Run program $2 with the options after it, its output and exit status
+# going to file $1
+run() {
+    out=$1
+    program=$2
+    shift 2
+    input=/dev/null
+    [ -f "${program%.pnc}.in" ] && input=${program%.pnc}.in
+    "$build/pancake" --no-cache "$@" "$program" < "$input" > "$out" 2>&1
+    echo "exit status $?" >> "$out"
+}
+
+# Compare every program run with options $2 against a run with options $1
+differential() {
+    echo "== $2 against ${1:-the tree walker}"
+    for level in -O0 -O1 -O2; do
+        for program in "$here"/programs/*.pnc; do
+            run "$build/expected.out" "$program" $level $1
+            run "$build/got.out" "$program" $level $2
+            if ! cmp -s "$build/expected.out" "$build/got.out"; then
+                echo "$(basename "$program") $level $2: output differs"
+                diff "$build/expected.out" "$build/got.out" | head -20
+                failed=1
+            fi
+        done
+    done
+}
+
+differential "" --vm
+differential --stream "--stream --vm"
+differential "" --jit
+differential --stream "--stream --jit"
+
+# Each program built with --compile must behave as the tree walker runs it.
+# One that does not build must fail with the interpreter's error, the only
+# output it gives.
+compiled() {
+    echo "== --compile against the tree walker"
+    if ! command -v "$CXX" > /dev/null 2>&1; then
+        echo "skipped: no C++ compiler ($CXX)"
+        return
+    fi
+    for level in -O0 -O1 -O2; do
+        for program in "$here"/programs/*.pnc; do
+            run "$build/expected.out" "$program" $level
+            rm -f "$build/compiled"
+            if CXX=$CXX "$build/pancake" --no-cache $level --compile "$build/compiled" "$program" > "$build/got.out" 2>&1; then
+                input=/dev/null
+                [ -f "${program%.pnc}.in" ] && input=${program%.pnc}.in
+                "$build/compiled" < "$input" > "$build/got.out" 2>&1
+                echo "exit status $?" >> "$build/got.out"
+            else
+                echo "exit status 0" >> "$build/got.out"
+            fi
+            if ! cmp -s "$build/expected.out" "$build/got.out"; then
+                echo "$(basename "$program") $level --compile: output differs"
+                diff "$build/expected.out" "$build/got.out" | head -20
+                failed=1
+            fi
+        done
+    done
+}
+
+compiled
+
+# Input from a pipe must read as from the file; and a program with no `in`
+# statement must leave its stdin unread, for the next program on it
+piped_input() {
+    echo "== input from a pipe"
+    for program in "$here"/programs/*.pnc; do
+        if [ -f "${program%.pnc}.in" ]; then
+            run "$build/expected.out" "$program"
+            { cat "${program%.pnc}.in" | "$build/pancake" --no-cache "$program"; } > "$build/got.out" 2>&1
+            echo "exit status $?" >> "$build/got.out"
+            if ! cmp -s "$build/expected.out" "$build/got.out"; then
+                echo "$(basename "$program") from a pipe: output differs"
+                diff "$build/expected.out" "$build/got.out" | head -20
+                failed=1
+            fi
+        elif ! grep -q '^ *in ' "$program"; then
+            left=$(printf 'first\nsecond\n' | { "$build/pancake" --no-cache "$program" > /dev/null 2>&1; cat; })
+            if [ "$left" != "$(printf 'first\nsecond')" ]; then
+                echo "$(basename "$program"): read stdin with no in statement"
+                failed=1
+            fi
+        fi
+    done
+}
+
+piped_input
+
+# Input recorded with --record-input and replayed with --replay-input must
+# give the run that recorded it, with input cut short too, in every way of
+# running a program. A log that does not fit the script must stop it with
+# the replay's error and exit status 1.
+record_replay() {
+    echo "== recorded input replayed"
+    log=$build/input.log
+    for program in "$here"/programs/*.pnc; do
+        [ -f "${program%.pnc}.in" ] || continue
+        head -n 1 "${program%.pnc}.in" > "$build/first.in"
+        for input in "${program%.pnc}.in" "$build/first.in"; do
+            "$build/pancake" --no-cache --record-input "$log" "$program" < "$input" > "$build/expected.out" 2>&1
+            echo "exit status $?" >> "$build/expected.out"
+            for options in "" --vm --jit --stream "--stream --vm"; do
+                "$build/pancake" --no-cache $options --replay-input "$log" "$program" < /dev/null > "$build/got.out" 2>&1
+                echo "exit status $?" >> "$build/got.out"
+                if ! cmp -s "$build/expected.out" "$build/got.out"; then
+                    echo "$(basename "$program") replayed from $(basename "$input") $options: output differs"
+                    diff "$build/expected.out" "$build/got.out" | head -20
+                    failed=1
+                fi
+            done
+        done
+    done
+
+    # input.pnc reads an int, a double and two strings, at lines 4 to 7
+    program=$here/programs/input.pnc
+    "$build/pancake" --no-cache --record-input "$log" "$program" < "$here/programs/input.in" > /dev/null 2>&1
+    sed '4s/in < n;/in < f;/; 5s/in < f;/in < n;/' "$program" > "$build/reordered.pnc"
+    sed 's/let int n = 0;/let string n = "0";/; s/out > n \* 2;/out > n;/' "$program" > "$build/retyped.pnc"
+    head -c $(($(wc -c < "$log") - 1)) "$log" > "$build/cut.log"
+    # without the last entry, "new thing" at line 7, column 12
+    head -c $(($(wc -c < "$log") - 13)) "$log" > "$build/short.log"
+    mismatch="line 4, column 8: Replayed input does not match: the log has int input for line 4, column 8 next"
+    for options in "" --vm --jit --stream; do
+        for test in "reordered.pnc $log $mismatch" "retyped.pnc $log $mismatch" \
+                    "input.pnc $build/cut.log line 7, column 12: Input log is damaged after 3 values" \
+                    "input.pnc $build/short.log line 7, column 12: Input log ends after 3 values"; do
+            set -- $test
+            name=$1
+            script=$build/$1
+            [ "$1" = input.pnc ] && script=$program
+            replayed=$2
+            shift 2
+            "$build/pancake" --no-cache $options --replay-input "$replayed" "$script" < /dev/null > "$build/got.out" 2>&1
+            status=$?
+            if [ $status -ne 1 ] || ! grep -q "^Error: Runtime Error at $*\$" "$build/got.out"; then
+                echo "$name replaying $(basename "$replayed") $options: exit status $status, expected 1 and \"$*\""
+                cat "$build/got.out"
+                failed=1
+            fi
+        done
+    done
+}
+
+record_replay
+
+# Run program $2 with the program cache in directory $1, output as run() has it
+cached_run() {
+    out=$1
+    program=$2
+    shift 2
+    input=/dev/null
+    [ -f "${program%.pnc}.in" ] && input=${program%.pnc}.in
+    PANCAKE_CACHE_DIR=$cache "$build/pancake" "$@" "$program" < "$input" > "$out" 2>&1
+    echo "exit status $?" >> "$out"
+}
+
+# Invert the bits of byte $2 of file $1
+flip() {
+    byte=$(dd if="$1" bs=1 skip="$2" count=1 2> /dev/null | od -An -tu1 | tr -d ' ')
+    printf "\\$(printf %o $((byte ^ 255)))" | dd of="$1" bs=1 seek="$2" conv=notrunc 2> /dev/null
+}
+
+inode() {
+    ls -i "$1" | awk '{print $1}'
+}
+
+# Fail with message $1 unless the cached run's output is what --no-cache gave
+check_cached() {
+    if ! cmp -s "$build/expected.out" "$build/got.out"; then
+        echo "$1: output differs"
+        diff "$build/expected.out" "$build/got.out" | head -20
+        failed=1
+    fi
+}
+
+# Cached runs must print what uncached ones do: the first run, which writes
+# the entry; the second, which maps it (the file is only touched, not
+# rewritten); and runs after the entry was truncated, had bytes flipped or
+# was swapped for another script's entry, all of which must be rejected
+# and written again.
+program_cache() {
+    echo "== program cache"
+    cache=$build/cache
+    for level in -O0 -O2; do
+        for program in "$here"/programs/*.pnc; do
+            name="$(basename "$program") $level"
+            rm -rf "$cache"
+            run "$build/expected.out" "$program" $level
+            cached_run "$build/got.out" "$program" $level
+            check_cached "$name, first run"
+            set -- "$cache"/*.pnco
+            entry=$1
+            [ -f "$entry" ] || continue   # did not compile
+            cp "$entry" "$build/good.pnco"
+            before=$(inode "$entry")
+
+            cached_run "$build/got.out" "$program" $level
+            check_cached "$name, from the cache"
+            if [ "$(inode "$entry")" != "$before" ]; then
+                echo "$name: the cached entry was not used"
+                failed=1
+            fi
+
+            size=$(wc -c < "$entry")
+            head -c $((size / 2)) "$build/good.pnco" > "$entry"
+            cached_run "$build/got.out" "$program" $level
+            check_cached "$name, truncated entry"
+            # Node padding is copied as it is, so a written entry may not be
+            # the same bytes; one written again is a new file
+            for at in 0 8 20 $((size / 3)) $((size / 2)) $((size - 1)); do
+                cp "$build/good.pnco" "$entry"
+                flip "$entry" $at
+                before=$(inode "$entry")
+                cached_run "$build/got.out" "$program" $level
+                check_cached "$name, byte $at flipped"
+                if [ "$(inode "$entry")" = "$before" ]; then
+                    echo "$name: the entry with byte $at flipped was not written again"
+                    failed=1
+                fi
+            done
+        done
+    done
+
+    # An edit that keeps the length makes another entry, and an entry under
+    # the other script's name is not taken for it
+    program=$build/edited.pnc
+    rm -rf "$cache"
+    cp "$here/programs/basics.pnc" "$program"
+    cached_run "$build/got.out" "$program"
+    set -- "$cache"/*.pnco
+    original=$1
+    sed 's/let int x = 5;/let int x = 6;/' "$here/programs/basics.pnc" > "$program"
+    run "$build/expected.out" "$program"
+    cached_run "$build/got.out" "$program"
+    check_cached "basics.pnc edited"
+    set -- "$cache"/*.pnco
+    if [ $# -ne 2 ]; then
+        echo "basics.pnc edited: $# cache entries, expected 2"
+        failed=1
+    else
+        edited=$1
+        [ "$edited" = "$original" ] && edited=$2
+        cp "$original" "$edited"
+        cached_run "$build/got.out" "$program"
+        check_cached "basics.pnc edited, with the original's entry"
+    fi
+
+    # Entries beyond the limit go, the least recently used first
+    rm -rf "$cache"
+    for program in "$here"/programs/*.pnc; do
+        PANCAKE_CACHE_LIMIT=64 cached_run "$build/got.out" "$program"
+    done
+    set -- "$cache"/*.pnco
+    total=$(cat "$@" | wc -c)
+    if [ "$total" -gt 65536 ] || [ $# -lt 2 ]; then
+        echo "cache limit: $# entries of $total bytes kept, the limit is 65536"
+        failed=1
+    fi
+}
+
+program_cache
+
+if [ $failed -ne 0 ]; then
+    echo "FAILED"
+    exit 1
+fi
+echo "all passed"
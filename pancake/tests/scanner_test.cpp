@@ -0,0 +1,267 @@
+// Checks the SSE2 and AVX2 kernels in scanner.cpp against the scalar ones,
+// and scan::validUtf8 against a decoder written from the table of well
+// formed byte sequences in the Unicode standard.
+//
+// The kernels see buffers of every length from 0 to 64 and some longer
+// ones: random bytes drawn from the ones they look for, the needle (or the
+// end of a blank run) at each lane position, with bytes >= 0x80 just before
+// and after it. Each buffer lies at every alignment inside a larger one
+// whose bytes past the end are needles, so a kernel that reads too far
+// gives a different answer. validUtf8 gets every sequence of up to three
+// bytes, four byte ones led by every byte, every code point encoded in
+// each length, and all of those truncated and between ASCII.
+
+#include "../headers/scanner.h"
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static const std::size_t LONGEST = 64;
+
+// Bytes the kernels treat differently
+static const char ALPHABET[] = {' ', '\t', '\r', '\v', '\f', '\n', '"', 'a', '\0',
+                                '\x80', '\xBF', '\xC3', '\xFF', '\x7F'};
+
+class Checker {
+public:
+    explicit Checker(std::vector<scan::Kernels> sets) : sets(std::move(sets)) {}
+
+    int failures = 0;
+    std::size_t checks = 0;
+
+    // Every kernel on `text`, placed at each alignment in front of bytes
+    // that would change the answer if they were read
+    void check(const std::string& text) {
+        for (std::size_t align : {0, 1, 3, 8, 15, 31}) {
+            std::string backing(align, 'a');
+            backing += text;
+            for (int i = 0; i < 32; i++) backing += "\x80\n\"";
+            const char* data = backing.data() + align;
+            std::size_t size = text.size();
+            const scan::Kernels& scalar = sets.front();
+
+            for (std::size_t k = 1; k < sets.size(); k++) {
+                const scan::Kernels& wide = sets[k];
+                for (std::size_t pos = 0; pos <= size; pos++) {
+                    for (char needle : {'\n', '"'}) {
+                        for (bool before : {false, true}) {
+                            bool want = before, got = before;
+                            std::size_t a = scalar.findByte(data, pos, size, needle, &want);
+                            std::size_t b = wide.findByte(data, pos, size, needle, &got);
+                            if (a != b || want != got) {
+                                fail(wide, "findByte", text, align, pos,
+                                     std::to_string(b) + (got ? " non-ASCII" : "") + ", expected " +
+                                     std::to_string(a) + (want ? " non-ASCII" : ""));
+                            }
+                        }
+                        if (scalar.findByte(data, pos, size, needle, nullptr) !=
+                            wide.findByte(data, pos, size, needle, nullptr)) {
+                            fail(wide, "findByte without nonAscii", text, align, pos, "differs");
+                        }
+                    }
+                    std::size_t a = scalar.skipSpaces(data, pos, size);
+                    std::size_t b = wide.skipSpaces(data, pos, size);
+                    if (a != b) {
+                        fail(wide, "skipSpaces", text, align, pos,
+                             std::to_string(b) + ", expected " + std::to_string(a));
+                    }
+                }
+                std::vector<std::uint32_t> want{0}, got{0};
+                scalar.lineStarts(data, size, want);
+                wide.lineStarts(data, size, got);
+                if (want != got) fail(wide, "lineStarts", text, align, 0, "differs");
+                checks++;
+            }
+        }
+    }
+
+    // The scalar kernels against the plain definitions
+    void checkScalar(const std::string& text) {
+        const scan::Kernels& scalar = sets.front();
+        std::vector<std::uint32_t> want, got;
+        for (std::size_t pos = 0; pos <= text.size(); pos++) {
+            std::size_t end = text.find('\n', pos);
+            if (end == std::string::npos) end = text.size();
+            bool high = false, wantHigh = false;
+            for (std::size_t i = pos; i < end; i++) wantHigh |= static_cast<unsigned char>(text[i]) >= 0x80;
+            if (scalar.findByte(text.data(), pos, text.size(), '\n', &high) != end || high != wantHigh) {
+                fail(scalar, "findByte", text, 0, pos, "is not the first newline");
+            }
+            std::size_t blank = pos;
+            while (blank < text.size() && std::string(" \t\v\f\r").find(text[blank]) != std::string::npos) blank++;
+            if (scalar.skipSpaces(text.data(), pos, text.size()) != blank) {
+                fail(scalar, "skipSpaces", text, 0, pos, "is not the first non-blank");
+            }
+            if (pos < text.size() && text[pos] == '\n') want.push_back(static_cast<std::uint32_t>(pos + 1));
+        }
+        scalar.lineStarts(text.data(), text.size(), got);
+        if (want != got) fail(scalar, "lineStarts", text, 0, 0, "misses a line");
+    }
+
+private:
+    std::vector<scan::Kernels> sets;
+
+    void fail(const scan::Kernels& kernels, const char* what, const std::string& text, std::size_t align,
+              std::size_t pos, const std::string& detail) {
+        if (++failures > 10) return;
+        std::cerr << kernels.name << ' ' << what << " from " << pos << " at alignment " << align << " of "
+                  << text.size() << " bytes \"";
+        for (char c : text) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (u >= 0x20 && u < 0x7F && c != '\\') std::cerr << c;
+            else std::cerr << "\\x" << "0123456789ABCDEF"[u >> 4] << "0123456789ABCDEF"[u & 15];
+        }
+        std::cerr << "\": " << detail << "\n";
+    }
+};
+
+// Whether `text` is well formed UTF-8, by Table 3-7 of the Unicode standard
+static bool wellFormed(const std::string& text) {
+    auto in = [](unsigned char c, unsigned lo, unsigned hi) { return c >= lo && c <= hi; };
+    std::size_t i = 0;
+    while (i < text.size()) {
+        unsigned char b0 = static_cast<unsigned char>(text[i]);
+        if (b0 <= 0x7F) { i++; continue; }
+        std::size_t left = text.size() - i;
+        auto at = [&](std::size_t k) { return static_cast<unsigned char>(text[i + k]); };
+        unsigned lo = 0x80, hi = 0xBF;
+        std::size_t len;
+        if (in(b0, 0xC2, 0xDF)) len = 2;
+        else if (b0 == 0xE0) { len = 3; lo = 0xA0; }
+        else if (in(b0, 0xE1, 0xEC) || in(b0, 0xEE, 0xEF)) len = 3;
+        else if (b0 == 0xED) { len = 3; hi = 0x9F; }
+        else if (b0 == 0xF0) { len = 4; lo = 0x90; }
+        else if (in(b0, 0xF1, 0xF3)) len = 4;
+        else if (b0 == 0xF4) { len = 4; hi = 0x8F; }
+        else return false;
+        if (left < len || !in(at(1), lo, hi)) return false;
+        for (std::size_t k = 2; k < len; k++) {
+            if (!in(at(k), 0x80, 0xBF)) return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+// `cp` written in `len` bytes, overlong if that is more than it needs
+static std::string encode(std::uint32_t cp, int len) {
+    if (len == 1) return std::string(1, static_cast<char>(cp));
+    static const unsigned lead[] = {0, 0, 0xC0, 0xE0, 0xF0};
+    std::string bytes(len, '\0');
+    for (int k = len - 1; k > 0; k--) {
+        bytes[k] = static_cast<char>(0x80 | (cp & 0x3F));
+        cp >>= 6;
+    }
+    bytes[0] = static_cast<char>(lead[len] | cp);
+    return bytes;
+}
+
+static int utf8Failures = 0;
+static std::size_t utf8Checks = 0;
+
+static void checkUtf8(const std::string& text) {
+    utf8Checks++;
+    bool want = wellFormed(text);
+    if (scan::validUtf8(text) == want || ++utf8Failures > 10) return;
+    std::cerr << "validUtf8 of";
+    for (char c : text) {
+        std::cerr << ' ' << "0123456789ABCDEF"[static_cast<unsigned char>(c) >> 4]
+                  << "0123456789ABCDEF"[c & 15];
+    }
+    std::cerr << " is " << (want ? "false" : "true") << "\n";
+}
+
+// A sequence alone, cut short, and between ASCII
+static void checkSequence(const std::string& bytes) {
+    checkUtf8(bytes);
+    for (std::size_t cut = 1; cut < bytes.size(); cut++) {
+        checkUtf8(bytes.substr(0, cut));
+        checkUtf8("ab" + bytes.substr(0, cut) + "c");
+    }
+    checkUtf8("x" + bytes + "y");
+    checkUtf8(bytes + bytes);
+}
+
+int main() {
+    std::vector<scan::Kernels> sets = scan::kernelSets();
+    Checker checker(sets);
+    std::mt19937 random(7);
+
+    for (std::size_t length = 0; length <= LONGEST; length++) {
+        // Random bytes from the alphabet
+        for (int round = 0; round < 12; round++) {
+            std::string text;
+            for (std::size_t i = 0; i < length; i++) text += ALPHABET[random() % sizeof(ALPHABET)];
+            checker.check(text);
+            checker.checkScalar(text);
+        }
+        // A needle, or a byte ending a blank run, at each lane, with a high
+        // byte before it, after it or nowhere
+        for (std::size_t at = 0; at < length; at++) {
+            for (char needle : {'\n', '"', 'a'}) {
+                for (int high = 0; high < 3; high++) {
+                    std::string text(length, needle == 'a' ? ' ' : 'a');
+                    text[at] = needle;
+                    if (high == 1 && at > 0) text[at - 1] = '\xE9';
+                    if (high == 2 && at + 1 < length) text[at + 1] = '\xE9';
+                    checker.check(text);
+                }
+            }
+        }
+    }
+    // Longer buffers, so the wide loops go round more than once
+    for (std::size_t length : {95, 96, 97, 127, 128, 129, 200}) {
+        std::string text;
+        for (std::size_t i = 0; i < length; i++) text += ALPHABET[random() % 6];
+        checker.check(text);
+        checker.checkScalar(text);
+    }
+
+    // Every sequence of up to three bytes
+    for (unsigned a = 0; a < 256; a++) {
+        checkUtf8(std::string(1, static_cast<char>(a)));
+        for (unsigned b = 0; b < 256; b++) {
+            std::string two{static_cast<char>(a), static_cast<char>(b)};
+            checkUtf8(two);
+            if (a < 0xE0 || a > 0xEF) continue;
+            for (unsigned c = 0; c < 256; c++) checkUtf8(two + static_cast<char>(c));
+        }
+    }
+    // Four bytes led by every byte, with edge continuation bytes
+    const unsigned edges[] = {0x00, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xFF};
+    for (unsigned a = 0xC0; a < 256; a++) {
+        for (unsigned b = 0; b < 256; b++) {
+            for (unsigned c : edges) {
+                for (unsigned d : edges) {
+                    checkUtf8(std::string{static_cast<char>(a), static_cast<char>(b), static_cast<char>(c),
+                                          static_cast<char>(d)});
+                }
+            }
+        }
+    }
+    // Every code point in every length: the shortest is valid unless it is
+    // a surrogate, longer ones are overlong, and above U+10FFFF nothing is
+    for (std::uint32_t cp = 0; cp < 0x140000; cp += cp < 0x3000 || (cp >= 0xD700 && cp < 0xE100) ||
+                                                     (cp >= 0x10F000 && cp < 0x111000) ? 1 : 61) {
+        for (int len = 1; len <= 4; len++) {
+            if (len == 1 && cp >= 0x80) continue;
+            if (len == 2 && cp >= 0x800) continue;
+            if (len == 3 && cp >= 0x10000) continue;
+            if (cp >= 0x200000) continue;
+            checkSequence(encode(cp, len));
+        }
+    }
+
+    if (checker.failures || utf8Failures) {
+        std::cerr << checker.failures + utf8Failures << " failed\n";
+        return 1;
+    }
+    std::cout << "scanner: ";
+    for (std::size_t k = 1; k < sets.size(); k++) std::cout << sets[k].name << ' ';
+    std::cout << "kernels agreed with scalar on " << checker.checks << " buffers, validUtf8 with the table on "
+              << utf8Checks << " sequences\n";
+    return 0;
+}
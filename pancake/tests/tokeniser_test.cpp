@@ -0,0 +1,159 @@
+// Checks that Tokeniser::tokenizeParallel gives the tokens tokenize gives,
+// token by token, on sources built so that the chunk boundaries fall inside
+// string literals, comments and CRLF pairs.
+//
+// tokenizeParallel splits a source into source.size() / 1 MiB chunks (at
+// most four per worker), each starting at the first newline at or after
+// k * size / chunks. The sources here are exactly SIZE bytes and lexed with
+// enough workers for 8 chunks, so each boundary is the first newline after
+// k MiB, and what lies around it is chosen below.
+
+#include "../headers/tokeniser.h"
+#include "../headers/syntaxerror.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+
+static const std::size_t MIB = 1 << 20;
+static const std::size_t SIZE = 8 * MIB;
+
+// What a boundary falls inside
+enum class Boundary { STRING, COMMENT, CRLF, STRING_THEN_STRAY_BYTES, COUNT };
+
+// Lines of ordinary code, with LF or CRLF endings
+class Filler {
+public:
+    explicit Filler(std::uint32_t seed) : random(seed) {}
+
+    std::string line() {
+        std::string s;
+        switch (random() % 6) {
+            case 0: s = "let int v" + number() + " = " + number() + " * (w" + number() + " + 3.5);"; break;
+            case 1: s = "out > \"text " + number() + " // not a comment\";"; break;
+            case 2: s = "// comment with a \"quote and -> arrows " + number(); break;
+            case 3: s = "if (a" + number() + " >= 2) and (b != 4) { out -> c; } elif d <= 1 { in <- e; }"; break;
+            case 4: s = "let string s = \"two\nlines " + number() + "\";"; break;
+            default: s = "x" + number() + " = y / 7 - 1.25;"; break;
+        }
+        s += random() % 3 == 0 ? "\r\n" : "\n";
+        return s;
+    }
+
+    std::string number() { return std::to_string(random() % 100000); }
+
+private:
+    std::mt19937 random;
+};
+
+// Ordinary code up to `target`, then `construct` placed so that `at` bytes
+// into it lie exactly on the target
+static void placeAt(std::string& source, Filler& filler, std::size_t target,
+                    const std::string& construct, std::size_t at) {
+    while (source.size() + 200 < target - at) source += filler.line();
+    source.append(target - at - source.size(), ' ');
+    source += construct;
+}
+
+// With `invalid`, a string literal with invalid UTF-8 follows the seventh
+// chunk's boundary
+static std::string buildSource(std::uint32_t seed, Boundary first, bool invalid) {
+    Filler filler(seed);
+    std::string source;
+    for (std::size_t k = 1; k < 8; k++) {
+        auto kind = static_cast<Boundary>((static_cast<int>(first) + k) % static_cast<int>(Boundary::COUNT));
+        std::size_t target = k * MIB;
+        switch (kind) {
+            case Boundary::STRING:
+                // A lexer starting at the inner newline sees a comment, an
+                // identifier, and then the closing quote opens a string
+                placeAt(source, filler, target, "out > \"abc\nout > 1; // \"\r\nx\r\n\";\n", 9);
+                break;
+            case Boundary::COMMENT:
+                placeAt(source, filler, target, "// a comment \"across the boundary\nout > 2;\n", 8);
+                break;
+            case Boundary::CRLF:
+                // The split falls between the \r and the \n
+                placeAt(source, filler, target, "let int z = 3;\r\n", 15);
+                break;
+            case Boundary::STRING_THEN_STRAY_BYTES:
+                // Stray bytes outside a string are only unknown tokens. Lexed
+                // from the inner newline, the closing quote opens a string
+                // holding them, an error only a wrong split would raise.
+                placeAt(source, filler, target, "out > \"\nx\n\" \xff\xfe;\n", 6);
+                break;
+            default:
+                break;
+        }
+        if (invalid && k == 6) placeAt(source, filler, target + 4096, "out > \"bad \xc3\x28\";\n", 0);
+    }
+    while (source.size() + 200 < SIZE) source += filler.line();
+    source.append(SIZE - 1 - source.size(), ' ');
+    source += '\n';
+    return source;
+}
+
+// Tokens of `source`, or the error lexing it raised
+struct Result {
+    TokenBuffer tokens;
+    std::string error;
+};
+
+static Result lex(const std::string& source, unsigned workers) {
+    Result result;
+    try {
+        Tokeniser lexer(source);
+        if (workers == 1) lexer.tokenize();
+        else lexer.tokenizeParallel(workers);
+        result.tokens = lexer.takeTokens();
+    } catch (const SyntaxError& e) {
+        result.error = e.what();
+    }
+    return result;
+}
+
+static bool same(const std::string& name, const Result& expected, const Result& got) {
+    if (expected.error != got.error) {
+        std::cerr << name << ": error \"" << got.error << "\", expected \"" << expected.error << "\"\n";
+        return false;
+    }
+    if (expected.tokens.size() != got.tokens.size()) {
+        std::cerr << name << ": " << got.tokens.size() << " tokens, expected " << expected.tokens.size() << "\n";
+    }
+    std::size_t count = std::min(expected.tokens.size(), got.tokens.size());
+    for (std::size_t i = 0; i < count; i++) {
+        Token a = expected.tokens[i], b = got.tokens[i];
+        if (a.type != b.type || a.offset != b.offset || a.length != b.length || a.symbol != b.symbol) {
+            std::cerr << name << ": token " << i << " at offset " << b.offset << " differs from the one at "
+                      << a.offset << "\n";
+            return false;
+        }
+    }
+    return expected.tokens.size() == got.tokens.size();
+}
+
+int main() {
+    int failures = 0;
+    for (std::uint32_t seed = 1; seed <= 8; seed++) {
+        auto first = static_cast<Boundary>(seed % static_cast<int>(Boundary::COUNT));
+        // In the last one a real error late in the file is still the one reported
+        std::string source = buildSource(seed, first, seed == 8);
+        Result expected = lex(source, 1);
+        if (seed == 8 && expected.error.empty()) {
+            std::cerr << "seed 8: the invalid string literal was not reported\n";
+            failures++;
+        }
+        for (unsigned workers : {2u, 4u, 8u}) {
+            std::string name = "seed " + std::to_string(seed) + ", " + std::to_string(workers) + " workers";
+            if (!same(name, expected, lex(source, workers))) failures++;
+        }
+    }
+    if (failures) {
+        std::cerr << failures << " failed\n";
+        return 1;
+    }
+    std::cout << "tokeniser: parallel and sequential tokens agree\n";
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "./headers/tokenbuffer.h"
+#include <algorithm>
+#include <iostream>
+
+TokenBuffer::TokenBuffer(std::string_view source) : src(source) {}
+
+void TokenBuffer::reset(std::string_view source) {
+    src = source;
+    types.clear();
+    offsets.clear();
+    lengths.clear();
+    symbols.clear();
+    lines.reset();
+}
+
+void TokenBuffer::reserve(std::size_t count) {
+    types.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    symbols.reserve(count);
+}
+
+void TokenBuffer::push(TokenType type, std::uint32_t offset, std::uint32_t length, Symbol symbol) {
+    types.push_back(type);
+    offsets.push_back(offset);
+    lengths.push_back(length);
+    symbols.push_back(symbol);
+}
+
+void TokenBuffer::append(const TokenBuffer& other) {
+    types.insert(types.end(), other.types.begin(), other.types.end());
+    offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+    lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+    symbols.insert(symbols.end(), other.symbols.begin(), other.symbols.end());
+}
+
+void TokenBuffer::truncate(std::size_t count) {
+    types.resize(count);
+    offsets.resize(count);
+    lengths.resize(count);
+    symbols.resize(count);
+}
+
+void TokenBuffer::rebind(std::string_view source) {
+    src = source;
+    lines.reset();
+}
+
+void TokenBuffer::splice(std::size_t first, std::size_t count, const std::vector<Token>& replacement, std::int64_t shift) {
+    std::size_t tail = first + count;
+    if (shift != 0) {
+        for (std::size_t i = tail; i < offsets.size(); i++) {
+            offsets[i] = static_cast<std::uint32_t>(offsets[i] + shift);
+        }
+    }
+
+    if (replacement.size() != count) {
+        std::size_t keep = std::min(count, replacement.size());
+        if (replacement.size() > count) {
+            std::size_t extra = replacement.size() - count;
+            types.insert(types.begin() + tail, extra, TokenType::UNKNOWN);
+            offsets.insert(offsets.begin() + tail, extra, 0);
+            lengths.insert(lengths.begin() + tail, extra, 0);
+            symbols.insert(symbols.begin() + tail, extra, NO_SYMBOL);
+        } else {
+            types.erase(types.begin() + first + keep, types.begin() + tail);
+            offsets.erase(offsets.begin() + first + keep, offsets.begin() + tail);
+            lengths.erase(lengths.begin() + first + keep, lengths.begin() + tail);
+            symbols.erase(symbols.begin() + first + keep, symbols.begin() + tail);
+        }
+    }
+    for (std::size_t i = 0; i < replacement.size(); i++) {
+        types[first + i] = replacement[i].type;
+        offsets[first + i] = replacement[i].offset;
+        lengths[first + i] = replacement[i].length;
+        symbols[first + i] = replacement[i].symbol;
+    }
+}
+
+std::string_view TokenBuffer::text(const Token& token) const {
+    if (token.type == TokenType::END_OF_LINE) return "end_of_line";
+    if (token.type == TokenType::END_OF_FILE) return "end_of_file";
+    return src.substr(token.offset, token.length);
+}
+
+SourceLocation TokenBuffer::location(const Token& token) const {
+    return lines.locate(src, token.offset);
+}
+
+void TokenBuffer::debug(std::size_t i) const {
+    Token token = (*this)[i];
+    SourceLocation loc = location(token);
+    std::cout << "Token("
+        << "type ["
+        << static_cast<int>(token.type)
+        << "]"
+        << ", \"" << text(token)
+        << "\", line " << loc.line
+        << ", col " << loc.column << ")\n";
+}
@@ -1,9 +1,20 @@
 #include "./headers/tokeniser.h"
-#include <cctype>
-#include <iostream>
+#include "./headers/lexertables.h"
+#include "./headers/scanner.h"
+#include "./headers/threadpool.h"
+#include "./headers/syntaxerror.h"
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <stdexcept>
 
-Tokeniser::Tokeniser(const std::string& src)
-    : source(src), pos(0), line(1), col(1), tokenIndex(0) {}
+Tokeniser::Tokeniser(std::string_view src, int firstLine)
+    : tokens(src), tokenIndex(0), source(src), pos(0) {
+    tokens.setFirstLine(firstLine);
+    if (src.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Source file too large (limit is 4 GiB)");
+    }
+}
 
 char Tokeniser::currentChar() {
     return isAtEnd() ? '\0' : source[pos];
@@ -14,12 +25,6 @@ char Tokeniser::peek() const {
 }
 
 void Tokeniser::advance() {
-    if (currentChar() == '\n') {
-        line++;
-        col = 1;
-    } else {
-        col++;
-    }
     pos++;
 }
 
@@ -28,68 +33,62 @@ bool Tokeniser::isAtEnd() const {
 }
 
 void Tokeniser::skipWhitespace() {
-    while (!isAtEnd() && currentChar() != '\n' && std::isspace(static_cast<unsigned char>(currentChar()))) advance();
+    pos = scan::skipSpaces(source, pos);
 }
 
 void Tokeniser::skipComment() {
     if (currentChar() == '/' && peek() == '/') {
-        while (!isAtEnd() && currentChar() != '\n') advance();
+        std::size_t start = pos;
+        bool nonAscii = false;
+        pos = scan::findByte(source, pos + 2, '\n', &nonAscii);
+        if (nonAscii && !scan::validUtf8(source.substr(start, pos - start))) {
+            error(start, "Invalid UTF-8 in comment");
+        }
     }
 }
 
+Token Tokeniser::makeToken(TokenType type, std::size_t start) const {
+    return Token{type, static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(pos - start)};
+}
+
 Token Tokeniser::makeNumber() {
-    int startCol = col;
     std::size_t start = pos;
     bool isFloat = false;
 
-    while (isdigit(currentChar())) advance();
+    while (lexer::is(currentChar(), lexer::CC_DIGIT)) advance();
 
-    if (currentChar() == '.' && isdigit(peek())) {
+    if (currentChar() == '.' && lexer::is(peek(), lexer::CC_DIGIT)) {
         isFloat = true;
         advance();
-        while (isdigit(currentChar())) advance();
+        while (lexer::is(currentChar(), lexer::CC_DIGIT)) advance();
     }
 
-    std::string value = source.substr(start, pos - start);
     TokenType type = isFloat ? TokenType::DOUBLE_LITERAL : TokenType::INT_LITERAL;
-    return Token(type, value, line, startCol);
+    return makeToken(type, start);
 }
 
 Token Tokeniser::makeString() {
-    int startCol = col;
     advance();
     std::size_t start = pos;
-    while (!isAtEnd() && currentChar() != '"') advance();
-    std::string value = source.substr(start, pos - start);
+    bool nonAscii = false;
+    pos = scan::findByte(source, pos, '"', &nonAscii);
+    if (nonAscii && !scan::validUtf8(source.substr(start, pos - start))) {
+        error(start - 1, "Invalid UTF-8 in string literal");
+    }
+    Token token = makeToken(TokenType::STRING_LITERAL, start);
     advance();
-    return Token(TokenType::STRING_LITERAL, value, line, startCol);
+    return token;
 }
 
 Token Tokeniser::makeIdentifierOrKeyword() {
     std::size_t start = pos;
-    int startCol = col;
-    while (isalnum(currentChar()) || currentChar() == '_') advance();
-    std::string value = source.substr(start, pos - start);
-
-    // keywords/types/booleans
-    if (value == "let") return Token(TokenType::LET, value, line, startCol);
-    if (value == "out") return Token(TokenType::OUT, value, line, startCol);
-    if (value == "in") return Token(TokenType::IN, value, line, startCol);
-    if (value == "if") return Token(TokenType::IF, value, line, startCol);
-    if (value == "elif") return Token(TokenType::ELIF, value, line, startCol);
-    if (value == "else") return Token(TokenType::ELSE, value, line, startCol);
-    if (value == "mod") return Token(TokenType::MODULO, value, line, startCol);
-    if (value == "int") return Token(TokenType::TYPE_INT, value, line, startCol);
-    if (value == "double") return Token(TokenType::TYPE_DOUBLE, value, line, startCol);
-    if (value == "string") return Token(TokenType::TYPE_STRING, value, line, startCol);
-    if (value == "bool") return Token(TokenType::TYPE_BOOL, value, line, startCol);
-    if (value == "true" || value == "false") return Token(TokenType::BOOL_LITERAL, value, line, startCol);
-
-    if (value == "and") return Token(TokenType::AND, value, line, startCol);
-    if (value == "or") return Token(TokenType::OR, value, line, startCol);
-    if (value == "endl") return Token(TokenType::ENDL, value, line, startCol);
-
-    return Token(TokenType::IDENTIFIER, value, line, startCol);
+    while (lexer::is(currentChar(), lexer::CC_IDENT)) advance();
+
+    // keywords/types/booleans; anything else is interned once here
+    std::string_view word = source.substr(start, pos - start);
+    Token token = makeToken(lexer::lookupKeyword(word), start);
+    if (token.type == TokenType::IDENTIFIER) token.symbol = SymbolTable::global().intern(word);
+    return token;
 }
 
 Token Tokeniser::nextToken() {
@@ -97,73 +96,173 @@ Token Tokeniser::nextToken() {
     skipComment();
     skipWhitespace();
 
-    if (isAtEnd()) return Token(TokenType::END_OF_FILE, "", line, col);
+    if (isAtEnd()) return makeToken(TokenType::END_OF_FILE, pos);
 
-    int startCol = col;
+    std::size_t start = pos;
     char c = currentChar();
 
-    if (isdigit(c)) return makeNumber();
-    if (isalpha(c) || c == '_') return makeIdentifierOrKeyword();
+    if (lexer::is(c, lexer::CC_DIGIT)) return makeNumber();
+    if (lexer::is(c, lexer::CC_IDENT_START)) return makeIdentifierOrKeyword();
     if (c == '"') return makeString();
-    if (c == '\n') {
-        advance();
-        return Token(TokenType::END_OF_LINE, "end_of_line", line - 1, startCol);
-    }
 
-    Token token(TokenType::UNKNOWN, std::string(1, c), line, col);
+    TokenType type = TokenType::UNKNOWN;
     switch (c) {
-        case '+': token = Token(TokenType::PLUS, "+", line, col); break;
+        case '\n': type = TokenType::END_OF_LINE; break;
+        case '+': type = TokenType::PLUS; break;
         case '-':
-            if (peek() == '>') { advance(); token = Token(TokenType::ARROWF, "->", line, col); }
-            else token = Token(TokenType::MINUS, "-", line, col); break; 
-        case '*': token = Token(TokenType::MUL, "*", line, col); break;
-        case '/': token = Token(TokenType::DIV, "/", line, col); break;
+            if (peek() == '>') { advance(); type = TokenType::ARROWF; }
+            else type = TokenType::MINUS;
+            break;
+        case '*': type = TokenType::MUL; break;
+        case '/': type = TokenType::DIV; break;
         case '=':
-            if (peek() == '=') { advance(); token = Token(TokenType::EE, "==", line, col); }
-            else token = Token(TokenType::EQ, "=", line, col); break;
+            if (peek() == '=') { advance(); type = TokenType::EE; }
+            else type = TokenType::EQ;
+            break;
         case '!':
-            if (peek() == '=') { advance(); token = Token(TokenType::NE, "!=", line, col); }
-            else token = Token(TokenType::NOT, "!", line, col); break;
+            if (peek() == '=') { advance(); type = TokenType::NE; }
+            else type = TokenType::NOT;
+            break;
         case '>':
-            if (peek() == '=') { advance(); token = Token(TokenType::GTE, ">=", line, col); }
-            else token = Token(TokenType::GT, ">", line, col); break;
+            if (peek() == '=') { advance(); type = TokenType::GTE; }
+            else type = TokenType::GT;
+            break;
         case '<':
-            if (peek() == '=') { advance(); token = Token(TokenType::LTE, "<=", line, col); }
-            else if (peek() == '-') { advance(); token = Token(TokenType::ARROWB, "<-", line, col); }
-            else token = Token(TokenType::LT, "<", line, col); break;
-        case ';': token = Token(TokenType::SEMICOLON, ";", line, col); break;
-        case '(': token = Token(TokenType::LPAREN, "(", line, col); break;
-        case ')': token = Token(TokenType::RPAREN, ")", line, col); break;
-        case '{': token = Token(TokenType::LBRACE, "{", line, col); break;
-        case '}': token = Token(TokenType::RBRACE, "}", line, col); break;
-        case ',': token = Token(TokenType::COMMA, ",", line, col); break;
+            if (peek() == '=') { advance(); type = TokenType::LTE; }
+            else if (peek() == '-') { advance(); type = TokenType::ARROWB; }
+            else type = TokenType::LT;
+            break;
+        case ';': type = TokenType::SEMICOLON; break;
+        case '(': type = TokenType::LPAREN; break;
+        case ')': type = TokenType::RPAREN; break;
+        case '{': type = TokenType::LBRACE; break;
+        case '}': type = TokenType::RBRACE; break;
+        case ',': type = TokenType::COMMA; break;
         default: break;
     }
     advance();
-    return token;
+    return makeToken(type, start);
+}
+
+// Lex every token that starts in [begin, end). Returns the offset of the
+// first token not emitted: `end` when the range ends on a token boundary,
+// or further on when the last token (a string literal) ran past `end`.
+std::size_t Tokeniser::lexRange(std::size_t begin, std::size_t end) {
+    pos = begin;
+    while (true) {
+        Token t = nextToken();
+        if (t.type == TokenType::END_OF_FILE || tokenStart(t) >= end) return tokenStart(t);
+        tokens.push(t.type, t.offset, t.length, t.symbol);
+    }
 }
 
 void Tokeniser::tokenize() {
-    tokens.clear();
+    tokens.reset(source);
+    tokens.reserve(source.size() / 6 + 1);
     tokenIndex = 0;
-    while (!isAtEnd()) {
-        Token t = nextToken();
-        if (t.type != TokenType::END_OF_FILE) {
-            tokens.push_back(t);
-        } else {
-            break;
+    lexRange(0, source.size());
+    tokens.push(TokenType::END_OF_FILE, static_cast<std::uint32_t>(source.size()), 0);
+}
+
+// Below this size the thread start-up costs more than it saves
+static const std::size_t PARALLEL_MIN_BYTES = 4 << 20;
+static const std::size_t PARALLEL_MIN_CHUNK = 1 << 20;
+
+void Tokeniser::tokenizeParallel(unsigned workers) {
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+    if (workers <= 1 || source.size() < PARALLEL_MIN_BYTES) {
+        tokenize();
+        return;
+    }
+
+    // Split at newlines. A newline inside a multi-line string literal is not
+    // a real boundary; that is caught below when the chunks are stitched.
+    std::size_t chunkCount = std::min<std::size_t>(workers * 4, source.size() / PARALLEL_MIN_CHUNK);
+    std::vector<std::size_t> bounds{0};
+    for (std::size_t i = 1; i < chunkCount; i++) {
+        std::size_t target = std::max(i * source.size() / chunkCount, bounds.back() + 1);
+        std::size_t newline = scan::findByte(source, target, '\n');
+        if (newline >= source.size()) break;
+        bounds.push_back(newline);
+    }
+    bounds.push_back(source.size());
+    chunkCount = bounds.size() - 1;
+
+    // Every chunk is lexed speculatively, assuming it starts between tokens
+    struct Chunk {
+        Tokeniser lexer;
+        std::size_t stop = 0;
+        std::exception_ptr error;
+        explicit Chunk(std::string_view src) : lexer(src) {}
+    };
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    chunks.reserve(chunkCount);
+    {
+        ThreadPool pool(std::min<std::size_t>(workers, chunkCount));
+        std::vector<std::future<void>> done;
+        for (std::size_t k = 0; k < chunkCount; k++) {
+            chunks.push_back(std::make_unique<Chunk>(source));
+            Chunk* chunk = chunks.back().get();
+            std::size_t begin = bounds[k], end = bounds[k + 1];
+            done.push_back(pool.submit([chunk, begin, end] {
+                try {
+                    chunk->lexer.tokens.reserve((end - begin) / 6 + 1);
+                    chunk->stop = chunk->lexer.lexRange(begin, end);
+                } catch (...) {
+                    chunk->error = std::current_exception();
+                }
+            }));
+        }
+        for (auto& f : done) f.get();
+    }
+
+    // Stitch in order. A chunk is only kept if the previous one stopped
+    // exactly where it started; otherwise its boundary was inside a string
+    // literal and it is lexed again from the real position. Errors from a
+    // chunk are only raised once it is known to be real, so the first error
+    // reported is the one a sequential pass would hit.
+    tokens.reset(source);
+    tokenIndex = 0;
+    std::size_t cursor = 0;
+    for (std::size_t k = 0; k < chunkCount; k++) {
+        Chunk& chunk = *chunks[k];
+        if (bounds[k] != cursor) {
+            chunk.lexer.tokens.reset(source);
+            chunk.stop = chunk.lexer.lexRange(cursor, std::max(cursor, bounds[k + 1]));
+        } else if (chunk.error) {
+            std::rethrow_exception(chunk.error);
         }
+        tokens.append(chunk.lexer.tokens);
+        cursor = chunk.stop;
+        chunks[k].reset();
     }
-    tokens.emplace_back(TokenType::END_OF_FILE, "end_of_file", line, col);
+    tokens.push(TokenType::END_OF_FILE, static_cast<std::uint32_t>(source.size()), 0);
 }
 
 Token Tokeniser::token() {
     if (tokenIndex < tokens.size()) {
         return tokens[tokenIndex++];
     }
-    return Token(TokenType::END_OF_FILE, "end_of_file", line, col);
+    return Token{TokenType::END_OF_FILE, static_cast<std::uint32_t>(source.size()), 0};
 }
 
-const std::vector<Token>& Tokeniser::getTokens() const {
+void Tokeniser::seek(std::size_t offset) {
+    pos = offset;
+}
+
+Token Tokeniser::scanNext() {
+    return nextToken();
+}
+
+const TokenBuffer& Tokeniser::getTokens() const {
     return tokens;
 }
+
+TokenBuffer Tokeniser::takeTokens() {
+    return std::move(tokens);
+}
+
+[[noreturn]] void Tokeniser::error(std::size_t offset, const std::string& message) const {
+    Token at{TokenType::UNKNOWN, static_cast<std::uint32_t>(offset), 0};
+    throw SyntaxError(at.offset, tokens.location(at), "Syntax Error at ", ": " + message);
+}
@@ -0,0 +1,168 @@
+#include "./headers/typechecker.h"
+
+static bool isNumeric(ValueType type) {
+    return type == ValueType::INT || type == ValueType::DOUBLE;
+}
+
+static bool isComparison(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::EQ:
+        case BinaryOp::NE:
+        case BinaryOp::LT:
+        case BinaryOp::GT:
+        case BinaryOp::LE:
+        case BinaryOp::GE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::optional<ValueType> TypeChecker::binaryType(BinaryOp op, ValueType left, ValueType right) {
+    // Numbers: int op int stays int, anything with a double is double
+    if (isNumeric(left) && isNumeric(right)) {
+        if (isComparison(op)) return ValueType::BOOL;
+        ValueType operands = operandType(left, right);
+        switch (op) {
+            case BinaryOp::ADD:
+            case BinaryOp::SUB:
+            case BinaryOp::MUL:
+            case BinaryOp::DIV:
+                return operands;
+            case BinaryOp::MOD:
+                if (operands == ValueType::INT) return ValueType::INT;
+                return std::nullopt;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    // Strings: concatenation and equality
+    if (left == ValueType::STRING && right == ValueType::STRING) {
+        if (op == BinaryOp::ADD) return ValueType::STRING;
+        if (op == BinaryOp::EQ || op == BinaryOp::NE) return ValueType::BOOL;
+        return std::nullopt;
+    }
+
+    // Booleans: logic and equality
+    if (left == ValueType::BOOL && right == ValueType::BOOL) {
+        switch (op) {
+            case BinaryOp::AND:
+            case BinaryOp::OR:
+            case BinaryOp::EQ:
+            case BinaryOp::NE:
+                return ValueType::BOOL;
+            default:
+                return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+ValueType TypeChecker::operandType(ValueType left, ValueType right) {
+    if (left != right && isNumeric(left) && isNumeric(right)) return ValueType::DOUBLE;
+    return left;
+}
+
+Operation TypeChecker::specialize(BinaryOp op, ValueType operands) {
+    switch (operands) {
+        case ValueType::INT:
+            switch (op) {
+                case BinaryOp::ADD: return Operation::ADD_INT;
+                case BinaryOp::SUB: return Operation::SUB_INT;
+                case BinaryOp::MUL: return Operation::MUL_INT;
+                case BinaryOp::DIV: return Operation::DIV_INT;
+                case BinaryOp::MOD: return Operation::MOD_INT;
+                case BinaryOp::EQ: return Operation::EQ_INT;
+                case BinaryOp::NE: return Operation::NE_INT;
+                case BinaryOp::LT: return Operation::LT_INT;
+                case BinaryOp::GT: return Operation::GT_INT;
+                case BinaryOp::LE: return Operation::LE_INT;
+                default: return Operation::GE_INT;
+            }
+        case ValueType::DOUBLE:
+            switch (op) {
+                case BinaryOp::ADD: return Operation::ADD_DOUBLE;
+                case BinaryOp::SUB: return Operation::SUB_DOUBLE;
+                case BinaryOp::MUL: return Operation::MUL_DOUBLE;
+                case BinaryOp::DIV: return Operation::DIV_DOUBLE;
+                case BinaryOp::EQ: return Operation::EQ_DOUBLE;
+                case BinaryOp::NE: return Operation::NE_DOUBLE;
+                case BinaryOp::LT: return Operation::LT_DOUBLE;
+                case BinaryOp::GT: return Operation::GT_DOUBLE;
+                case BinaryOp::LE: return Operation::LE_DOUBLE;
+                default: return Operation::GE_DOUBLE;
+            }
+        case ValueType::STRING:
+            if (op == BinaryOp::ADD) return Operation::CONCAT;
+            return op == BinaryOp::EQ ? Operation::EQ_STRING : Operation::NE_STRING;
+        default:
+            switch (op) {
+                case BinaryOp::AND: return Operation::AND;
+                case BinaryOp::OR: return Operation::OR;
+                case BinaryOp::EQ: return Operation::EQ_BOOL;
+                default: return Operation::NE_BOOL;
+            }
+    }
+}
+
+std::optional<ValueType> TypeChecker::unaryType(UnaryOp op, ValueType operand) {
+    if (op == UnaryOp::NOT) {
+        if (operand == ValueType::BOOL) return ValueType::BOOL;
+        return std::nullopt;
+    }
+    if (isNumeric(operand)) return operand;
+    return std::nullopt;
+}
+
+
+
+std::uint32_t TypeChecker::declare(Symbol name, ValueType type) {
+    if (scopes.empty()) {
+        variableTypes[name] = type;
+        return name;
+    }
+
+    std::uint32_t& entry = innermost[name];
+    if (entry != 0 && locals[entry - 1].depth == depth()) {
+        locals[entry - 1].type = type;
+        return locals[entry - 1].slot;
+    }
+    std::uint32_t slot = nextSlot++;
+    locals.push_back(Local{name, type, depth(), slot, entry});
+    entry = static_cast<std::uint32_t>(locals.size());
+    return slot;
+}
+
+std::optional<TypeChecker::Binding> TypeChecker::resolve(Symbol name) const {
+    const std::uint32_t* entry = locals.empty() ? nullptr : innermost.find(name);
+    if (entry && *entry != 0) {
+        const Local& local = locals[*entry - 1];
+        return Binding{local.type, local.depth, local.slot};
+    }
+
+    std::optional<ValueType> type;
+    if (const ValueType* global = variableTypes.find(name)) {
+        type = *global;
+    } else if (fallback) {
+        type = fallback(name);
+    }
+    if (!type) return std::nullopt;
+    return Binding{*type, 0, name};
+}
+
+void TypeChecker::enterScope() {
+    scopes.push_back(Scope{locals.size(), nextSlot});
+}
+
+Frame TypeChecker::exitScope() {
+    Scope scope = scopes.back();
+    scopes.pop_back();
+    while (locals.size() > scope.firstLocal) {
+        innermost[locals.back().name] = locals.back().shadowed;
+        locals.pop_back();
+    }
+    Frame frame{scope.firstSlot, nextSlot - scope.firstSlot};
+    if (scopes.empty()) nextSlot = 0;   // the next statement starts a frame of its own
+    return frame;
+}
@@ -0,0 +1,44 @@
+#include <new>
+
+#include "./headers/value.h"
+
+Value::Value(std::string_view text) : tag(ValueType::STRING), shortLength(0) {
+    bits = 0;
+    std::memcpy(reserveString(text.size()), text.data(), text.size());
+}
+
+Value Value::join(const Value* parts, std::size_t count) {
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < count; i++) length += parts[i].asString().size();
+    Value joined(0);
+    joined.tag = ValueType::STRING;
+    char* chars = joined.reserveString(length);
+    for (std::size_t i = 0; i < count; i++) {
+        std::string_view part = parts[i].asString();
+        std::memcpy(chars, part.data(), part.size());
+        chars += part.size();
+    }
+    return joined;
+}
+
+// Called on a value holding no buffer
+char* Value::reserveString(std::size_t length) {
+    if (length <= SHORT_CAPACITY) {
+        shortLength = static_cast<std::uint8_t>(length);
+        return shortChars();
+    }
+    text = allocateText(length);
+    shortLength = LONG;
+    return text->chars();
+}
+
+Value::Text* Value::allocateText(std::size_t length) {
+    Text* text = static_cast<Text*>(::operator new(sizeof(Text) + length));
+    text->references = 1;
+    text->length = length;
+    return text;
+}
+
+void Value::freeText(Text* text) {
+    ::operator delete(text);
+}
@@ -0,0 +1,209 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "./headers/vm.h"
+#include "./headers/input.h"
+#include "./headers/output.h"
+#include "./headers/valuetype.h"
+#include "./headers/operators.h"
+
+// Threaded dispatch through a table of label addresses where the compiler
+// has it (GCC, Clang), a switch in a loop elsewhere
+#if defined(__GNUC__)
+#define PANCAKE_COMPUTED_GOTO 1
+#endif
+
+void VM::setSource(std::string_view src, int firstLine) {
+    source = src;
+    lines.reset();
+    lines.setFirstLine(firstLine);
+}
+
+
+void VM::execute(const Ast& ast, NodeList statements) {
+    for (std::uint32_t done = 0; done < statements.count; done += BATCH) {
+        std::uint32_t count = statements.count - done < BATCH ? statements.count - done : BATCH;
+        run(compiler.compile(ast, NodeList{statements.first + done, count}));
+    }
+}
+
+
+void VM::run(const Bytecode& code) {
+    if (globals.size() < code.slots) globals.resize(code.slots);
+    if (values.size() < code.registers) {
+        values.resize(code.registers);
+        strings.resize(code.registers);
+    }
+
+    const Instruction* const start = code.code.data();
+    const Instruction* pc = start;
+    Scalar* v = values.data();
+    Value* s = strings.data();
+    Global* g = globals.data();
+    Output& out = Output::standard();
+    Input& in = Input::standard();
+
+    auto offset = [&] { return code.offsets[pc - start]; };
+
+#ifdef PANCAKE_COMPUTED_GOTO
+    static void* const labels[] = {
+#define PANCAKE_OPCODE_LABEL(name) &&op_##name,
+        PANCAKE_OPCODES(PANCAKE_OPCODE_LABEL)
+#undef PANCAKE_OPCODE_LABEL
+    };
+#define DISPATCH() goto *labels[static_cast<std::size_t>(pc->op)]
+#define CASE(name) op_##name:
+#define NEXT() do { ++pc; DISPATCH(); } while (0)
+    DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(name) case Opcode::name:
+#define NEXT() ++pc; continue
+    for (;;) switch (pc->op) {
+#endif
+
+    CASE(LOAD_INT) v[pc->a].i = static_cast<int>(pc->b); NEXT();
+    CASE(LOAD_DOUBLE) {
+        std::uint64_t bits = pc->b | static_cast<std::uint64_t>(pc->c) << 32;
+        std::memcpy(&v[pc->a].d, &bits, sizeof bits);
+        NEXT();
+    }
+    CASE(LOAD_BOOL) v[pc->a].b = pc->b != 0; NEXT();
+    CASE(LOAD_STRING) s[pc->a] = code.strings[pc->b]; NEXT();
+
+    CASE(GET_INT)
+        if (!g[pc->b].set) runtimeError(offset(), "Undefined variable: " + symbolName(pc->c));
+        v[pc->a].i = g[pc->b].value.i;
+        NEXT();
+    CASE(GET_DOUBLE)
+        if (!g[pc->b].set) runtimeError(offset(), "Undefined variable: " + symbolName(pc->c));
+        v[pc->a].d = g[pc->b].value.d;
+        NEXT();
+    CASE(GET_BOOL)
+        if (!g[pc->b].set) runtimeError(offset(), "Undefined variable: " + symbolName(pc->c));
+        v[pc->a].b = g[pc->b].value.b;
+        NEXT();
+    CASE(GET_STRING)
+        if (!g[pc->b].set) runtimeError(offset(), "Undefined variable: " + symbolName(pc->c));
+        s[pc->a] = g[pc->b].text;
+        NEXT();
+
+    CASE(SET_INT) g[pc->a].value.i = v[pc->b].i; g[pc->a].set = true; NEXT();
+    CASE(SET_DOUBLE) g[pc->a].value.d = v[pc->b].d; g[pc->a].set = true; NEXT();
+    CASE(SET_BOOL) g[pc->a].value.b = v[pc->b].b; g[pc->a].set = true; NEXT();
+    CASE(SET_STRING) g[pc->a].text = s[pc->b]; g[pc->a].set = true; NEXT();
+    CASE(DECLARE)
+        if (g[pc->a].set) runtimeError(offset(), "Variable already declared: " + symbolName(pc->b));
+        NEXT();
+    CASE(ASSIGNABLE)
+        if (!g[pc->a].set) runtimeError(offset(), "Assignment to undeclared variable: " + symbolName(pc->b));
+        NEXT();
+    CASE(UNSET) g[pc->a].set = false; NEXT();
+
+    CASE(ADD_INT) v[pc->a].i = v[pc->b].i + v[pc->c].i; NEXT();
+    CASE(SUB_INT) v[pc->a].i = v[pc->b].i - v[pc->c].i; NEXT();
+    CASE(MUL_INT) v[pc->a].i = v[pc->b].i * v[pc->c].i; NEXT();
+    CASE(DIV_INT)
+        if (v[pc->c].i == 0) runtimeError(offset(), "Division by zero");
+        v[pc->a].i = divideInt(v[pc->b].i, v[pc->c].i);
+        NEXT();
+    CASE(MOD_INT)
+        if (v[pc->c].i == 0) runtimeError(offset(), "Modulo by zero");
+        v[pc->a].i = remainderInt(v[pc->b].i, v[pc->c].i);
+        NEXT();
+    CASE(ADD_DOUBLE) v[pc->a].d = v[pc->b].d + v[pc->c].d; NEXT();
+    CASE(SUB_DOUBLE) v[pc->a].d = v[pc->b].d - v[pc->c].d; NEXT();
+    CASE(MUL_DOUBLE) v[pc->a].d = v[pc->b].d * v[pc->c].d; NEXT();
+    CASE(DIV_DOUBLE)
+        if (v[pc->c].d == 0.0) runtimeError(offset(), "Division by zero");
+        v[pc->a].d = v[pc->b].d / v[pc->c].d;
+        NEXT();
+
+    CASE(TO_DOUBLE) v[pc->a].d = v[pc->b].i; NEXT();
+    CASE(NEGATE_INT) v[pc->a].i = -v[pc->b].i; NEXT();
+    CASE(NEGATE_DOUBLE) v[pc->a].d = -v[pc->b].d; NEXT();
+    CASE(NOT) v[pc->a].b = !v[pc->b].b; NEXT();
+
+    CASE(EQ_INT) v[pc->a].b = v[pc->b].i == v[pc->c].i; NEXT();
+    CASE(NE_INT) v[pc->a].b = v[pc->b].i != v[pc->c].i; NEXT();
+    CASE(LT_INT) v[pc->a].b = v[pc->b].i < v[pc->c].i; NEXT();
+    CASE(GT_INT) v[pc->a].b = v[pc->b].i > v[pc->c].i; NEXT();
+    CASE(LE_INT) v[pc->a].b = v[pc->b].i <= v[pc->c].i; NEXT();
+    CASE(GE_INT) v[pc->a].b = v[pc->b].i >= v[pc->c].i; NEXT();
+    CASE(EQ_DOUBLE) v[pc->a].b = v[pc->b].d == v[pc->c].d; NEXT();
+    CASE(NE_DOUBLE) v[pc->a].b = v[pc->b].d != v[pc->c].d; NEXT();
+    CASE(LT_DOUBLE) v[pc->a].b = v[pc->b].d < v[pc->c].d; NEXT();
+    CASE(GT_DOUBLE) v[pc->a].b = v[pc->b].d > v[pc->c].d; NEXT();
+    CASE(LE_DOUBLE) v[pc->a].b = v[pc->b].d <= v[pc->c].d; NEXT();
+    CASE(GE_DOUBLE) v[pc->a].b = v[pc->b].d >= v[pc->c].d; NEXT();
+    CASE(EQ_BOOL) v[pc->a].b = v[pc->b].b == v[pc->c].b; NEXT();
+    CASE(NE_BOOL) v[pc->a].b = v[pc->b].b != v[pc->c].b; NEXT();
+    CASE(AND) v[pc->a].b = v[pc->b].b && v[pc->c].b; NEXT();
+    CASE(OR) v[pc->a].b = v[pc->b].b || v[pc->c].b; NEXT();
+
+    CASE(JOIN) {
+        // Gathered, which only counts references, then built in one
+        // allocation at most
+        const std::uint32_t* first = code.pieces.data() + pc->b;
+        const std::uint32_t* last = first + pc->c;
+        pieces.clear();
+        for (const std::uint32_t* p = first; p != last; p++) {
+            pieces.push_back(*p & CONSTANT_PIECE ? code.strings[*p & ~CONSTANT_PIECE] : s[*p]);
+        }
+        s[pc->a] = Value::join(pieces.data(), pieces.size());
+        NEXT();
+    }
+    CASE(EQ_STRING) v[pc->a].b = s[pc->b].sameString(s[pc->c]); NEXT();
+    CASE(NE_STRING) v[pc->a].b = !s[pc->b].sameString(s[pc->c]); NEXT();
+
+    CASE(OUT_INT) out.write(v[pc->a].i); NEXT();
+    CASE(OUT_DOUBLE) out.write(v[pc->a].d); NEXT();
+    CASE(OUT_BOOL) out.write(v[pc->a].b); NEXT();
+    CASE(OUT_STRING) out.write(s[pc->a].asString()); NEXT();
+    CASE(OUT_TEXT) out.write(code.strings[pc->a].asString()); NEXT();
+    CASE(OUT_END) out.endLine(); NEXT();
+    CASE(IN) {
+        SourceLocation where;
+        if (in.tracksLocation()) where = lines.locate(source, offset());
+        Input::Value read;
+        switch (in.read(static_cast<ValueType>(pc->b), where, read)) {
+            case Input::Status::OK: break;
+            case Input::Status::END: runtimeError(offset(), "Failed to read input");
+            case Input::Status::MISMATCH: runtimeError(offset(), in.mismatch());
+        }
+
+        // Converted to the variable's static type, as the interpreter does
+        Global& var = g[pc->a];
+        switch (static_cast<ValueType>(pc->b)) {
+            case ValueType::INT: var.value.i = read.intValue; break;
+            case ValueType::DOUBLE: var.value.d = read.doubleValue; break;
+            default: var.text = Value(read.text); break;
+        }
+        var.set = true;
+        NEXT();
+    }
+
+    CASE(JUMP) pc = start + pc->a; DISPATCH();
+    CASE(JUMP_IF_FALSE)
+        if (!v[pc->a].b) {
+            pc = start + pc->b;
+            DISPATCH();
+        }
+        NEXT();
+    CASE(FAIL) runtimeError(offset(), std::string(code.strings[pc->a].asString()));
+    CASE(HALT) return;
+
+#ifndef PANCAKE_COMPUTED_GOTO
+    }
+#endif
+#undef DISPATCH
+#undef CASE
+#undef NEXT
+}
+
+
+[[noreturn]] void VM::runtimeError(std::uint32_t offset, const std::string& msg) {
+    SourceLocation loc = lines.locate(source, offset);
+    throw std::runtime_error("Runtime Error at line " + std::to_string(loc.line) +
+                             ", column " + std::to_string(loc.column) + ": " + msg);
+}